@@ -2,6 +2,16 @@
  * Implementation of a GPC regulator with respect to the requirements given in the
  * WymaganiaProgr2014.pdf document available for PSS students.
  *
+ * \par
+ * When any of the control amplitude, control rate or output constraints is finite,
+ * control increments over the horizon L are calculated by a quadratic programming
+ * solver warm-started from the previous step, instead of the unconstrained gain vector.
+ * The amplitude and rate limits are always kept, output limits out of reach are relaxed.
+ *
+ * \par
+ * With a CGainTable attached, unconstrained gains are interpolated from the table
+ * whenever it covers the current model and setting, and calculated online otherwise.
+ *
  * \note
  * Uses Eigen-Eigen matrix and vector mathematics library.
  */
@@ -11,7 +21,13 @@
 
 #include "Regulator.h"
 #include "SimObject.h"
+#include "ModelChannel.h"
+#include "GPCGainSolver.h"
+#include "ARXPredictor.h"
+#include "ActiveSetQP.h"
+#include "GainTable.h"
 #include <vector>
+#include <memory>
 #include "Eigen/Dense"
 
 class CGPC : public CRegulator
@@ -25,6 +41,12 @@ public:
     /// @copydoc CSimNode::Simulate(double)
     double Simulate(double) override;
 
+    /// @copydoc ISISO::Accept(CNodeVisitor&)
+    void Accept(CNodeVisitor& Visitor) override
+    {
+        Visitor.Visit(*this);
+    }
+
     /// \brief Sets basic GPC parameters.
     /// \param[in] nL Sets L param.
     /// \param[in] nH Sets control horizon.
@@ -33,10 +55,57 @@ public:
     /// \param[in] nK Sets delay.
     void SetParams(int nL, int nH, double dRO, double dAlpha, int nK);
 
+    /// \brief Sets constraints over the horizon. Infinite values disable the constraint.
+    /// \param[in] dUMin Minimum control value.
+    /// \param[in] dUMax Maximum control value.
+    /// \param[in] dDUMax Maximum absolute control increment.
+    /// \param[in] dYMin Minimum predicted output.
+    /// \param[in] dYMax Maximum predicted output.
+    void SetConstraints(double dUMin, double dUMax, double dDUMax, double dYMin, double dYMax);
+
+    /// @copydoc CRegulator::SetParameter(const std::string&, const std::vector<double>&)
+    /// \note New L, H or RO recalculates the Q vector on the next step.
+    bool SetParameter(const std::string& sKey, const std::vector<double>& vValue) override;
+
+    /// @copydoc ISISO::Clone(const std::shared_ptr<CNodeArena>&) const
+    /// \note The copy reads models from the same channel until SetModelChannel() is called.
+    ISISO* Clone(const std::shared_ptr<CNodeArena>& Arena) const override;
+
+    /// \brief Returns true if any of the constraints is finite.
+    bool IsConstrained() const;
+
+    /// \brief Returns the number of QP solver iterations in the last step, 0 if unconstrained.
+    int GetLastQPIterations() const
+    {
+        return m_nQPIterations;
+    }
+
     /// \brief Allows to set explicitly object for prediction.
     /// \param[in] CObj Object to use for prediction.
     void SetObjectForPrediction(ISISO* CObj = NULL);
 
+    /// \brief Attaches the channel identified models are published to.
+    /// \param[in] Channel Channel to read models from. nullptr disables identification.
+    void SetModelChannel(std::shared_ptr<const CModelChannel> Channel)
+    {
+        m_ModelChannel = Channel;
+        m_nModelVersion = 0;
+    }
+
+    /// \brief Attaches a table of precomputed gains.
+    /// \param[in] Table Table to interpolate gains from. nullptr calculates all gains online.
+    void SetGainTable(std::shared_ptr<const CGainTable> Table)
+    {
+        m_GainTable = Table;
+        m_bQValid = false;
+    }
+
+    /// \brief Returns how many times the Q vector was actually recalculated.
+    unsigned long GetQRecomputeCount() const
+    {
+        return m_nQRecomputeCount;
+    }
+
     /// @copydoc CSimNode::SaveState(boost::property_tree::ptree& pt) const
     void SaveState(boost::property_tree::ptree& pt) const override;
 
@@ -49,28 +118,126 @@ public:
         Initialize();
     }
 
+    /// @copydoc ISISO::GetSnapshotSize() const
+    size_t GetSnapshotSize() const override;
+
+    /// @copydoc ISISO::SaveSnapshot(unsigned char*) const
+    /// \note Model and gains are parameters, not state. The QP warm start is not saved
+    /// either, it changes only the number of solver iterations after a restore.
+    unsigned char* SaveSnapshot(unsigned char* p) const override;
+
+    /// @copydoc ISISO::LoadSnapshot(const unsigned char*)
+    const unsigned char* LoadSnapshot(const unsigned char* p) override;
+
 private:
     /// \brief Runs identification algorithm.
     void Identify();
 
-    /// \brief Calculates new Q vector.
+    /// \brief Calculates new Q vector if the model or L, H, RO parameters changed.
     void CreateQ();
 
+    /// \brief Builds the dynamic matrix, QP Hessian and constraint matrix for the current Q key.
+    void CreateConstraints();
+
+    /// \brief Solves the constrained problem for the current free response and reference.
+    /// \param[in] dLastU Last control value.
+    /// \return Control increment.
+    double CalcConstrainedIncrement(double dLastU);
+
+    /// \brief Moves the warm start into the control amplitude and rate limits, step by step
+    /// from the last control, as close to the amplitude limits as the rate allows if it is outside.
+    /// \param[in] dLastU Last control value.
+    void LimitWarmStart(double dLastU);
+
     /// \brief Calculates free response vector.
     void CalcFreeResponse(Eigen::VectorXd&);
 
     /// \brief Calculates reference signal.
     void CalcRefValues(Eigen::VectorXd&);
 
-    /// Object to use for Q vector calculation.
+    /// Object holding the prediction model, used for Q vector calculation.
     std::shared_ptr<CSimObject> m_StepObj;
-    /// Object to use for reference signal calculation.
-    std::shared_ptr<CSimObject> m_RefObj;
-    /// Object to use for free response calculation.
-    std::shared_ptr<CSimObject> m_ARIXObj;
+    /// Predictor of free response and reference signal.
+    CARXPredictor m_Predictor;
+    /// Denominator of the reference signal filter.
+    std::vector<double> m_vRefA;
+    /// Nominator of the reference signal filter.
+    std::vector<double> m_vRefB;
+    /// Future generator values.
+    std::vector<double> m_vRefInput;
+    /// Free response.
+    Eigen::VectorXd m_vY0;
+    /// Reference signal.
+    Eigen::VectorXd m_vW0;
 
+    /// Source of identified models.
+    std::shared_ptr<const CModelChannel> m_ModelChannel;
+    /// Version of the model currently used for prediction.
+    unsigned long long m_nModelVersion;
+    /// Buffer for identified nominator.
+    std::vector<double> m_vNom;
+    /// Buffer for identified denominator.
+    std::vector<double> m_vDenom;
+    /// Incremented every time the prediction model changes.
+    unsigned long m_nModelRevision;
+
+    /// Table of precomputed gains.
+    std::shared_ptr<const CGainTable> m_GainTable;
+    /// File the gain table was loaded from.
+    std::string m_sGainTableFile;
     /// Last calculated Q vector.
     Eigen::VectorXd m_vQ;
+    /// Step response used to calculate m_vQ.
+    std::vector<double> m_vStep;
+    /// Solver calculating m_vQ from the step response.
+    CGPCGainSolver m_GainSolver;
+    /// Is m_vQ calculated for the current key?
+    bool m_bQValid;
+    /// Model revision m_vQ was calculated for.
+    unsigned long m_nQModelRevision;
+    /// L parameter m_vQ was calculated for.
+    int m_nQL;
+    /// H parameter m_vQ was calculated for.
+    int m_nQH;
+    /// Ro parameter m_vQ was calculated for.
+    double m_dQRO;
+    /// Number of Q vector recalculations.
+    unsigned long m_nQRecomputeCount;
+
+    /// Kind of the constraint matrix row.
+    enum ConstraintRow { rowDUMax, rowDUMin, rowUMax, rowUMin, rowYMax, rowYMin };
+
+    /// Minimum control value.
+    double m_dUMin;
+    /// Maximum control value.
+    double m_dUMax;
+    /// Maximum absolute control increment.
+    double m_dDUMax;
+    /// Minimum predicted output.
+    double m_dYMin;
+    /// Maximum predicted output.
+    double m_dYMax;
+    /// Dynamic matrix H x L.
+    Eigen::MatrixXd m_mG;
+    /// Constraint matrix, rows for finite constraints only.
+    Eigen::MatrixXd m_mA;
+    /// Kind of every constraint row.
+    std::vector<ConstraintRow> m_vRowKind;
+    /// Horizon sample of every constraint row.
+    std::vector<int> m_vRowSample;
+    /// Constraint bounds.
+    Eigen::VectorXd m_vBound;
+    /// QP linear term.
+    Eigen::VectorXd m_vF;
+    /// Control increments over L, kept for warm start.
+    Eigen::VectorXd m_vDU;
+    /// Active constraints of the last solution, kept for warm start.
+    std::vector<int> m_vActive;
+    /// Solver of the constrained problem.
+    CActiveSetQP m_QP;
+    /// QP iterations in the last step.
+    int m_nQPIterations;
+
     /// History of feedback to use for identification.
     CHistorian m_FeedbackHistory;
 
@@ -92,4 +259,11 @@ private:
     bool m_bFirstNonZeroInput;
 };
 
+/// \brief Returns the object as a GPC regulator, checked with the capability bits.
+/// \return The object or nullptr if it is of another class.
+inline CGPC* AsGPC(ISISO* pObj)
+{
+    return (pObj && (pObj->GetKind() & kindGPC)) ? static_cast<CGPC*>(pObj) : nullptr;
+}
+
 #endif
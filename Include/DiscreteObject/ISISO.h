@@ -9,11 +9,13 @@
  * - can be used to create a self-organising tree,
  * - automatic parent/children relation handling, with only one parent and many children,
  * - deallocating children of the destroyed node based on smart pointers,
- * - searching objects using BFS or DFS algorithm.
+ * - searching objects by name or ID through a hash index kept by the tree root,
+ * - snapshots of the dynamic state of the object and its children, see CStateArena,
+ * - cloning of the object with its state and subtree, see Clone(),
+ * - typed access without RTTI through capability bits and CNodeVisitor.
 */
 
-#define _DEBUG
-
+#include <cstdint>
 #include <fstream>
 #include <vector>
 #include <list>
@@ -22,6 +24,8 @@
 #include "ObjType.h"
 #include "mainwindow.h"
 #include "Historian.h"
+#include "NodeIndex.h"
+#include "NodeVisitor.h"
 
 #ifndef _ISISO
 #define _ISISO
@@ -51,6 +55,10 @@ public:
     /// \brief Load internal object state data from tree. Each object manages the data itself.
 	virtual void LoadState(boost::property_tree::ptree::value_type const&) = 0;
 
+    /// \brief Sets a single parameter, named as in the saved state, without reloading the whole state.
+    /// \return False if the object has no such parameter or the value does not fit it.
+    virtual bool SetParameter(const std::string&, const std::vector<double>&) = 0;
+
     /// \brief Enables user to set an ID of the object. User must ensure that the name is unique.
 	virtual void SetID(int) = 0;
 
@@ -92,6 +100,18 @@ public:
     /// \return Pointer to found object or <b>nullptr</b>.
     virtual ISISO* SearchObject(const std::string&) = 0;
 
+    /// \brief Searches all the children of the object to find object with the specified ID.
+    /// \return Pointer to found object or <b>nullptr</b>.
+    virtual ISISO* FindObject(int) = 0;
+
+    /// \brief Registers the object, its generators and children in the index of the tree root,
+    /// nullptr unregisters them. Called by the parent when the object is added or removed.
+    virtual void SetIndex(CNodeIndex*) = 0;
+
+    /// \brief Sets key of the random numbers of the object, its generators and children - the seed
+    /// of the session. Called by the parent when the object is added.
+    virtual void SetRandomKey(uint64_t) = 0;
+
     /// \brief Searches the tree for the first regulator object. Implements BFS algorithm.
     /// \return Return pointer to first found regulator.
     virtual ISISO* FindFirstRegulator() = 0;
@@ -103,6 +123,15 @@ public:
     /// \brief Set object functional type.
 	virtual void SetType(ObjType) = 0;
 
+    /// \brief Returns capability bits of the object class, see NodeKind.
+    virtual unsigned int GetKind() const = 0;
+
+    /// \brief Calls the visitor method for the class of the object.
+    virtual void Accept(CNodeVisitor&) = 0;
+
+    /// \brief Visits the object and then all its children in the simulation order.
+    virtual void AcceptTree(CNodeVisitor&) = 0;
+
     /// \brief Set the output stream for object output values.
 	virtual void SetStreamForOutput(std::shared_ptr<std::ostream>) = 0;
 
@@ -121,6 +150,22 @@ public:
     /// \brief Resets objects memory (reset generators if present).
     virtual void ResetMemory() = 0;
 
+    /// \brief Returns number of bytes written by SaveSnapshot() for the object and its children.
+    virtual size_t GetSnapshotSize() const = 0;
+
+    /// \brief Copies dynamic state of the object and its children to the buffer as plain data.
+    /// \return Pointer past the written data.
+    virtual unsigned char* SaveSnapshot(unsigned char*) const = 0;
+
+    /// \brief Restores state written by SaveSnapshot(). The structure of the tree must not change in between.
+    /// \return Pointer past the read data.
+    virtual const unsigned char* LoadSnapshot(const unsigned char*) = 0;
+
+    /// \brief Copies the object with its parameters, state and the whole subtree. The copy has no parent,
+    /// it is owned by the caller the same way as objects created by SObjectFactory.
+    /// \return Copy of the object, allocated in the given arena or on the heap for nullptr.
+    virtual ISISO* Clone(const std::shared_ptr<CNodeArena>&) const = 0;
+
     virtual ~ISISO() {}
 };
 
@@ -0,0 +1,40 @@
+/** \class CNodeVisitor
+ * Visitor of the simulation tree, gets every node as its own class without RTTI.
+ *
+ * \par
+ * Derived visitors override the methods for the classes they care about. Methods of
+ * the concrete regulators call Visit(CRegulator&) by default, the others do nothing.
+ * Use ISISO::Accept() for a single node and ISISO::AcceptTree() for a whole subtree.
+ */
+
+#ifndef _CNODEVISITOR
+#define _CNODEVISITOR
+
+class CSimObject;
+class CRegulator;
+class CPRegulator;
+class CPIDRegulator;
+class CGPC;
+
+class CNodeVisitor
+{
+public:
+    /// \brief Visits a simulated object or a parallel/serial container.
+    virtual void Visit(CSimObject&);
+
+    /// \brief Visits a regulator, called for all the regulators not handled separately.
+    virtual void Visit(CRegulator&);
+
+    /// \brief Visits a P regulator.
+    virtual void Visit(CPRegulator&);
+
+    /// \brief Visits a PID regulator.
+    virtual void Visit(CPIDRegulator&);
+
+    /// \brief Visits a GPC regulator.
+    virtual void Visit(CGPC&);
+
+    virtual ~CNodeVisitor() {}
+};
+
+#endif
@@ -16,4 +16,16 @@ enum ObjType
     gpcregulator = 7
 };
 
+/** \enum NodeKind
+ * Capability bits of a node, fixed by its class. Checked instead of dynamic_cast, see ISISO::GetKind().
+ */
+enum NodeKind
+{
+    kindSimObject = 1 << 0,
+    kindRegulator = 1 << 1,
+    kindPRegulator = 1 << 2,
+    kindPIDRegulator = 1 << 3,
+    kindGPC = 1 << 4
+};
+
 #endif
@@ -16,6 +16,12 @@ public:
     /// @copydoc CSimNode::Simulate(double)
     double Simulate(double dInSample) override;
 
+    /// @copydoc ISISO::Accept(CNodeVisitor&)
+    void Accept(CNodeVisitor& Visitor) override
+    {
+        Visitor.Visit(*this);
+    }
+
 	/// Allows to set gain
     /// \param[in] dK Gain to set.
 	void SetGain(double dK)
@@ -51,6 +57,12 @@ public:
         m_nN = nN;
     }
 
+    /// @copydoc CRegulator::SetParameter(const std::string&, const std::vector<double>&)
+    bool SetParameter(const std::string& sKey, const std::vector<double>& vValue) override;
+
+    /// @copydoc ISISO::Clone(const std::shared_ptr<CNodeArena>&) const
+    ISISO* Clone(const std::shared_ptr<CNodeArena>& Arena) const override;
+
     /// @copydoc CSimNode::SaveState(boost::property_tree::ptree& pt) const
 	void SaveState(boost::property_tree::ptree& pt) const override;
 
@@ -65,6 +77,15 @@ public:
         m_dDLast = 0;
     }
 
+    /// @copydoc ISISO::GetSnapshotSize() const
+    size_t GetSnapshotSize() const override;
+
+    /// @copydoc ISISO::SaveSnapshot(unsigned char*) const
+    unsigned char* SaveSnapshot(unsigned char* p) const override;
+
+    /// @copydoc ISISO::LoadSnapshot(const unsigned char*)
+    const unsigned char* LoadSnapshot(const unsigned char* p) override;
+
     virtual ~CPIDRegulator();
 
 protected:
@@ -15,6 +15,12 @@ public:
     /// @copydoc CSimNode::Simulate(double)
     double Simulate(double dInSample) override;
 
+    /// @copydoc ISISO::Accept(CNodeVisitor&)
+    void Accept(CNodeVisitor& Visitor) override
+    {
+        Visitor.Visit(*this);
+    }
+
 	/// Allows to set gain
     /// \param[in] dK Gain to set.
 	void SetGain(double dK)
@@ -22,6 +28,12 @@ public:
 		m_dK = dK;
 	}
 
+    /// @copydoc CRegulator::SetParameter(const std::string&, const std::vector<double>&)
+    bool SetParameter(const std::string& sKey, const std::vector<double>& vValue) override;
+
+    /// @copydoc ISISO::Clone(const std::shared_ptr<CNodeArena>&) const
+    ISISO* Clone(const std::shared_ptr<CNodeArena>& Arena) const override;
+
     /// @copydoc CSimNode::SaveState(boost::property_tree::ptree& pt) const
 	void SaveState(boost::property_tree::ptree& pt) const override;
 
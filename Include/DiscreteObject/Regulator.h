@@ -39,11 +39,22 @@ public:
 		return m_dSV;
 	}
 
+    /// @copydoc ISISO::SetParameter(const std::string&, const std::vector<double>&)
+    bool SetParameter(const std::string& sKey, const std::vector<double>& vValue) override;
+    /// \note Handles the setpoint common to all regulators.
+
     /// \brief Adds generator to the list.
+    /// A generator without a stream key gets one made of the ID of the regulator
+    /// and the position of the generator.
     /// \param[in] Generator to add.
 	void AddGenerator(std::shared_ptr<IGenerator> Gen)
 	{
+		if (!Gen->GetStreamKey())
+			Gen->SetStreamKey((uint32_t(m_nID) << 8 | uint32_t(m_lGen.size() & 0xFF)) & 0x7FFFFFFFu);
+		Gen->SetRandomKey(m_nRandomKey);
 		m_lGen.push_back(Gen);
+		if (m_pIndex)
+			m_pIndex->AddGenerator(Gen.get(), this);
 	}
 
     /// \brief Resets generator to the entry state.
@@ -52,15 +63,30 @@ public:
     /// \brief Drops the generator list.
 	void DeleteGenerators()
 	{
+		if (m_pIndex)
+			for (auto& gen : m_lGen)
+				m_pIndex->RemoveGenerator(gen.get());
 		m_lGen.clear();
     }
 
     /// @copydoc ISISO::ResetMemory()
     void ResetMemory() override;
 
+    /// @copydoc ISISO::GetSnapshotSize() const
+    size_t GetSnapshotSize() const override;
+
+    /// @copydoc ISISO::SaveSnapshot(unsigned char*) const
+    /// \param[out] p Buffer for the node state followed by generator states.
+    unsigned char* SaveSnapshot(unsigned char* p) const override;
+
+    /// @copydoc ISISO::LoadSnapshot(const unsigned char*)
+    /// \param[in] p Buffer written by SaveSnapshot().
+    const unsigned char* LoadSnapshot(const unsigned char* p) override;
+
     /// @copydoc ISISO::GetName(boost::property_tree::ptree&) const
     /// \param[out] nameTree Tree with all collected names of the children and generators.
     void GetName(boost::property_tree::ptree& nameTree) const override;
+    using CSimNode::GetName;
 
     /// \brief Returns list of generators.
     /// \param[out] genList List to store generator pointers.
@@ -79,6 +105,14 @@ public:
     /// \return Pointer to found object or nullptr.
     ISISO* SearchObject(const std::string& s) override;
 
+    /// @copydoc ISISO::SetIndex(CNodeIndex*)
+    /// \param[in] pIndex Index to register generators in, together with the node and its children.
+    void SetIndex(CNodeIndex* pIndex) override;
+
+    /// @copydoc ISISO::SetRandomKey(uint64_t)
+    /// \param[in] nKey Seed of the session, passed to the generators too.
+    void SetRandomKey(uint64_t nKey) override;
+
     /// \brief Deserializes generators data.
     /// \param[in] pt Tree holding generator parameters.
     void LoadGeneratorState(const boost::property_tree::ptree& pt);
@@ -92,16 +126,33 @@ public:
 	virtual ~CRegulator();
 
 protected:
+    /// \brief Copies the regulator with copies of its generators, which keep their position in the sequence.
+    CRegulator(const CRegulator& other);
 
     /// \brief Will predict next generated value from all generators.
     /// Use with LoadGeneratorHistory() and SaveGeneratorHistory() methods.
     /// \return Future generator value.
     double GetNextGeneratorValue();
 
+    /// \brief Calculates future sums of all generators without changing their state.
+    /// \param[out] out Buffer for n samples, out[0] is the value next GetNextGeneratorValue() call would return.
+    /// \param[in] n Number of samples.
+    /// \param[in] offset Number of samples to skip.
+    void FillGeneratorValues(double* out, size_t n, size_t offset = 0);
+
     ///setpoint value
     double m_dSV;
     ///list containing generators
     std::list<std::shared_ptr<IGenerator> > m_lGen;
+    ///buffer for a single generator output in FillGeneratorValues()
+    std::vector<double> m_vGenBuffer;
 };
 
+/// \brief Returns the object as a regulator, checked with the capability bits.
+/// \return The regulator or nullptr if the object is not one.
+inline CRegulator* AsRegulator(ISISO* pObj)
+{
+    return (pObj && (pObj->GetKind() & kindRegulator)) ? static_cast<CRegulator*>(pObj) : nullptr;
+}
+
 #endif _CREGULATOR
@@ -8,6 +8,17 @@
 * is being removed.
 *
 * \par
+* Nodes can be allocated in a CNodeArena with new (arena) CSimObject(...), their histories
+* and children vectors are then taken from the arena too. Such nodes are owned by shared
+* pointers and deleted the same way as the nodes allocated on the heap.
+*
+* \par
+* Copies of a node take its parameters and histories, but not its parent, children, index,
+* output stream nor the output variables. Clone() of the concrete classes copies the whole
+* subtree. A copy registers its name and ID in the registries current for the calling
+* thread and keeps the original ones if they are free there, eg. in another CSimSession.
+*
+* \par
 * For more \see ISISO.
 */
 
@@ -18,17 +29,32 @@
 #include "SUniqueIDGenerator.h"
 #include "SUniqueNameController.h"
 #include "Historian.h"
+#include "StateArena.h"
+#include "NodeArena.h"
 #include <numeric>
-#ifdef _DEBUG
-#include <iostream>
-#endif
+#include "SLogger.h"
 #include "boost\property_tree\xml_parser.hpp"
 
 #include "ISISO.h"
 class CSimNode :
-	public ISISO
+	public ISISO, public std::enable_shared_from_this<CSimNode>
 {
 public:
+    /// Contiguous storage of children, taken from the arena of the node.
+    typedef std::vector<std::shared_ptr<ISISO>, CArenaAllocator<std::shared_ptr<ISISO> > > ChildVector;
+
+    /// \brief Allocates a node on the heap.
+    static void* operator new(size_t nSize);
+
+    /// \brief Allocates a node in the arena, the node keeps the arena alive.
+    static void* operator new(size_t nSize, const std::shared_ptr<CNodeArena>& Arena);
+
+    /// \brief Frees a node allocated on the heap or in an arena.
+    static void operator delete(void* p, size_t nSize);
+
+    /// \brief Frees a node in the arena when its constructor throws.
+    static void operator delete(void* p, const std::shared_ptr<CNodeArena>& Arena);
+
     /// \brief Constructs the base abstract class for simulation object handling.
     /// \param[in] nID Proposed ID for object. Given 0 next viable id will be found automaticly.
     /// \param[in] Type Type of the object.
@@ -71,6 +97,13 @@ public:
     /// \param[in] v Property tree to deserialize objects data from.
 	void LoadState(boost::property_tree::ptree::value_type const& v) override = 0;
 
+    /// @copydoc ISISO::SetParameter(const std::string&, const std::vector<double>&)
+    /// \note A bare node has no parameters.
+    bool SetParameter(const std::string&, const std::vector<double>&) override
+    {
+        return false;
+    }
+
 	/// @copydoc ISISO::SetID(int)
     /// \param[in] nID New, proposed ID value. When set to 0 picks first available.
 	void SetID(int nID = 0) override;
@@ -111,11 +144,7 @@ public:
 
 	/// @copydoc ISISO::RemoveChild(std::shared_ptr<ISISO>)
     /// \param[in] Child Pointer to the child to remove from the tree.
-	void RemoveChild(std::shared_ptr<ISISO> Child)
-	{
-		if (Child.get() != nullptr)
-			m_lChildren.remove(Child);
-	}
+	void RemoveChild(std::shared_ptr<ISISO> Child) override;
 
     /// @copydoc ISISO::GetChildren(std::list<std::weak_ptr<ISISO> >&) const
     /// \param[out] lChildren Pointes to all the children from the object as a list.
@@ -129,6 +158,22 @@ public:
     /// \param[in] s Name of an object to search.
     ISISO* SearchObject(const std::string& s) override;
 
+    /// @copydoc ISISO::FindObject(int)
+    /// \param[in] nID ID of an object to search.
+    ISISO* FindObject(int nID) override;
+
+    /// @copydoc ISISO::SetIndex(CNodeIndex*)
+    /// \param[in] pIndex Index of the tree root or nullptr.
+    void SetIndex(CNodeIndex* pIndex) override;
+
+    /// @copydoc ISISO::SetRandomKey(uint64_t)
+    /// \param[in] nKey Seed of the session.
+    void SetRandomKey(uint64_t nKey) override;
+
+    /// \brief Returns index of the tree, a root node builds it on the first call.
+    /// \return Index or nullptr if the node is not a root and its root has no index.
+    CNodeIndex* GetIndex();
+
     /// Searches the tree for the first regulator object.
     ISISO* FindFirstRegulator() override;
 
@@ -145,6 +190,16 @@ public:
 		m_Type = Type;
 	}
 
+    /// @copydoc ISISO::GetKind() const
+    unsigned int GetKind() const override
+    {
+        return m_nKind;
+    }
+
+    /// @copydoc ISISO::AcceptTree(CNodeVisitor&)
+    /// \param[in] Visitor Visitor called for every node of the subtree.
+    void AcceptTree(CNodeVisitor& Visitor) override;
+
 	/// @copydoc ISISO::SetStreamForOutput(std::shared_ptr<std::ostream>)
     /// \param[in] oStream Output stream to store output data to.
 	void SetStreamForOutput(std::shared_ptr<std::ostream> oStream) override
@@ -179,9 +234,41 @@ public:
     /// @copydoc ISISO::ResetMemory()
     void ResetMemory() override;
 
+    /// @copydoc ISISO::GetSnapshotSize() const
+    size_t GetSnapshotSize() const override;
+
+    /// @copydoc ISISO::SaveSnapshot(unsigned char*) const
+    /// \param[out] p Buffer for histories of the object and states of its children.
+    unsigned char* SaveSnapshot(unsigned char* p) const override;
+
+    /// @copydoc ISISO::LoadSnapshot(const unsigned char*)
+    /// \param[in] p Buffer written by SaveSnapshot().
+    const unsigned char* LoadSnapshot(const unsigned char* p) override;
+
 	virtual ~CSimNode();
 
 protected:
+    /// \brief Copies the node without its parent and children.
+    CSimNode(const CSimNode& other);
+
+    /// \brief Clones children of this node and attaches the copies to the clone of the node.
+    /// \param[in] pClone Copy of this node.
+    /// \param[in] Arena Arena to allocate the copies in, nullptr for the heap.
+    void CloneChildren(ISISO* pClone, const std::shared_ptr<CNodeArena>& Arena) const;
+
+    /// \brief Moves the node to the end of the children of the parent.
+    /// \note Every ISISO object is a CSimNode, the parent is accessed directly.
+    /// \param[in] Parent New parent.
+    /// \param[in] Self Pointer owning the node.
+    void Attach(ISISO* Parent, const std::shared_ptr<ISISO>& Self);
+
+    /// \brief Checks whether the object is this node or one of its descendants.
+    bool IsInSubtree(ISISO* pObj);
+
+    /// Registry of IDs the object was created with
+    SUniqueIDGenerator* m_pIDs;
+    /// Registry of names the object was created with
+    SUniqueNameController* m_pNames;
     /// Objects unique ID
 	int m_nID;
     /// Objects unique name
@@ -190,18 +277,28 @@ protected:
 	CHistorian m_OutputHistory;
     /// Input sample history
 	CHistorian m_InputHistory;
-    /// List of children
-	std::list<std::shared_ptr<ISISO> > m_lChildren;
+    /// Children in the simulation order
+	ChildVector m_vChildren;
     /// Pointer to parent
 	ISISO* m_Parent;
     /// Objects type
 	ObjType m_Type;
+    /// Capability bits, set by the constructors of the classes
+    unsigned int m_nKind;
+    /// Index of the tree root, nullptr if not built
+    CNodeIndex* m_pIndex;
+    /// Index owned by the node while it is the root
+    std::unique_ptr<CNodeIndex> m_Index;
+    /// Key of the random numbers, taken from the parent
+    uint64_t m_nRandomKey;
     /// Output stream
     std::shared_ptr<std::ostream> m_oStream;
     /// Pointer to variable storing last output value
     std::weak_ptr<double> m_dOutVal;
     /// Pointer to variable storing last input value
     std::weak_ptr<double> m_dInVal;
+    /// Arena the node was allocated in, nullptr for the heap
+    CNodeArena* m_pArena;
 };
 
 #endif
@@ -1,19 +1,28 @@
 /** \class CSimObject
  * Simulated object base class with all necessary properties.
+ *
+ * \par
+ * Optional output noise is normally distributed and comes from CCounterRNG keyed with
+ * the seed of the session, the object ID, its noise seed and the sample number.
+ *
+ * \par
+ * Model vectors are immutable once set, clones share them until one of the objects
+ * gets new ones, so copying a chain does not copy its coefficients.
 */
 
 
 #include "SimNode.h"
+#include "CounterRNG.h"
 
 #ifndef _CSIMOBJECT
 #define _CSIMOBJECT
 
 std::ostream& operator<<(std::ostream& out, const std::vector<double>& v);
 
-///temporary function to convert vector into a string
+///converts vector into a string with the shortest exact digits, see CArrayCodec
 std::string v2str(const std::vector<double>& v);
 
-///temporary function to convert string into vector
+///converts string into vector, throws std::string if a number is malformed, see CArrayCodec
 std::vector<double>& str2v(const std::string& s, std::vector<double>& out_v);
 
 
@@ -28,12 +37,24 @@ public:
     /// @copydoc CSimNode::Simulate(double)
 	double Simulate(double dInSample) override;
 
+    /// @copydoc ISISO::Accept(CNodeVisitor&)
+    void Accept(CNodeVisitor& Visitor) override
+    {
+        Visitor.Visit(*this);
+    }
+
     /// @copydoc CSimNode::SaveState(boost::property_tree::ptree& pt) const
 	void SaveState(boost::property_tree::ptree& pt) const override;
 
     /// @copydoc CSimNode::LoadState(boost::property_tree::ptree::value_type const&)
     void LoadState(boost::property_tree::ptree::value_type const& v) override;
 
+    /// @copydoc ISISO::SetParameter(const std::string&, const std::vector<double>&)
+    bool SetParameter(const std::string& sKey, const std::vector<double>& vValue) override;
+
+    /// @copydoc ISISO::Clone(const std::shared_ptr<CNodeArena>&) const
+    ISISO* Clone(const std::shared_ptr<CNodeArena>& Arena) const override;
+
     /// \brief Function to set vector a of the model.
     /// \param[in] vA Vector A to std::move() to the object.
     void SetVectorA(std::vector<double>&& vA);
@@ -42,7 +63,7 @@ public:
     /// \return Reference to the A vector.
 	const std::vector<double>& GetVectorA() const
 	{
-		return m_vA;
+		return *m_pA;
 	}
 
     /// \brief Function to set vector b of the model.
@@ -53,7 +74,7 @@ public:
     /// \return Reference to the B vector.
 	const std::vector<double>& GetVectorB() const
 	{
-		return m_vB;
+		return *m_pB;
 	}
 
     /// \brief Set K value.
@@ -77,16 +98,36 @@ public:
 		m_bStationary = bStationary;
 	}
 
+    /// \brief Sets output noise.
+    /// \param[in] dNoise Standard deviation of the noise, 0 disables it.
+    /// \param[in] nSeed Seed selecting the noise sequence.
+	void SetNoise(double dNoise, unsigned int nSeed = 0)
+	{
+		m_dNoise = dNoise;
+		m_nNoiseSeed = nSeed;
+	}
+
 	virtual ~CSimObject();
 
 protected:
     /// Is stationary?
 	bool m_bStationary;
-    /// Vector with denominator values.
-	std::vector<double> m_vA;
-    /// Vector with nominator values.
-	std::vector<double> m_vB;
+    /// Vector with denominator values, shared with clones.
+	std::shared_ptr<const std::vector<double> > m_pA;
+    /// Vector with nominator values, shared with clones.
+	std::shared_ptr<const std::vector<double> > m_pB;
 	int m_nK;
+    /// Standard deviation of the output noise.
+	double m_dNoise;
+    /// Seed of the output noise.
+	unsigned int m_nNoiseSeed;
 };
 
+/// \brief Returns the object as a simulated object, checked with the capability bits.
+/// \return The object or nullptr if it is of another class.
+inline CSimObject* AsSimObject(ISISO* pObj)
+{
+    return (pObj && (pObj->GetKind() & kindSimObject)) ? static_cast<CSimObject*>(pObj) : nullptr;
+}
+
 #endif
@@ -0,0 +1,199 @@
+/** \class CExpressionGen
+* Responsible for generating signals composed of other generators.
+*
+* \par
+* The expression combines its operands with one operator:
+* - sum - sum of the operands,
+* - product - product of the operands,
+* - modulate - first operand times (1 + Depth * second operand), amplitude modulation,
+* - sequence - operands one after another, each for its Length samples (the last one
+*   has no end unless Repeat is set); every operand starts from its own first sample.
+*
+* The result is scaled by Gain and shifted by Offset. Operands can be expressions
+* themselves.
+*
+* \par
+* On load the whole tree is compiled into a flat array of nodes. Nested expressions
+* are inlined, so samples are calculated in blocks with a single Fill() call per leaf
+* generator and block instead of a virtual call per generator and sample.
+* GenerateNext() returns samples from a cached block.
+*
+* \par
+* XML layout:
+* \code
+* <Generator Name="Expression">
+*     <Type>7</Type>
+*     <Delay>0</Delay>
+*     <Op>modulate</Op>
+*     <Gain>1</Gain>
+*     <Offset>0</Offset>
+*     <Depth>0.5</Depth>
+*     <Operands>
+*         <Generator>...</Generator>
+*         <Generator>...<Length>100</Length></Generator>
+*     </Operands>
+* </Generator>
+* \endcode
+*/
+
+#ifndef _CEXPRESSIONGEN
+#define _CEXPRESSIONGEN
+
+#include <memory>
+#include <vector>
+#include "Generator.h"
+
+class CExpressionGen :
+    public CGenerator
+{
+public:
+    /// Operator combining the operands.
+    enum EOp
+    {
+        opSum,
+        opProduct,
+        opModulate,
+        opSequence
+    };
+
+    CExpressionGen(std::string sName = "Expression");
+
+    /// \brief Copies the expression together with its operands.
+    CExpressionGen(const CExpressionGen& other);
+
+    /// @copydoc IGenerator::GenerateNext()
+    double GenerateNext() override;
+
+    /// @copydoc IGenerator::Fill(double*, size_t, size_t)
+    void Fill(double* out, size_t n, size_t offset) const override;
+
+    /// @copydoc IGenerator::Reset()
+    void Reset() override;
+
+    /// @copydoc IGenerator::Clone()
+    IGenerator* Clone() const override
+    {
+        return new CExpressionGen(*this);
+    }
+
+    /// @copydoc CGenerator::SetParameter(const std::string&, const std::vector<double>&)
+    bool SetParameter(const std::string& sKey, const std::vector<double>& vValue) override;
+
+    /// @copydoc CGenerator::LoadState(boost::property_tree::ptree::value_type const&)
+    void LoadState(boost::property_tree::ptree::value_type const& vParams) override;
+
+    /// @copydoc CGenerator::SaveState(boost::property_tree::ptree&)
+    void SaveState(boost::property_tree::ptree& pt) const override;
+
+    /// \brief Sets operator of the expression.
+    void SetOp(EOp op);
+
+    /// \brief Sets gain and offset applied to the result.
+    void SetScale(double dGain, double dOffset);
+
+    /// \brief Sets modulation depth used by the modulate operator.
+    void SetDepth(double dDepth);
+
+    /// \brief Makes sequence start again after its last operand.
+    void SetRepeat(bool bRepeat);
+
+    /// \brief Appends an operand.
+    /// \param[in] Gen Operand generator, its own state is not advanced by the expression.
+    /// \param[in] nLength Number of samples of the operand in a sequence.
+    void AddOperand(std::shared_ptr<IGenerator> Gen, long long nLength = 0);
+
+    /// @copydoc CGenerator::SetDelay(int)
+    void SetDelay(int nD) override;
+
+    /// @copydoc CGenerator::SetStreamKey(uint32_t)
+    /// \note Operands without a key get keys derived from this one.
+    void SetStreamKey(uint32_t nKey) override;
+
+    /// @copydoc CGenerator::SetRandomKey(uint64_t)
+    /// \note The key is passed to the operands.
+    void SetRandomKey(uint64_t nKey) override;
+
+    /// \brief Compiles the expression tree. Setters of this expression call it,
+    /// it has to be called after changing a nested expression.
+    void Compile();
+
+    ~CExpressionGen() {}
+
+private:
+    /// Number of samples calculated at once.
+    static const size_t BLOCK = 256;
+    /// Number of levels whose scratch buffers Fill() keeps on the stack.
+    static const int STACK_LEVELS = 8;
+
+    /// Compiled node of the expression tree.
+    struct SNode
+    {
+        /// leaf generator or nullptr for an operator node
+        const IGenerator* pLeaf;
+        /// operator of an inner node
+        EOp op;
+        /// index of the first child in m_vChildren
+        int nFirstChild;
+        /// number of children
+        int nChildren;
+        /// depth of the node, selects its scratch buffer
+        int nLevel;
+        /// gain, offset and modulation depth of an inner node
+        double dGain, dOffset, dDepth;
+        /// delay of an inner node in samples
+        long long nDelay;
+        /// whole length of a repeated sequence, 0 if it does not repeat
+        long long nPeriod;
+    };
+
+    /// Operand of the expression.
+    struct SOperand
+    {
+        std::shared_ptr<IGenerator> Gen;
+        long long nLength;
+    };
+
+    /// \brief Passes the random key to the operand and assigns it a stream key derived from
+    /// the one of the expression if it has none.
+    void KeyOperand(size_t nOperand);
+
+    /// \brief Appends nodes of the expression and its operands to the compiled tree.
+    /// \return Index of the added node.
+    int CompileNode(const CExpressionGen& expr, int nLevel);
+
+    /// \brief Calculates samples nFirst .. nFirst + n - 1 of the node, numbering from 1.
+    void Evaluate(int nNode, double* out, size_t n, long long nFirst, double* pScratch) const;
+
+    /// \brief Calculates samples of the whole expression in blocks.
+    void EvaluateBlocks(double* out, size_t n, long long nFirst, double* pScratch) const;
+
+    /// operator
+    EOp m_Op;
+    /// gain of the result
+    double m_dGain;
+    /// offset of the result
+    double m_dOffset;
+    /// modulation depth
+    double m_dDepth;
+    /// repeat sequence
+    bool m_bRepeat;
+    /// operands
+    std::vector<SOperand> m_vOperands;
+
+    /// compiled nodes, the root is the first one
+    std::vector<SNode> m_vNodes;
+    /// children node indices
+    std::vector<int> m_vChildren;
+    /// sequence lengths of the children
+    std::vector<long long> m_vLengths;
+    /// number of levels of the compiled tree
+    int m_nLevels;
+    /// scratch buffers, BLOCK samples per level, used by GenerateNext()
+    std::vector<double> m_vScratch;
+    /// cached block of samples for GenerateNext()
+    std::vector<double> m_vCache;
+    /// number of the first cached sample, 0 if the cache is empty
+    long long m_nCacheFirst;
+};
+
+#endif
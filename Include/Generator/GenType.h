@@ -12,7 +12,8 @@ enum GenType
 	step = 3,
 	pulse = 4,
 	square = 5,
-	triangle = 6
+	triangle = 6,
+	expression = 7
 };
 
 #endif
@@ -11,6 +11,8 @@
 
 #include "IGenerator.h"
 #include "SUniqueNameController.h"
+#include "SLogger.h"
+#include "StateArena.h"
 
 class CGenerator : public IGenerator
 {
@@ -32,6 +34,17 @@ public:
     /// \param[in] sName Name of the object instance to register.
     void SetName(std::string& sName) override;
 
+    /// @copydoc IGenerator::SetStreamKey(uint32_t)
+    /// \param[in] nKey Key unique among the generators of the tree.
+    void SetStreamKey(uint32_t nKey) override;
+
+    /// @copydoc IGenerator::GetStreamKey()
+    uint32_t GetStreamKey() const override;
+
+    /// @copydoc IGenerator::SetRandomKey(uint64_t)
+    /// \param[in] nKey Seed of the session.
+    void SetRandomKey(uint64_t nKey) override;
+
     /// @copydoc IGenerator::SetDelay(int)
     /// \param[in] nD Delay in samples.
     void SetDelay(int nD) override;
@@ -42,17 +55,35 @@ public:
     /// @copydoc IGenerator::LoadHistory()
     void LoadHistory() override;
 
+    /// @copydoc IGenerator::GetSnapshotSize()
+    size_t GetSnapshotSize() const override;
+
+    /// @copydoc IGenerator::SaveSnapshot(unsigned char*)
+    unsigned char* SaveSnapshot(unsigned char* p) const override;
+
+    /// @copydoc IGenerator::LoadSnapshot(const unsigned char*)
+    const unsigned char* LoadSnapshot(const unsigned char* p) override;
+
     /// @copydoc IGenerator::LoadState(boost::property_tree::ptree::value_type const&)
     /// \param[in] vParams Property tree containing data to deserialize the object.
     virtual void LoadState(boost::property_tree::ptree::value_type const& vParams) = 0;
 
+    /// @copydoc IGenerator::SetParameter(const std::string&, const std::vector<double>&)
+    /// \note Handles the delay common to all generators.
+    bool SetParameter(const std::string& sKey, const std::vector<double>& vValue) override;
+
     /// @copydoc IGenerator::SaveState(boost::property_tree::ptree &)
     /// \param[out] pt Property tree to store serialized object.
     virtual void SaveState(boost::property_tree::ptree& pt) const = 0;
 
 protected:
+    /// \brief Copies the generator, the copy registers the name in the current registry.
+    CGenerator(const CGenerator& other);
+
     /// generator type
     const GenType m_Type;
+    /// registry of names the generator was created with
+    SUniqueNameController* m_pNames;
     /// generator name
     std::string m_sName;
     /// number of sample in a sequence
@@ -61,6 +92,10 @@ protected:
     int m_nIBack;
     /// delay of the output in samples
     int m_nDelay;
+    /// key of the random samples, assigned by the regulator
+    uint32_t m_nStreamKey;
+    /// key of the random numbers, the seed of the session
+    uint64_t m_nRandomKey;
 };
 
 #endif // _CGENERATOR
@@ -8,12 +8,18 @@
 * Main features:
 * - generating samples,
 * - saving and loading state - serialization,
-* - saving and loading history, so generators can be used for prediction.
+* - saving and loading history, so generators can be used for prediction,
+* - snapshots of the state in a caller provided buffer, for nested prediction,
+* - filling blocks of future samples without changing the generator state.
 */
 
 #ifndef _IGENERATOR
 #define _IGENERATOR
 
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
 #include "GenType.h"
 #include "boost\property_tree\ptree.hpp"
 
@@ -25,6 +31,13 @@ public:
     /// \return Next generated sample of the output.
 	virtual double GenerateNext() = 0;
 
+    /// \brief Calculates future samples without changing the generator state.
+    /// out[i] is the value GenerateNext() would return after offset + i previous calls.
+    /// \param[out] out Buffer for n samples.
+    /// \param[in] n Number of samples.
+    /// \param[in] offset Number of samples to skip.
+    virtual void Fill(double* out, size_t n, size_t offset) const = 0;
+
     /// \brief Resets the generator to the enter state.
 	virtual void Reset() = 0;
 
@@ -34,6 +47,10 @@ public:
     /// \brief Sets generator parameters.
 	virtual void LoadState(boost::property_tree::ptree::value_type const&) = 0;
 
+    /// \brief Sets a single parameter, named as in the saved state. Position in the sequence is kept.
+    /// \return False if the generator has no such parameter or the value does not fit it.
+    virtual bool SetParameter(const std::string&, const std::vector<double>&) = 0;
+
     /// \brief Saves generator to given tree.
     virtual void SaveState(boost::property_tree::ptree&) const = 0;
 
@@ -46,12 +63,36 @@ public:
     /// \brief Sets name.
     virtual void SetName(std::string& sName) = 0;
 
+    /// \brief Sets key separating random samples of the generator from the ones of other generators.
+    virtual void SetStreamKey(uint32_t) = 0;
+
+    /// \brief Returns key of the random samples, 0 if not assigned yet.
+    virtual uint32_t GetStreamKey() const = 0;
+
+    /// \brief Sets key of the random numbers - the seed of the session, passed by the regulator.
+    virtual void SetRandomKey(uint64_t) = 0;
+
     /// \brief Internally saves a current state in relation with the output signal generation.
     virtual void SaveHistory() = 0;
 
     /// \brief Restores an internal state saved with SaveHistory() method.
     virtual void LoadHistory() = 0;
 
+    /// \brief Returns number of bytes written by SaveSnapshot().
+    virtual size_t GetSnapshotSize() const = 0;
+
+    /// \brief Copies the state in relation with the output signal generation to the buffer.
+    /// \return Pointer past the written data.
+    virtual unsigned char* SaveSnapshot(unsigned char*) const = 0;
+
+    /// \brief Restores the state written by SaveSnapshot().
+    /// \return Pointer past the read data.
+    virtual const unsigned char* LoadSnapshot(const unsigned char*) = 0;
+
+    /// \brief Copies the generator with its parameters and position in the sequence.
+    /// \return Copy owned by the caller.
+    virtual IGenerator* Clone() const = 0;
+
     virtual ~IGenerator() {}
 };
 
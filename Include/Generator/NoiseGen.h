@@ -1,28 +1,53 @@
 /** \class CNoiseGen
 * Responsible for generating white noise with given variance.
+*
+* \par
+* Samples come from CCounterRNG keyed with the seed of the session, the stream key given by
+* the regulator, the generator seed and the sample number, so future samples can be
+* calculated without generating the preceding ones and the sequence is reproducible.
+* Generators of different regulators are not correlated even with the same seed. The distribution is either
+* uniform in <0,1) or standard normal, scaled by A*sqrt(Var).
 */
 
 #ifndef _CNOISEGEN
 #define _CNOISEGEN
 
-#include <cstdlib>
+#include <algorithm>
 #include <cmath>
 #include "Generator.h"
+#include "CounterRNG.h"
+
 class CNoiseGen :
     public CGenerator
 {
 public:
     CNoiseGen(std::string sName = "Noise") : CGenerator(sName, noise), m_dVar(1.0),
-        m_dA(0.1) {}
+        m_dA(0.1), m_nSeed(0), m_bGaussian(false) {}
 
     /// @copydoc IGenerator::GenerateNext()
 	double GenerateNext() override
 	{
 		++m_nI;
-		if (m_nDelay >= m_nI)
-			return 0.0;
+		return GetSample(m_nI);
+	}
 
-		return m_dA*(rand()/(double)RAND_MAX)*sqrt(m_dVar);
+	/// @copydoc IGenerator::Fill(double*, size_t, size_t)
+	void Fill(double* out, size_t n, size_t offset) const override
+	{
+		// samples up to the end of the delay are 0
+		long long nFirst = m_nI + (long long)offset + 1;
+		size_t nZeros = (size_t)std::min<long long>(std::max<long long>(m_nDelay - nFirst + 1, 0), n);
+		std::fill(out, out + nZeros, 0.0);
+
+		CCounterRNG rng(m_nRandomKey, GetStream());
+		if (m_bGaussian)
+			rng.FillGaussian(out + nZeros, n - nZeros, nFirst + nZeros);
+		else
+			rng.FillUniform(out + nZeros, n - nZeros, nFirst + nZeros);
+
+		double dScale = sqrt(m_dVar);
+		for (size_t i = nZeros; i < n; ++i)
+			out[i] = m_dA*out[i]*dScale;
 	}
 
 	/// @copydoc IGenerator::Reset()
@@ -31,19 +56,40 @@ public:
 		m_nI = 0;
     }
 
+    /// @copydoc IGenerator::Clone()
+    IGenerator* Clone() const override
+    {
+        return new CNoiseGen(*this);
+    }
+
+    /// @copydoc CGenerator::SetParameter(const std::string&, const std::vector<double>&)
+    bool SetParameter(const std::string& sKey, const std::vector<double>& vValue) override
+    {
+        if (vValue.size() == 1 && sKey == "Var")
+            SetVariance(vValue[0]);
+        else if (vValue.size() == 1 && sKey == "A")
+            SetAmplitude(vValue[0]);
+        else if (vValue.size() == 1 && sKey == "Seed" && vValue[0] >= 0)
+            SetSeed(static_cast<unsigned int>(vValue[0]));
+        else if (vValue.size() == 1 && sKey == "Gaussian")
+            SetGaussian(vValue[0] != 0);
+        else
+            return CGenerator::SetParameter(sKey, vValue);
+        return true;
+    }
+
     /// @copydoc CGenerator::LoadState(boost::property_tree::ptree::value_type const&)
     void LoadState(boost::property_tree::ptree::value_type const& vParams) override
 	{
 		m_nDelay = vParams.second.get<int>("Delay");
 		m_dVar = vParams.second.get<double>("Var");
 		m_dA = vParams.second.get<double>("A");
+		m_nSeed = vParams.second.get<unsigned int>("Seed", 0);
+		m_bGaussian = vParams.second.get<bool>("Gaussian", false);
+		m_nStreamKey = vParams.second.get<uint32_t>("Stream", m_nStreamKey);
 		m_nI = 0;
-#ifdef _DEBUG
-		std::cout << "\t----------\n" << "\tSquareGen" << std::endl;
-		std::cout << "\tDelay: " << vParams.second.get<int>("Delay") << std::endl;
-		std::cout << "\tA: " << vParams.second.get<double>("A") << std::endl;
-		std::cout << "\tVar: " << vParams.second.get<double>("Var") << std::endl;
-#endif
+		SIM_LOG_DEBUG("NoiseGen " << m_sName << " Delay: " << m_nDelay << " A: " << m_dA << " Var: " << m_dVar
+		              << " Seed: " << m_nSeed << " Gaussian: " << m_bGaussian);
 	}
 
     /// \brief Sets variance of the noise.
@@ -53,6 +99,19 @@ public:
 		m_dVar = dVar;
 	}
 
+    /// \brief Sets seed selecting the noise sequence.
+    /// \param[in] nSeed Seed of the generator.
+	void SetSeed(unsigned int nSeed)
+	{
+		m_nSeed = nSeed;
+	}
+
+    /// \brief Selects normal (true) or uniform <0,1) (false) distribution.
+	void SetGaussian(bool bGaussian)
+	{
+		m_bGaussian = bGaussian;
+	}
+
     /// \brief Sets amplitude.
     /// \param[in] dA Amplitude of the output.
 	void SetAmplitude(double dA)
@@ -69,16 +128,40 @@ public:
 		node.put("Delay", m_nDelay);
 		node.put("A", m_dA);
 		node.put("Var", m_dVar);
+		node.put("Seed", m_nSeed);
+		node.put("Gaussian", m_bGaussian);
+		node.put("Stream", m_nStreamKey);
         node.put("<xmlattr>.Name", m_sName);
     }
 
 	~CNoiseGen() {}
 
 private:
+    /// \brief Returns value of the sample with the given number.
+	double GetSample(long long nI) const
+	{
+		if (m_nDelay >= nI)
+			return 0.0;
+
+		CCounterRNG rng(m_nRandomKey, GetStream());
+		double dValue = m_bGaussian ? rng.Gaussian(nI) : rng.Uniform(nI);
+		return m_dA*dValue*sqrt(m_dVar);
+	}
+
+    /// \brief Returns random stream of the generator, separate from the streams of simulated objects.
+	uint64_t GetStream() const
+	{
+		return (1ull << 63) | (uint64_t(m_nStreamKey & 0x7FFFFFFFu) << 32) | m_nSeed;
+	}
+
     /// variance of the signal
     double m_dVar;
     /// amplitude
     double m_dA;
+    /// seed selecting the noise sequence
+    unsigned int m_nSeed;
+    /// normal instead of uniform distribution
+    bool m_bGaussian;
 };
 
 #endif
@@ -6,6 +6,7 @@
 #define _CPULSEGEN
 
 #include <limits>
+#include <algorithm>
 #include "Generator.h"
 
 class CPulseGen :
@@ -26,21 +27,35 @@ public:
 		return 0.0;
 	}
 
+	/// @copydoc IGenerator::Fill(double*, size_t, size_t)
+	void Fill(double* out, size_t n, size_t offset) const override
+	{
+		// the only non-zero sample comes right after the delay
+		long long nFirst = m_nI + (long long)offset + 1;
+		long long nPulse = m_nDelay + 1 - nFirst;
+		std::fill(out, out + n, 0.0);
+		if (nPulse >= 0 && nPulse < (long long)n)
+			out[nPulse] = 1.0;
+	}
+
 	/// @copydoc IGenerator::Reset()
 	void Reset() override
 	{
 		m_nI = 0;
 	}
 
+    /// @copydoc IGenerator::Clone()
+    IGenerator* Clone() const override
+    {
+        return new CPulseGen(*this);
+    }
+
     /// @copydoc CGenerator::LoadState(boost::property_tree::ptree::value_type const&)
 	void LoadState(boost::property_tree::ptree::value_type const& vParams)
 	{
 		m_nDelay = vParams.second.get<int>("Delay");
 		m_nI = 0;
-#ifdef _DEBUG
-		std::cout << "\t----------\n" << "\tPulseGen" << std::endl;
-		std::cout << "\tDelay: " << vParams.second.get<int>("Delay") << std::endl;
-#endif
+		SIM_LOG_DEBUG("PulseGen " << m_sName << " Delay: " << m_nDelay);
 	}
 
     /// @copydoc CGenerator::SaveState(boost::property_tree::ptree&)
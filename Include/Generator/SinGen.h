@@ -1,11 +1,17 @@
 /** \class CSineGen
 * Responsible for generating sinus signal.
+*
+* \par
+* Samples are calculated with the polynomial sine of CWaveKernels, so GenerateNext()
+* and Fill() give identical values.
 */
 
 #ifndef _CSINEGEN
 #define _CSINEGEN
 
 #include "Generator.h"
+#include "WaveKernels.h"
+#include <algorithm>
 #include <cmath>
 
 static const double PI = 3.1415926;
@@ -27,11 +33,21 @@ public:
 			return 0;
 		}
 
-		double dRetVal = sin(2 * PI * m_nI / (double) m_nT);
+		double dRetVal = CWaveKernels::Sin(2 * PI * (double) m_nI / (double) m_nT);
 
 		return m_dA * dRetVal;
 	}
 
+	/// @copydoc IGenerator::Fill(double*, size_t, size_t)
+	void Fill(double* out, size_t n, size_t offset) const override
+	{
+		// samples up to the end of the delay are 0
+		long long nFirst = m_nI + (long long)offset + 1;
+		size_t nZeros = (size_t)std::min<long long>(std::max<long long>(m_nDelay - nFirst + 1, 0), n);
+		std::fill(out, out + nZeros, 0.0);
+		CWaveKernels::Sine(out + nZeros, n - nZeros, nFirst + nZeros, 2 * PI, m_nT, m_dA);
+	}
+
 	/// @copydoc IGenerator::Reset()
 	void Reset() override
 	{
@@ -52,6 +68,24 @@ public:
 		m_nT = nT;
 	}
 
+    /// @copydoc IGenerator::Clone()
+    IGenerator* Clone() const override
+    {
+        return new CSineGen(*this);
+    }
+
+    /// @copydoc CGenerator::SetParameter(const std::string&, const std::vector<double>&)
+    bool SetParameter(const std::string& sKey, const std::vector<double>& vValue) override
+    {
+        if (vValue.size() == 1 && sKey == "A")
+            SetAmplitude(vValue[0]);
+        else if (vValue.size() == 1 && sKey == "T" && vValue[0] >= 1)
+            SetPeriod(static_cast<int>(vValue[0]));
+        else
+            return CGenerator::SetParameter(sKey, vValue);
+        return true;
+    }
+
     /// @copydoc CGenerator::LoadState(boost::property_tree::ptree::value_type const&)
     void LoadState(boost::property_tree::ptree::value_type const& vParams) override
 	{
@@ -59,13 +93,7 @@ public:
 		m_nT = vParams.second.get<int>("T");
 		m_dA = vParams.second.get<double>("A");
 		m_nI = 0;
-
-#ifdef _DEBUG
-		std::cout << "\t----------\n" << "\tSineGen" << std::endl;
-		std::cout << "\tDelay: " << vParams.second.get<int>("Delay") << std::endl;
-		std::cout << "\tT: " << vParams.second.get<int>("T") << std::endl;
-		std::cout << "\tA: " << vParams.second.get<double>("A") << std::endl;
-#endif
+		SIM_LOG_DEBUG("SineGen " << m_sName << " Delay: " << m_nDelay << " T: " << m_nT << " A: " << m_dA);
 	}
 
     /// @copydoc CGenerator::SaveState(boost::property_tree::ptree&)
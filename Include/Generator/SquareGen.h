@@ -6,6 +6,8 @@
 #define _CSQUAREGEN
 
 #include "Generator.h"
+#include "WaveKernels.h"
+#include <algorithm>
 
 class CSquareGen :
     public CGenerator
@@ -25,7 +27,7 @@ public:
 		}
 
 		/// calculating moment of switch
-		int nSamplePeriod = (int)(m_nT*m_dD);
+		int nSamplePeriod = GetSwitchPeriod();
 
 		/// if the period is a factor of the current sample value (reduced by delay) 
 		/// switch the wave sign
@@ -37,6 +39,30 @@ public:
 		return m_nCurrSign*m_dA;
 	}
 
+	/// @copydoc IGenerator::Fill(double*, size_t, size_t)
+	void Fill(double* out, size_t n, size_t offset) const override
+	{
+		int nSamplePeriod = GetSwitchPeriod();
+		long long nFirst = m_nI + (long long)offset + 1;
+		/// switches already done, counted from the end of the delay
+		long long nDone = (std::max<long long>(m_nI, m_nDelay) - m_nDelay) / nSamplePeriod;
+
+		/// samples up to the end of the delay are 0
+		size_t nZeros = (size_t)std::min<long long>(std::max<long long>(m_nDelay - nFirst + 1, 0), n);
+		std::fill(out, out + nZeros, 0.0);
+		if (nZeros == n)
+			return;
+
+		/// every switch between the current and the first non-zero sample flips the sign
+		long long nI = nFirst + nZeros;
+		long long nSwitches = (nI - m_nDelay) / nSamplePeriod - nDone;
+		double dFirst = ((nSwitches & 1) ? -m_nCurrSign : m_nCurrSign)*m_dA;
+
+		/// the sign stays until the next multiple of the period after the delay
+		long long nNext = m_nDelay + ((nI - m_nDelay) / nSamplePeriod + 1) * nSamplePeriod;
+		CWaveKernels::Square(out + nZeros, n - nZeros, (size_t)(nNext - nI), nSamplePeriod, dFirst);
+	}
+
 	/// @copydoc IGenerator::Reset()
 	void Reset() override
 	{
@@ -64,6 +90,26 @@ public:
 		m_dD = nDC;
 	}
 
+    /// @copydoc IGenerator::Clone()
+    IGenerator* Clone() const override
+    {
+        return new CSquareGen(*this);
+    }
+
+    /// @copydoc CGenerator::SetParameter(const std::string&, const std::vector<double>&)
+    bool SetParameter(const std::string& sKey, const std::vector<double>& vValue) override
+    {
+        if (vValue.size() == 1 && sKey == "A")
+            SetAmplitude(vValue[0]);
+        else if (vValue.size() == 1 && sKey == "T" && vValue[0] >= 1)
+            SetPeriod(static_cast<int>(vValue[0]));
+        else if (vValue.size() == 1 && sKey == "DutyCycle" && vValue[0] >= 0 && vValue[0] <= 1)
+            SetDutyCycle(vValue[0]);
+        else
+            return CGenerator::SetParameter(sKey, vValue);
+        return true;
+    }
+
     /// @copydoc CGenerator::LoadState(boost::property_tree::ptree::value_type const&)
 	void LoadState(boost::property_tree::ptree::value_type const& vParams)
 	{
@@ -73,13 +119,7 @@ public:
 		m_dD = vParams.second.get<double>("DutyCycle");
         //m_nI = 0;
         //m_nCurrSign = 1;
-#ifdef _DEBUG
-		std::cout << "\t----------\n" << "\tSquareGen" << std::endl;
-		std::cout << "\tDelay: " << vParams.second.get<int>("Delay") << std::endl;
-		std::cout << "\tT: " << vParams.second.get<int>("T") << std::endl;
-		std::cout << "\tA: " << vParams.second.get<double>("A") << std::endl;
-		std::cout << "\tDutyCycle: " << vParams.second.get<double>("DutyCycle") << std::endl;
-#endif
+		SIM_LOG_DEBUG("SquareGen " << m_sName << " Delay: " << m_nDelay << " T: " << m_nT << " A: " << m_dA << " DutyCycle: " << m_dD);
 	}
 
     /// @copydoc CGenerator::SaveState(boost::property_tree::ptree&)
@@ -111,9 +151,34 @@ public:
         m_nCurrSign = m_nCurrSignBack;
     }
 
+    /// @copydoc IGenerator::GetSnapshotSize()
+    size_t GetSnapshotSize() const override
+    {
+        return CGenerator::GetSnapshotSize() + sizeof(m_nCurrSign);
+    }
+
+    /// @copydoc IGenerator::SaveSnapshot(unsigned char*)
+    unsigned char* SaveSnapshot(unsigned char* p) const override
+    {
+        return PutSnapshot(CGenerator::SaveSnapshot(p), m_nCurrSign);
+    }
+
+    /// @copydoc IGenerator::LoadSnapshot(const unsigned char*)
+    const unsigned char* LoadSnapshot(const unsigned char* p) override
+    {
+        return GetSnapshot(CGenerator::LoadSnapshot(p), m_nCurrSign);
+    }
+
 	~CSquareGen() {}
 
 private:
+    /// \brief Returns number of samples between sign switches, at least 1.
+	int GetSwitchPeriod() const
+	{
+		int nSamplePeriod = (int)(m_nT*m_dD);
+		return nSamplePeriod > 0 ? nSamplePeriod : 1;
+	}
+
     /// amplitude
     double m_dA;
     /// period in samples
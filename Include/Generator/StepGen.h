@@ -6,6 +6,8 @@
 #define _CSTEPGEN
 
 #include "Generator.h"
+#include <algorithm>
+
 class CStepGen :
     public CGenerator
 {
@@ -23,22 +25,45 @@ public:
         return 1.0*m_dK;
 	}
 
+	/// @copydoc IGenerator::Fill(double*, size_t, size_t)
+	void Fill(double* out, size_t n, size_t offset) const override
+	{
+		// samples up to the end of the delay are 0, the rest is the gain
+		long long nFirst = m_nI + (long long)offset + 1;
+		long long nZeros = std::min<long long>(std::max<long long>(m_nDelay - nFirst + 1, 0), n);
+		std::fill(out, out + nZeros, 0.0);
+		std::fill(out + nZeros, out + n, 1.0*m_dK);
+	}
+
 	/// @copydoc IGenerator::Reset()
 	void Reset() override
 	{
 		m_nI = 0;
     }
 
+    /// @copydoc IGenerator::Clone()
+    IGenerator* Clone() const override
+    {
+        return new CStepGen(*this);
+    }
+
+    /// @copydoc CGenerator::SetParameter(const std::string&, const std::vector<double>&)
+    bool SetParameter(const std::string& sKey, const std::vector<double>& vValue) override
+    {
+        if (vValue.size() == 1 && sKey == "K")
+            m_dK = vValue[0];
+        else
+            return CGenerator::SetParameter(sKey, vValue);
+        return true;
+    }
+
     /// @copydoc CGenerator::LoadState(boost::property_tree::ptree::value_type const&)
     void LoadState(boost::property_tree::ptree::value_type const& vParams) override
 	{
 		m_nDelay = vParams.second.get<int>("Delay");
         m_dK = vParams.second.get<double>("K");
 		m_nI = 0;
-#ifdef _DEBUG
-		std::cout << "\t----------\n" << "\tStepGen" << std::endl;
-		std::cout << "\tDelay: " << vParams.second.get<int>("Delay") << std::endl;
-#endif
+		SIM_LOG_DEBUG("StepGen " << m_sName << " Delay: " << m_nDelay << " K: " << m_dK);
 	}
 
     /// @copydoc CGenerator::SaveState(boost::property_tree::ptree&)
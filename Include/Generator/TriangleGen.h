@@ -1,11 +1,18 @@
 /** \class CTriangleGen
 * Responsible for generating triangle wave.
+*
+* \par
+* After the delay the output rises from A/T to A in T samples, then falls
+* to -A in 2T samples, so the wave repeats every 3T samples. Fill() uses
+* CWaveKernels to calculate whole slopes at once.
 */
 
 #ifndef _CTRIANGLEGEN
 #define _CTRIANGLEGEN
 
 #include "Generator.h"
+#include "WaveKernels.h"
+#include <algorithm>
 #include <cmath>
 
 
@@ -19,23 +26,65 @@ public:
 	/// @copydoc IGenerator::GenerateNext()
 	double GenerateNext() override
 	{
-		++m_nI;
-		/// calculating delay
-		if (m_nDelay >= m_nI)
-		{
-			return 0;
-        }
+		return Step(m_nI, m_nSign);
+	}
 
-		double dIoverT = (m_nI-m_nDelay) / (double) m_nT;
-		double dRetVal = m_nSign * m_dA * (dIoverT) + m_dA*(m_nSign - 1.0)*(-0.5);
+	/// @copydoc IGenerator::Fill(double*, size_t, size_t)
+	void Fill(double* out, size_t n, size_t offset) const override
+	{
+		int nI = m_nI;
+		int nSign = m_nSign;
 
-		if (dRetVal >= m_dA || dRetVal <= -1.0*m_dA)
+		/// the wave never reaches its turning points - follow the generator step by step
+		if (m_dA <= 0 || m_nT <= 0)
 		{
-			m_nI = m_nDelay;
-			m_nSign *= -1;
+			for (size_t i = 0; i < offset; ++i)
+				Step(nI, nSign);
+			for (size_t i = 0; i < n; ++i)
+				out[i] = Step(nI, nSign);
+			return;
 		}
 
-		return dRetVal;
+		/// samples left in the delay and position in the current slope
+		long long nZeros = std::max(m_nDelay - nI, 0);
+		long long nPos = std::max(nI - m_nDelay, 0);
+		/// the current slope ends on the next sample if it already went past its length
+		long long nCurrLength = std::max<long long>(GetSlopeLength(nSign), nPos + 1);
+		long long nCycle = 3 * (long long)m_nT;
+
+		/// delay part
+		size_t i = (size_t)std::min<long long>(std::max<long long>(nZeros - (long long)offset, 0), n);
+		std::fill(out, out + i, 0.0);
+		if (i == n)
+			return;
+
+		/// slope and its sample of the first non-zero output
+		long long nJ = nPos + (long long)(offset + i) - nZeros + 1;
+		int nS = nSign;
+		long long nLength = nCurrLength;
+		if (nJ > nCurrLength)
+		{
+			/// full rising and falling slopes follow the current one
+			nJ = (nJ - nCurrLength - 1) % nCycle + 1;
+			nS = -nSign;
+			if (nJ > GetSlopeLength(nS))
+			{
+				nJ -= GetSlopeLength(nS);
+				nS = nSign;
+			}
+			nLength = GetSlopeLength(nS);
+		}
+
+		/// fill slope by slope
+		while (i < n)
+		{
+			size_t nRun = (size_t)std::min<long long>(nLength - nJ + 1, (long long)(n - i));
+			CWaveKernels::Slope(out + i, nRun, nJ, m_nT, m_dA, nS);
+			i += nRun;
+			nS = -nS;
+			nJ = 1;
+			nLength = GetSlopeLength(nS);
+		}
 	}
 
 	/// @copydoc IGenerator::Reset()
@@ -44,6 +93,24 @@ public:
 		m_nI = 0;
     }
 
+    /// @copydoc IGenerator::Clone()
+    IGenerator* Clone() const override
+    {
+        return new CTriangleGen(*this);
+    }
+
+    /// @copydoc CGenerator::SetParameter(const std::string&, const std::vector<double>&)
+    bool SetParameter(const std::string& sKey, const std::vector<double>& vValue) override
+    {
+        if (vValue.size() == 1 && sKey == "A")
+            SetAmplitude(vValue[0]);
+        else if (vValue.size() == 1 && sKey == "T" && vValue[0] >= 1)
+            SetPeriod(static_cast<int>(vValue[0]));
+        else
+            return CGenerator::SetParameter(sKey, vValue);
+        return true;
+    }
+
     /// @copydoc CGenerator::LoadState(boost::property_tree::ptree::value_type const&)
 	void LoadState(boost::property_tree::ptree::value_type const& vParams)
 	{
@@ -52,12 +119,7 @@ public:
 		m_dA = vParams.second.get<double>("A");
 		m_nI = 0;
 		m_nSign = 1;
-#ifdef _DEBUG
-		std::cout << "\t----------\n" << "\tTriangleGen" << std::endl;
-		std::cout << "\tDelay: " << vParams.second.get<int>("Delay") << std::endl;
-		std::cout << "\tT: " << vParams.second.get<int>("T") << std::endl;
-		std::cout << "\tA: " << vParams.second.get<double>("A") << std::endl;
-#endif
+		SIM_LOG_DEBUG("TriangleGen " << m_sName << " Delay: " << m_nDelay << " T: " << m_nT << " A: " << m_dA);
 	}
 
     /// @copydoc CGenerator::SaveState(boost::property_tree::ptree&)
@@ -102,9 +164,63 @@ public:
         m_nSign = m_nSignBack;
     }
 
+    /// @copydoc IGenerator::GetSnapshotSize()
+    size_t GetSnapshotSize() const override
+    {
+        return CGenerator::GetSnapshotSize() + sizeof(m_nSign);
+    }
+
+    /// @copydoc IGenerator::SaveSnapshot(unsigned char*)
+    unsigned char* SaveSnapshot(unsigned char* p) const override
+    {
+        return PutSnapshot(CGenerator::SaveSnapshot(p), m_nSign);
+    }
+
+    /// @copydoc IGenerator::LoadSnapshot(const unsigned char*)
+    const unsigned char* LoadSnapshot(const unsigned char* p) override
+    {
+        return GetSnapshot(CGenerator::LoadSnapshot(p), m_nSign);
+    }
+
 	~CTriangleGen() {}
 
 private:
+    /// \brief Calculates next sample for the given state.
+    /// \param[in,out] nI Number of sample in a sequence.
+    /// \param[in,out] nSign Sign of the output slope.
+	double Step(int& nI, int& nSign) const
+	{
+		++nI;
+		/// calculating delay
+		if (m_nDelay >= nI)
+		{
+			return 0;
+        }
+
+		double dRetVal = GetValue(nI - m_nDelay, nSign);
+
+		if (dRetVal >= m_dA || dRetVal <= -1.0*m_dA)
+		{
+			nI = m_nDelay;
+			nSign *= -1;
+		}
+
+		return dRetVal;
+	}
+
+    /// \brief Returns output at the given sample of the slope.
+	double GetValue(long long nJ, int nSign) const
+	{
+		double dIoverT = nJ / (double) m_nT;
+		return nSign * m_dA * (dIoverT) + m_dA*(nSign - 1.0)*(-0.5);
+	}
+
+    /// \brief Returns number of samples of the slope with the given sign.
+	long long GetSlopeLength(int nSign) const
+	{
+		return nSign > 0 ? m_nT : 2 * (long long)m_nT;
+	}
+
     /// amplitude
     double m_dA;
     /// period in samples
@@ -0,0 +1,75 @@
+/** \class CWaveKernels
+* Block kernels calculating samples of periodic generators.
+*
+* \par
+* Sine samples are calculated with a polynomial approximation instead of sin():
+* the argument is reduced to [0, pi/2] and the Taylor series up to x^15 is used,
+* which keeps the absolute error below 1e-11 for amplitude 1. Loops contain no
+* branches, so the compiler can vectorise them.
+*
+* \par
+* Square and triangle waves are piecewise constant and piecewise linear, so they
+* are filled run by run - every run is a plain fill or a linear loop.
+*/
+
+#ifndef _CWAVEKERNELS
+#define _CWAVEKERNELS
+
+#include <cstddef>
+
+class CWaveKernels
+{
+public:
+    /// Guaranteed bound of |Sin(x) - sin(x)|.
+    static constexpr double SIN_MAX_ERROR = 1e-11;
+
+    /// \brief Polynomial sine approximation.
+    /// \param[in] dX Argument in radians, |dX| up to about 1e6.
+    static inline double Sin(double dX)
+    {
+        // x = q*pi/2 + y, pi/2 split into two parts to keep y accurate
+        const double dPio2Hi = 1.57079632673412561417e+00;
+        const double dPio2Lo = 6.07710050650619224932e-11;
+        const double dPio2 = 1.57079632679489661923;
+
+        // floor without a library call, the argument is far below 2^63
+        double dU = dX * (2.0 / 3.14159265358979323846);
+        long long nQ = (long long)dU;
+        nQ -= (double)nQ > dU;
+        double dQ = (double)nQ;
+        double dY = (dX - dQ*dPio2Hi) - dQ*dPio2Lo;
+
+        // odd quadrants use cos(y) = sin(pi/2 - y), the two upper ones are negative
+        double x = (nQ & 1) ? dPio2 - dY : dY;
+        double dSign = 1.0 - (double)(nQ & 2);
+
+        // Taylor series of sin(x) up to x^15
+        double x2 = x*x;
+        double p = -1.0/1307674368000.0;
+        p = p*x2 + 1.0/6227020800.0;
+        p = p*x2 - 1.0/39916800.0;
+        p = p*x2 + 1.0/362880.0;
+        p = p*x2 - 1.0/5040.0;
+        p = p*x2 + 1.0/120.0;
+        p = p*x2 - 1.0/6.0;
+        p = p*x2 + 1.0;
+        return dSign*x*p;
+    }
+
+    /// \brief Fills out[i] = dA*Sin(dFullAngle*(nFirst + i)/dT).
+    /// \param[out] out Buffer for n samples.
+    /// \param[in] n Number of samples.
+    /// \param[in] nFirst Number of the first sample.
+    /// \param[in] dFullAngle Angle of one period.
+    /// \param[in] dT Period in samples.
+    /// \param[in] dA Amplitude.
+    static void Sine(double* out, size_t n, long long nFirst, double dFullAngle, double dT, double dA);
+
+    /// \brief Fills out with runs of alternating sign: nFirstRun samples of dFirst, then nRun samples of -dFirst and so on.
+    static void Square(double* out, size_t n, size_t nFirstRun, size_t nRun, double dFirst);
+
+    /// \brief Fills out[i] = nSign*dA*((nJ + i)/dT) + dA*(nSign - 1)*(-0.5) - a single slope of the triangle wave.
+    static void Slope(double* out, size_t n, long long nJ, double dT, double dA, int nSign);
+};
+
+#endif
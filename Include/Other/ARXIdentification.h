@@ -1,6 +1,7 @@
 #ifndef _CARXIDENTIFICATION
 #define _CARXIDENTIFICATION
 
+#include <cstddef>
 #include <vector>
 #include <Eigen/Dense>
 #include <mutex>
@@ -64,6 +65,15 @@ public:
 
     void Update(); /// \brief This method updates the fi vector, the theta vector and the P matrix.
 
+    size_t GetSnapshotSize() const; /// \brief This method returns the number of bytes written by SaveSnapshot().
+    unsigned char* SaveSnapshot(unsigned char*) const; /// \brief This method copies the whole state, with the degrees and settings, to the buffer.
+    ///\param[out] p This is the buffer of at least GetSnapshotSize() bytes.
+    ///\return Pointer past the written data.
+    const unsigned char* LoadSnapshot(const unsigned char*, const unsigned char*); /// \brief This method restores the state written by SaveSnapshot(), the degrees may differ from the current ones.
+    ///\param[in] p This is the beginning of the data.
+    ///\param[in] pEnd This is the end of the buffer, data reaching past it are reported by throwing std::string.
+    ///\return Pointer past the read data.
+
 private:
     std::vector<double> CreateTheta();
     void UpdateFi();
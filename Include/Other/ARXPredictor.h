@@ -0,0 +1,63 @@
+/** \class CARXPredictor
+ * Predicts future outputs of an ARX model directly from the difference equation
+ *
+ * y(n) = b0*u(n-k) + ... + bm*u(n-k-m) - a0*y(n-1) - ... - ap*y(n-1-p)
+ *
+ * reading past samples straight from CHistorian objects.
+ *
+ * \par
+ * The prediction gives exactly the same results as simulating a CSimObject whose
+ * histories were replaced with the given ones, including the limited length
+ * of these histories, but does not copy them nor allocate memory once the
+ * workspace has grown to the number of predicted steps.
+ */
+
+#ifndef _CARXPREDICTOR
+#define _CARXPREDICTOR
+
+#include <vector>
+#include "Historian.h"
+
+class CARXPredictor
+{
+public:
+    CARXPredictor() {}
+
+    /// \brief Predicts free response - output for the input kept at its last value.
+    /// \param[in] vA Denominator (a) coefficients.
+    /// \param[in] vB Nominator (b) coefficients.
+    /// \param[in] nK Delay in samples.
+    /// \param[in] InputHistory Past inputs, newest first.
+    /// \param[in] OutputHistory Past outputs, newest first.
+    /// \param[in] nH Number of samples to return. First nK predicted samples are skipped.
+    /// \param[out] pOut Buffer for nH samples.
+    void FreeResponse(const std::vector<double>& vA, const std::vector<double>& vB, int nK,
+                      const CHistorian& InputHistory, const CHistorian& OutputHistory,
+                      int nH, double* pOut);
+
+    /// \brief Predicts response to the given future input.
+    /// \param[in] vA Denominator (a) coefficients.
+    /// \param[in] vB Nominator (b) coefficients.
+    /// \param[in] nK Delay in samples.
+    /// \param[in] InputHistory Past inputs, newest first.
+    /// \param[in] OutputHistory Past outputs, newest first.
+    /// \param[in] pInput nH future input samples, oldest first.
+    /// \param[in] nH Number of samples to predict.
+    /// \param[out] pOut Buffer for nH samples.
+    void ForcedResponse(const std::vector<double>& vA, const std::vector<double>& vB, int nK,
+                        const CHistorian& InputHistory, const CHistorian& OutputHistory,
+                        const double* pInput, int nH, double* pOut);
+
+private:
+    /// \brief Runs the difference equation for nSkip + nOut steps.
+    /// \param[in] pInput Future inputs, input of step n is pInput[n*nStride].
+    /// \param[in] nStride Stride of the future inputs, 0 for constant input.
+    void Predict(const std::vector<double>& vA, const std::vector<double>& vB, int nK,
+                 const CHistorian& InputHistory, const CHistorian& OutputHistory,
+                 const double* pInput, int nStride, int nSkip, int nOut, double* pOut);
+
+    /// Predicted outputs, oldest first.
+    std::vector<double> m_vPred;
+};
+
+#endif
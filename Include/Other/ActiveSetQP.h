@@ -0,0 +1,128 @@
+/** \class CActiveSetQP
+ * Small dense quadratic programming solver
+ *
+ * min 1/2 x'Hx + f'x  subject to  A x <= b
+ *
+ * for a positive definite H, using the primal active-set method.
+ *
+ * \par
+ * The solver is meant to be called once per sampling period with the same H and
+ * slowly changing f and b. H is factorised once by SetHessian(). Every Solve()
+ * first checks the unconstrained optimum, which is the typical case and costs no
+ * iterations. Otherwise it starts from the given point and working set - usually
+ * the previous solution and active set shifted by one sample - so only a few
+ * iterations are needed when the active constraints do not change.
+ *
+ * \par
+ * The leading nHard rows of A are hard, eg. actuator limits, the others soft, eg. output
+ * limits that may be out of reach. The caller passes a starting point satisfying the hard
+ * rows. Soft constraints violated at the starting point are relaxed - ignored until the
+ * next call - so the solver always returns a point feasible for the remaining ones. Hard
+ * rows are relaxed the same way only if the starting point violates them as well.
+ *
+ * \note
+ * Uses Eigen-Eigen matrix and vector mathematics library.
+ */
+
+#ifndef _CACTIVESETQP
+#define _CACTIVESETQP
+
+#include <vector>
+#include "Eigen/Dense"
+
+class CActiveSetQP
+{
+public:
+    CActiveSetQP();
+
+    /// \brief Sets and factorises the Hessian.
+    /// \param[in] mH Positive definite n x n matrix.
+    void SetHessian(const Eigen::MatrixXd& mH);
+
+    /// \brief Solves the problem for the Hessian set with SetHessian().
+    /// \param[in] vF Linear term, size n.
+    /// \param[in] mA Constraint matrix, m x n.
+    /// \param[in] vB Constraint bounds, size m.
+    /// \param[in,out] vX Starting point on input, solution on output. Zero vector is used if it has wrong size.
+    /// \param[in,out] vWorking Indices of constraints expected to be active on input, active set of the solution on output.
+    /// \param[in] nHard Number of the leading rows of mA the starting point satisfies, which are kept.
+    /// The zero vector is used instead of the starting point only if it violates fewer of them.
+    /// \return False if the iteration limit was reached, the best point found is returned anyway.
+    bool Solve(const Eigen::VectorXd& vF, const Eigen::MatrixXd& mA, const Eigen::VectorXd& vB,
+               Eigen::VectorXd& vX, std::vector<int>& vWorking, int nHard = 0);
+
+    /// \brief Returns the number of iterations of the last Solve() call.
+    int GetLastIterations() const
+    {
+        return m_nLastIterations;
+    }
+
+    /// \brief Returns the number of constraints relaxed in the last Solve() call.
+    int GetLastRelaxed() const
+    {
+        return m_nLastRelaxed;
+    }
+
+    /// \brief Sets iteration limit of a single Solve() call.
+    void SetMaxIterations(int nMaxIterations)
+    {
+        m_nMaxIterations = nMaxIterations;
+    }
+
+private:
+    /// \brief Solves the equality constrained subproblem for the working set.
+    /// Calculates step m_vP from point with gradient vG and multipliers m_vLambda.
+    /// \return False if the working set constraints are linearly dependent.
+    bool SolveSubproblem(const Eigen::VectorXd& vG, const Eigen::MatrixXd& mA);
+
+    /// \brief Counts constraints violated at vX.
+    /// \param[in] nHard Number of the leading hard rows.
+    /// \param[out] nHardViolated Number of the violated hard rows.
+    /// \return Number of all the violated rows.
+    int CountViolated(const Eigen::MatrixXd& mA, const Eigen::VectorXd& vB, const Eigen::VectorXd& vX,
+                      int nHard, int& nHardViolated);
+
+    /// Factorisation of the Hessian.
+    Eigen::LLT<Eigen::MatrixXd> m_HLLT;
+    /// The Hessian.
+    Eigen::MatrixXd m_mH;
+
+    /// Constraint indices in the working set.
+    std::vector<int> m_vWorking;
+    /// Is the constraint in the working set?
+    std::vector<char> m_vInWorking;
+    /// Is the constraint relaxed?
+    std::vector<char> m_vRelaxed;
+    /// Is the constraint kept out of the working set as linearly dependent on it?
+    std::vector<char> m_vDependent;
+
+    /// Working set constraint rows.
+    Eigen::MatrixXd m_mAW;
+    /// H^-1 AW'.
+    Eigen::MatrixXd m_mHiAW;
+    /// AW H^-1 AW'.
+    Eigen::MatrixXd m_mS;
+    /// Factorisation of m_mS.
+    Eigen::LDLT<Eigen::MatrixXd> m_SLDLT;
+    /// Gradient at the current point.
+    Eigen::VectorXd m_vG;
+    /// H^-1 g.
+    Eigen::VectorXd m_vHiG;
+    /// Step.
+    Eigen::VectorXd m_vP;
+    /// Working set multipliers.
+    Eigen::VectorXd m_vLambda;
+    /// Constraint values.
+    Eigen::VectorXd m_vAx;
+    /// Current point.
+    Eigen::VectorXd m_vX;
+
+    /// Iterations of the last call.
+    int m_nLastIterations;
+    /// Relaxed constraints of the last call.
+    int m_nLastRelaxed;
+    /// Iteration limit.
+    int m_nMaxIterations;
+};
+
+#endif
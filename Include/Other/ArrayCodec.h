@@ -0,0 +1,81 @@
+/** \class CArrayCodec
+ * Exact and fast conversion of number arrays stored in chain files.
+ *
+ * \par
+ * Arrays are written as text with the shortest digits that read back to the same double,
+ * separated by spaces. Arrays of at least GetBinaryThreshold() elements are written as
+ * base64 of the little-endian IEEE doubles instead, marked with an attribute:
+ * \code
+ * <VectorB>0.3 0.1</VectorB>
+ * <VectorB Encoding="base64">MzMzMzMz0z+amZmZmZm5Pw==</VectorB>
+ * \endcode
+ *
+ * \par
+ * Parsing counts the numbers first, so the array is allocated once, and reads them in
+ * place without copying substrings. Any white space separates numbers in text, it is
+ * ignored in base64.
+ */
+
+#ifndef _CARRAYCODEC
+#define _CARRAYCODEC
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "boost\property_tree\ptree.hpp"
+
+class CArrayCodec
+{
+public:
+    /// \brief Formats the array as text with the shortest exact digits.
+    /// \param[in] v Array to format.
+    /// \param[out] s Numbers separated by spaces.
+    static void Format(const std::vector<double>& v, std::string& s);
+
+    /// \brief Parses numbers separated by white space.
+    /// \param[in] pFirst First character.
+    /// \param[in] pLast Character after the last one.
+    /// \param[out] v Parsed numbers, empty on error.
+    /// \return False if a number is malformed or out of range.
+    static bool Parse(const char* pFirst, const char* pLast, std::vector<double>& v);
+
+    /// \brief Encodes the array as base64 of the little-endian doubles.
+    static void EncodeBase64(const std::vector<double>& v, std::string& s);
+
+    /// \brief Decodes the array from base64 of the little-endian doubles.
+    /// \return False if the text is not base64 or not a whole number of doubles, v is empty then.
+    static bool DecodeBase64(const char* pFirst, const char* pLast, std::vector<double>& v);
+
+    /// \brief Stores the array as a child of the node, as text or base64 by its length.
+    /// \param[in,out] node Node to add the child to.
+    /// \param[in] sKey Path of the child.
+    /// \param[in] v Array to store.
+    static void Put(boost::property_tree::ptree& node, const std::string& sKey, const std::vector<double>& v);
+
+    /// \brief Reads the array stored by Put() or written by hand as text.
+    /// \param[in] node Node with the child.
+    /// \param[in] sKey Path of the child.
+    /// \param[out] v Array read.
+    /// \throw std::string if the array is malformed, ptree_bad_path if it is missing.
+    static void Get(const boost::property_tree::ptree& node, const std::string& sKey, std::vector<double>& v);
+
+    /// \brief Sets the length from which Put() stores arrays as base64.
+    /// \param[in] nLength Number of elements, 0 stores all arrays as text.
+    static void SetBinaryThreshold(size_t nLength)
+    {
+        m_nBinaryThreshold = nLength;
+    }
+
+    /// \brief Returns the length from which Put() stores arrays as base64, 0 if never.
+    static size_t GetBinaryThreshold()
+    {
+        return m_nBinaryThreshold;
+    }
+
+private:
+    /// length from which arrays are stored as base64
+    static std::atomic<size_t> m_nBinaryThreshold;
+};
+
+#endif
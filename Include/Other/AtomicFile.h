@@ -0,0 +1,26 @@
+/** \class CAtomicFile
+ * Replacing of files so a reader sees either the old or the new complete file.
+ *
+ * \par
+ * A file is written under a temporary name first and then renamed over the target.
+ * The rename replaces an existing target in a single step - rename() on POSIX,
+ * MoveFileEx() with MOVEFILE_REPLACE_EXISTING on Windows - so the previous file is
+ * never deleted before the new one takes its place.
+ */
+
+#ifndef _CATOMICFILE
+#define _CATOMICFILE
+
+#include <string>
+
+class CAtomicFile
+{
+public:
+    /// \brief Renames the temporary file over the target, replacing an existing one.
+    /// \param[in] sTempName Complete file written under a temporary name, deleted if it cannot be renamed.
+    /// \param[in] sFileName Target file, kept unchanged on error.
+    /// \return False if the file could not be renamed.
+    static bool Replace(const std::string& sTempName, const std::string& sFileName);
+};
+
+#endif
@@ -0,0 +1,146 @@
+/** \class CChainIndex
+ * Index of the objects of a chain file - names, parents, types and byte ranges of their elements.
+ *
+ * \par
+ * The index lets a session create only the objects it needs, see CSimSession::OpenChain().
+ * Building it reads the whole file once, without creating any object. The index is
+ * cached in a binary file next to the chain file, named like the chain file with
+ * ".idx" appended. The cache is used while the size and the modification time of the
+ * chain file are the same as when it was indexed, it is rebuilt otherwise.
+ *
+ * \par
+ * Parents are resolved the same way as by CSimSession::LoadChain() - to the first object
+ * of the name written before the child. Objects whose parent is not found are indexed,
+ * but cannot be created.
+ *
+ * \par
+ * Cache layout, all values in the byte order of the machine that wrote it:
+ * \code
+ * "SIMX", version, byte order mark, 0           4 x uint32
+ * size and modification time of the chain file  2 x uint64
+ * number of objects, size of the names          2 x uint64
+ * objects: offset, length, parent, line, type,
+ * number of generators                          3 x uint64, 3 x uint32, padding
+ * names: name of the object and its generators  uint32 length and characters each
+ * \endcode
+ */
+
+#ifndef _CCHAININDEX
+#define _CCHAININDEX
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class CChainIndex
+{
+public:
+    /// Parent of an object describing the root of the chain.
+    static const size_t ROOT = static_cast<size_t>(-1);
+    /// Parent of an object whose parent is not found.
+    static const size_t NONE = static_cast<size_t>(-2);
+
+    /// Indexed object.
+    struct SEntry
+    {
+        /// Name of the object in the file.
+        std::string sName;
+        /// Names of the generators of a regulator, without operands of the generators.
+        std::vector<std::string> vGenerators;
+        /// Object of the parent, ROOT or NONE.
+        size_t nParent;
+        /// Offset of the element in the file.
+        uint64_t nOffset;
+        /// Length of the element in bytes.
+        uint64_t nLength;
+        /// Line of the element start.
+        int nLine;
+        /// Type of the object, see ObjType, 0 if not written.
+        int nType;
+    };
+
+    CChainIndex();
+
+    /// \brief Indexes the chain file, with the cache if it is up to date.
+    /// An outdated or missing cache is written again, a cache that cannot be written is skipped.
+    /// \param[in] sFileName Chain file.
+    /// \throw std::string if the chain file cannot be read or is malformed.
+    void Open(const std::string& sFileName);
+
+    /// \brief Returns the indexed chain file.
+    const std::string& GetFileName() const
+    {
+        return m_sFileName;
+    }
+
+    /// \brief Checks if the chain file is the same as when it was indexed.
+    bool IsCurrent() const;
+
+    /// \brief Returns number of the indexed objects.
+    size_t GetSize() const
+    {
+        return m_vEntries.size();
+    }
+
+    /// \brief Returns the indexed object.
+    const SEntry& GetEntry(size_t nEntry) const
+    {
+        return m_vEntries[nEntry];
+    }
+
+    /// \brief Returns children of the object in the order of the file.
+    const std::vector<size_t>& GetChildren(size_t nEntry) const
+    {
+        return m_vChildren[nEntry];
+    }
+
+    /// \brief Finds the first object of the name, or the regulator with the generator of the name.
+    /// \return Index of the object, NONE if not found.
+    size_t Find(const std::string& sName) const;
+
+    /// \brief Reads the element of the object from the chain file.
+    /// \param[in] is Stream of the chain file.
+    /// \param[in] nEntry Object to read.
+    /// \param[out] sElement Text of the element.
+    /// \return False if the element cannot be read.
+    bool ReadElement(std::istream& is, size_t nEntry, std::string& sElement) const;
+
+private:
+    /// \brief Indexes the chain file by reading it.
+    void Build();
+
+    /// \brief Reads the cache.
+    /// \return False if it is missing, malformed or outdated.
+    bool Load(const std::string& sCacheName);
+
+    /// \brief Writes the cache.
+    /// \return False if it cannot be written.
+    bool Save(const std::string& sCacheName) const;
+
+    /// \brief Builds children lists and the name lookup from the entries.
+    void Link();
+
+    /// \brief Reads size and modification time of the chain file.
+    /// \return False if the file does not exist.
+    bool Stat(uint64_t& nSize, uint64_t& nTime) const;
+
+    /// indexed chain file
+    std::string m_sFileName;
+    /// size of the chain file when indexed
+    uint64_t m_nFileSize;
+    /// modification time of the chain file when indexed
+    uint64_t m_nFileTime;
+    /// indexed objects in the order of the file
+    std::vector<SEntry> m_vEntries;
+    /// children of every object
+    std::vector<std::vector<size_t> > m_vChildren;
+    /// first object of every name
+    std::unordered_map<std::string, size_t> m_Names;
+    /// regulator of every generator name
+    std::unordered_map<std::string, size_t> m_Generators;
+};
+
+#endif
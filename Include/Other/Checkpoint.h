@@ -0,0 +1,186 @@
+/** \class CCheckpoint
+ * Complete state of a simulation session in a versioned binary file.
+ *
+ * \par
+ * A checkpoint holds the chain file with the current parameters, the snapshot of the
+ * dynamic state of the chain (histories, generator positions, integrators, see
+ * ISISO::SaveSnapshot()), the state of the identification with its P matrix and theta,
+ * the last published model and the last values of the simulation loop. It is taken by
+ * CSimSession::TakeCheckpoint() and applied by CSimSession::RestoreCheckpoint().
+ *
+ * \par
+ * Taking a checkpoint only copies the state, the chain file is formatted and the file
+ * is written afterwards, typically in the background with SaveAsync(). The file is
+ * written under a temporary name and renamed when complete, so an existing checkpoint
+ * is never replaced by a partial one. Open() maps the file into memory and checks the
+ * hash of its sections, so a damaged file is refused. The state is copied into the chain
+ * straight from the mapping.
+ *
+ * \par
+ * File layout, all values in the byte order of the machine that wrote them:
+ * \code
+ * "SIMC", version, byte order mark, flags       4 x uint32
+ * last output, regulator input and output,
+ * object input and output                       5 x double
+ * sizes of the sections                         5 x uint64
+ * hash of the sections, see Hash()              uint64
+ * chain XML, state, identification,
+ * nominator, denominator                        sections, each aligned to 8 bytes
+ * \endcode
+ */
+
+#ifndef _CCHECKPOINT
+#define _CCHECKPOINT
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include "boost\property_tree\ptree.hpp"
+#include "boost\interprocess\file_mapping.hpp"
+#include "boost\interprocess\mapped_region.hpp"
+
+class CCheckpoint
+{
+public:
+    /// Last values of the simulation loop.
+    struct SLoopState
+    {
+        /// Is the identification linked with the chain?
+        bool bPrepared;
+        /// Last output of the chain.
+        double dLastSimVal;
+        /// Last input and output of the regulator.
+        double dRegInVal;
+        double dRegOutVal;
+        /// Last input and output of the identified object.
+        double dObjInVal;
+        double dObjOutVal;
+    };
+
+    /// Dynamic state of a session, the buffers are reused by repeated captures.
+    struct SState
+    {
+        /// Last values of the simulation loop.
+        SLoopState Loop;
+        /// Snapshot of the chain state, see ISISO::SaveSnapshot().
+        std::vector<unsigned char> vState;
+        /// Snapshot of the identification.
+        std::vector<unsigned char> vIdentification;
+        /// Nominator and denominator of the last published model.
+        std::vector<double> vNom;
+        std::vector<double> vDenom;
+    };
+
+    /// \brief Creates an empty checkpoint.
+    CCheckpoint();
+
+    /// \brief Exchanges the state of the checkpoint with the given one, the chain is kept.
+    /// \param[in,out] State State to put into the checkpoint, receives the previous one.
+    void SwapState(SState& State);
+
+    /// \brief Copies the state of the checkpoint, eg. of a mapped file.
+    /// \param[out] State State to copy to, its buffers are reused.
+    void GetState(SState& State) const;
+
+    /// \brief Stores the chain with its current parameters as an XML chain file.
+    /// \param[in] Chain Tree written by CSimSession::SaveChain().
+    void SetChain(const boost::property_tree::ptree& Chain);
+
+    /// \brief Writes the checkpoint to a binary file.
+    /// \return False if the file could not be written, the previous file is kept then.
+    bool Save(const std::string& sFileName) const;
+
+    /// \brief Writes the checkpoint to a binary file in a background thread.
+    /// The thread keeps the checkpoint alive, the future may be dropped.
+    /// \param[in] Checkpoint Checkpoint to write.
+    /// \param[in] sFileName File to write.
+    /// \param[in] Chain Chain to store with SetChain() before writing, nullptr if it is set already.
+    /// \return Result of Save().
+    static std::future<bool> SaveAsync(std::shared_ptr<CCheckpoint> Checkpoint, const std::string& sFileName,
+                                       std::shared_ptr<const boost::property_tree::ptree> Chain = nullptr);
+
+    /// \brief Maps a checkpoint file into memory.
+    /// \return False if the file could not be mapped, is not a valid checkpoint of this version
+    /// or its sections do not match the stored hash.
+    bool Open(const std::string& sFileName);
+
+    /// \brief Returns last values of the simulation loop.
+    const SLoopState& GetLoopState() const
+    {
+        return m_State.Loop;
+    }
+
+    /// \brief Returns chain file with the parameters at the time of the checkpoint.
+    std::string GetChain() const
+    {
+        return std::string(reinterpret_cast<const char*>(m_pChain), m_nChainSize);
+    }
+
+    /// \brief Returns snapshot of the chain state.
+    const unsigned char* GetState() const
+    {
+        return m_pState;
+    }
+
+    /// \brief Returns size of the chain state snapshot in bytes.
+    size_t GetStateSize() const
+    {
+        return m_nStateSize;
+    }
+
+    /// \brief Returns snapshot of the identification.
+    const unsigned char* GetIdentification() const
+    {
+        return m_pIdentification;
+    }
+
+    /// \brief Returns size of the identification snapshot in bytes.
+    size_t GetIdentificationSize() const
+    {
+        return m_nIdentificationSize;
+    }
+
+    /// \brief Returns the last published model, empty if none was published.
+    void GetModel(std::vector<double>& vNom, std::vector<double>& vDenom) const;
+
+    /// Hash of no data, see Hash().
+    static const uint64_t HASH_BASIS = 14695981039346656037ULL;
+
+    /// \brief Returns FNV-1a hash of the data taken by 8 byte words.
+    /// \param[in] pData Data to hash.
+    /// \param[in] nSize Size of the data in bytes.
+    /// \param[in] nHash Hash of the data before, to hash several blocks as one.
+    static uint64_t Hash(const void* pData, size_t nSize, uint64_t nHash = HASH_BASIS);
+
+private:
+    CCheckpoint(const CCheckpoint&);
+    CCheckpoint& operator=(const CCheckpoint&);
+
+    /// \brief Points the sections to the owned buffers.
+    void PointToOwned();
+
+    /// sections built in memory
+    std::string m_sChain;
+    SState m_State;
+
+    /// mapped file
+    boost::interprocess::file_mapping m_File;
+    boost::interprocess::mapped_region m_Region;
+
+    /// sections, in the owned buffers or in the mapped file
+    const unsigned char* m_pChain;
+    size_t m_nChainSize;
+    const unsigned char* m_pState;
+    size_t m_nStateSize;
+    const unsigned char* m_pIdentification;
+    size_t m_nIdentificationSize;
+    const double* m_pNom;
+    size_t m_nNomSize;
+    const double* m_pDenom;
+    size_t m_nDenomSize;
+};
+
+#endif
@@ -0,0 +1,86 @@
+/** \class CCounterRNG
+ * Counter-based random number generator - Philox4x32-10.
+ *
+ * \par
+ * Every sample is a pure function of the key (the seed of the session), the stream
+ * (for example node ID and its own seed) and the sample index, so any sample can be
+ * regenerated on its own, in any order and in any thread. The generator keeps no
+ * state besides its key and stream.
+ *
+ * \par
+ * Gaussian samples use the Box-Muller transform of the two uniform values from
+ * the same counter, so they are random-access as well.
+ */
+
+#ifndef _CCOUNTERRNG
+#define _CCOUNTERRNG
+
+#include <cstddef>
+#include <cstdint>
+
+class CCounterRNG
+{
+public:
+    /// \brief Creates generator of the given stream.
+    /// \param[in] nKey Key, the seed of the session the samples belong to.
+    /// \param[in] nStream Stream identifier, eg. node ID combined with its seed.
+    CCounterRNG(uint64_t nKey, uint64_t nStream);
+
+    /// \brief Calculates four random words for the sample index.
+    void Generate(uint64_t nIndex, uint32_t out[4]) const
+    {
+        uint32_t c[4] = { uint32_t(nIndex), uint32_t(nIndex >> 32), uint32_t(m_nStream), uint32_t(m_nStream >> 32) };
+        uint32_t k0 = m_nKey[0];
+        uint32_t k1 = m_nKey[1];
+
+        for (int r = 0; r < 10; ++r)
+        {
+            uint64_t p0 = uint64_t(0xD2511F53u) * c[0];
+            uint64_t p1 = uint64_t(0xCD9E8D57u) * c[2];
+            uint32_t n0 = uint32_t(p1 >> 32) ^ c[1] ^ k0;
+            uint32_t n2 = uint32_t(p0 >> 32) ^ c[3] ^ k1;
+            c[0] = n0;
+            c[1] = uint32_t(p1);
+            c[2] = n2;
+            c[3] = uint32_t(p0);
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+
+        out[0] = c[0];
+        out[1] = c[1];
+        out[2] = c[2];
+        out[3] = c[3];
+    }
+
+    /// \brief Returns uniformly distributed sample in <0,1).
+    double Uniform(uint64_t nIndex) const
+    {
+        uint32_t w[4];
+        Generate(nIndex, w);
+        return ToUnit(w[0], w[1]);
+    }
+
+    /// \brief Returns sample of the standard normal distribution.
+    double Gaussian(uint64_t nIndex) const;
+
+    /// \brief Fills out[i] = Uniform(nFirst + i).
+    void FillUniform(double* out, size_t n, uint64_t nFirst) const;
+
+    /// \brief Fills out[i] = Gaussian(nFirst + i).
+    void FillGaussian(double* out, size_t n, uint64_t nFirst) const;
+
+private:
+    /// \brief Maps two words to <0,1) with 53 bits of resolution.
+    static double ToUnit(uint32_t nHi, uint32_t nLo)
+    {
+        return ((uint64_t(nHi) << 21) ^ (nLo >> 11)) * (1.0 / 9007199254740992.0);
+    }
+
+    /// Philox key.
+    uint32_t m_nKey[2];
+    /// Stream identifier, upper half of the counter.
+    uint64_t m_nStream;
+};
+
+#endif
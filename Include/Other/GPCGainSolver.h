@@ -0,0 +1,49 @@
+/** \class CGPCGainSolver
+ * Calculates GPC gain vector - the first row of (G'G + roI)^-1 G', where G is
+ * the H x L dynamic matrix built from the plant step response.
+ *
+ * \par
+ * The inverse is never formed. Only the first row is needed, so the solver
+ * factorises M = G'G + roI with LDLT, solves M x = e1 and returns q = G x.
+ * Horizons up to MAX_FIXED use matrices with the number of rows fixed at
+ * compile time and stack storage, larger ones reuse workspace kept between calls.
+ *
+ * \note
+ * Uses Eigen-Eigen matrix and vector mathematics library.
+ */
+
+#ifndef _CGPCGAINSOLVER
+#define _CGPCGAINSOLVER
+
+#include "Eigen/Dense"
+
+class CGPCGainSolver
+{
+public:
+    /// Largest H and L handled with fixed-size matrices.
+    static const int MAX_FIXED = 8;
+
+    CGPCGainSolver() {}
+
+    /// \brief Calculates the gain vector.
+    /// \param[in] pStep Step response samples s(1)..s(nH).
+    /// \param[in] nH Prediction horizon.
+    /// \param[in] nL Control horizon.
+    /// \param[in] dRO Control increment weight.
+    /// \param[out] vQ Gain vector of size nH.
+    void Solve(const double* pStep, int nH, int nL, double dRO, Eigen::VectorXd& vQ);
+
+private:
+    /// Dynamic matrix workspace.
+    Eigen::MatrixXd m_mG;
+    /// G'G + roI workspace.
+    Eigen::MatrixXd m_mM;
+    /// Factorisation of m_mM.
+    Eigen::LDLT<Eigen::MatrixXd> m_LDLT;
+    /// Unit vector e1.
+    Eigen::VectorXd m_vE;
+    /// Solution of M x = e1.
+    Eigen::VectorXd m_vX;
+};
+
+#endif
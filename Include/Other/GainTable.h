@@ -0,0 +1,132 @@
+/** \class CGainTable
+ * Table of GPC gain vectors precomputed on a grid of ARX model coefficients.
+ *
+ * \par
+ * Every coefficient of the model - denominator (a) ones first, then the nominator (b)
+ * ones - has its own axis with equally spaced points. For every point of the grid and
+ * every (L, H, RO) setting the table stores the gain vector calculated the same way
+ * as CGPC does online. At runtime gains are multilinearly interpolated between the
+ * 2^n surrounding grid points, n being the number of coefficients.
+ *
+ * \par
+ * The table is built offline with Build(), which splits the grid between threads,
+ * and stored in a binary file:
+ * - "GPCT" tag and format version (uint32),
+ * - number of a and b coefficients (uint32 each),
+ * - every axis as minimum, maximum (double) and number of points (uint32),
+ * - number of settings (uint32) and every setting as L, H (int32) and RO (double),
+ * - gain vectors of the first setting for every grid point, the last axis changing
+ *   fastest, then the ones of the following settings.
+ *
+ * Values are written in the native byte order.
+ */
+
+#ifndef _CGAINTABLE
+#define _CGAINTABLE
+
+#include <string>
+#include <vector>
+
+class CGainTable
+{
+public:
+    /// Grid axis of a single model coefficient.
+    struct SAxis
+    {
+        /// First grid point.
+        double dMin;
+        /// Last grid point.
+        double dMax;
+        /// Number of points, 1 fixes the coefficient at dMin.
+        unsigned int nPoints;
+    };
+
+    /// GPC setting the gains are calculated for.
+    struct SSetting
+    {
+        /// Control horizon.
+        int nL;
+        /// Prediction horizon.
+        int nH;
+        /// Control increment weight.
+        double dRO;
+    };
+
+    /// Largest number of model coefficients.
+    static const unsigned int MAX_AXES = 16;
+
+    CGainTable();
+
+    /// \brief Sets the grid and discards calculated gains.
+    /// \param[in] vAAxes Axes of the denominator coefficients.
+    /// \param[in] vBAxes Axes of the nominator coefficients.
+    /// \throw std::string if there are too many axes, or an axis has no points or an empty range.
+    void SetGrid(const std::vector<SAxis>& vAAxes, const std::vector<SAxis>& vBAxes);
+
+    /// \brief Adds a setting to calculate gains for and discards calculated gains.
+    void AddSetting(int nL, int nH, double dRO);
+
+    /// \brief Calculates gain vectors for every grid point and setting.
+    /// \param[in] nThreads Number of threads, 0 uses all available cores.
+    void Build(unsigned int nThreads = 0);
+
+    /// \brief Writes the table to a binary file.
+    /// \return False if the file could not be written.
+    bool Save(const std::string& sFileName) const;
+
+    /// \brief Reads the table from a binary file.
+    /// \return False if the file could not be read or is not a valid table. The table is left empty then.
+    bool Load(const std::string& sFileName);
+
+    /// \brief Interpolates the gain vector for the given model and setting.
+    /// \param[in] vA Denominator coefficients.
+    /// \param[in] vB Nominator coefficients.
+    /// \param[in] nL Control horizon.
+    /// \param[in] nH Prediction horizon.
+    /// \param[in] dRO Control increment weight.
+    /// \param[out] pQ Buffer for nH gains.
+    /// \return False if the setting is not in the table or the model lies outside of the grid.
+    bool Interpolate(const std::vector<double>& vA, const std::vector<double>& vB,
+                     int nL, int nH, double dRO, double* pQ) const;
+
+    /// \brief Calculates nH samples of the unit step response of an ARX model without delay.
+    /// Gives exactly the same values as CSimObject::Simulate(1) called nH times after a reset.
+    static void StepResponse(const std::vector<double>& vA, const std::vector<double>& vB,
+                             int nH, double* pOut);
+
+    /// \brief Returns the number of grid points.
+    size_t GetNumOfPoints() const
+    {
+        return m_nPoints;
+    }
+
+    /// \brief Returns true if gains are calculated or loaded.
+    bool IsBuilt() const
+    {
+        return !m_vGains.empty();
+    }
+
+private:
+    /// \brief Recalculates grid size and offsets of the settings.
+    void UpdateLayout();
+
+    /// \brief Returns model coefficients at the grid point.
+    void GetPointModel(size_t nPoint, std::vector<double>& vA, std::vector<double>& vB) const;
+
+    /// Number of denominator coefficients.
+    unsigned int m_nA;
+    /// Number of nominator coefficients.
+    unsigned int m_nB;
+    /// Axes of all the coefficients.
+    std::vector<SAxis> m_vAxes;
+    /// Settings stored.
+    std::vector<SSetting> m_vSettings;
+    /// Offset of every setting gains in m_vGains.
+    std::vector<size_t> m_vOffset;
+    /// Number of grid points.
+    size_t m_nPoints;
+    /// Gain vectors.
+    std::vector<double> m_vGains;
+};
+
+#endif
@@ -2,10 +2,13 @@
  * Handles storing and dispensing given amount of samples.
  *
  * \par
- * Using double-ended queue internally to ensure high performance when adding and retrieving samples.
+ * Samples are kept in a ring buffer of fixed capacity, so adding a sample does not
+ * allocate and the whole state of the historian is a plain block of memory which
+ * can be copied to a snapshot, see CStateArena. The buffer can be taken from the
+ * arena of the owning node, see CNodeArena.
 */
 
-#include <deque>
+#include "NodeArena.h"
 #include <memory>
 #include <vector>
 
@@ -21,12 +24,17 @@ class CHistorian
 public:
     /// \brief Constructs historian object.
     /// \param[in] nMaxSamples Maximum samples to store.
-    CHistorian(int nMaxSamples = 10) : m_nMaxSamples(nMaxSamples), m_nSamplesStored(0){}
+    CHistorian(int nMaxSamples = 10) : m_nMaxSamples(nMaxSamples), m_nSamplesStored(0),
+        m_nHead(0), m_nCount(0), m_vSamples(nMaxSamples, 0.0) {}
 
     /// \brief Sets maximum samples stored.
     /// \param[in] nMaxSamples Maximum samples to store.
     void SetMaxSamples(unsigned int nMaxSamples);
 
+    /// \brief Moves the sample buffer to the arena.
+    /// \param[in] pArena Arena of the owning node or nullptr for the heap.
+    void SetArena(CNodeArena* pArena);
+
     /// \brief Returns number indicating maximum samples stored
     /// \return Number indication maximum samples stored.
 	unsigned int GetMaxSamples() const
@@ -36,7 +44,7 @@ public:
 
     /// \brief Returns number indicating how many samples were stored were added to
 	/// the object from the beginning of its existance 
-	unsigned int GetNumOfSamplesStored()
+	unsigned int GetNumOfSamplesStored() const
 	{
 		return m_nSamplesStored;
 	}
@@ -56,6 +64,16 @@ public:
     /// \param[in] nN Number of samples to retrieve. nN = 0 gives all samples.
     void RetriveNSamples(std::vector<double>& v, int nN = 0) const;
 
+    /// \brief Returns a stored sample without copying the history.
+    /// \param[in] nAge Age of the sample, 0 is the newest one.
+    /// \return Sample value or 0 if not stored.
+    double GetSample(unsigned int nAge) const
+    {
+        if (nAge >= m_nCount)
+            return 0.0;
+        return m_vSamples[m_nHead >= nAge ? m_nHead - nAge : m_nHead + m_nMaxSamples - nAge];
+    }
+
     /// \brief Clears stored samples and copies values from vector
     /// \param[in] v Sets new history of stored values.
     void SetHistory(std::vector<double>& v);
@@ -63,16 +81,32 @@ public:
     /// \brief Clears stored samples
     void Clear()
     {
-        deqSamples.clear();
+        m_nHead = 0;
+        m_nCount = 0;
         m_nSamplesStored = 0;
     }
 
     /// \brief Returns last stored sample
-    double LastSample()
+    double LastSample() const
     {
-        return *(deqSamples.end());
+        return GetSample(0);
     }
 
+    /// \brief Returns number of bytes written by SaveSnapshot().
+    size_t GetSnapshotSize() const
+    {
+        return 3*sizeof(unsigned int) + m_vSamples.size()*sizeof(double);
+    }
+
+    /// \brief Copies stored samples to the snapshot buffer.
+    /// \return Pointer past the written data.
+    unsigned char* SaveSnapshot(unsigned char* p) const;
+
+    /// \brief Restores samples saved with SaveSnapshot(), the capacity has to be the same.
+    /// Throws if the stored position or count does not fit the capacity.
+    /// \return Pointer past the read data.
+    const unsigned char* LoadSnapshot(const unsigned char* p);
+
 	~CHistorian();
 
 private:
@@ -80,8 +114,12 @@ private:
 	unsigned int m_nMaxSamples;
     /// Holds information about number of samples currently stored.
     unsigned int m_nSamplesStored;
-    /// Stores the actual samples.
-	std::deque<double> deqSamples;
+    /// Position of the newest sample.
+    unsigned int m_nHead;
+    /// Number of samples in the buffer.
+    unsigned int m_nCount;
+    /// Ring buffer of m_nMaxSamples samples.
+	std::vector<double, CArenaAllocator<double> > m_vSamples;
 };
 
 #endif
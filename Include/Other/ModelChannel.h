@@ -0,0 +1,73 @@
+/** \class CModelChannel
+ * Versioned, double-buffered publication channel for identified ARX models.
+ *
+ * \par
+ * The identification thread publishes every new estimate with Publish(). Consumers
+ * (eg. CGPC) poll GetVersion() once per step, which is a single atomic load, and
+ * copy the model out with Read() only when the version differs from the one they
+ * already hold.
+ *
+ * \par
+ * Publishing never blocks: the writer fills the slot that is not currently published
+ * and then flips the version. Each slot is guarded by its own sequence counter, so a
+ * reader only has to retry if the writer managed to publish twice while the copy
+ * was in progress.
+ *
+ * \note
+ * Only one thread may publish at a time. Any number of threads may read.
+ */
+
+#ifndef _CMODELCHANNEL
+#define _CMODELCHANNEL
+
+#include <atomic>
+#include <vector>
+
+class CModelChannel
+{
+public:
+    /// Maximum number of coefficients of each polynomial.
+    static const int MAX_COEFFS = 32;
+
+    CModelChannel();
+
+    /// \brief Publishes a new model. Coefficients above MAX_COEFFS are dropped.
+    /// \param[in] vNom Nominator (B) coefficients.
+    /// \param[in] vDenom Denominator (A) coefficients.
+    void Publish(const std::vector<double>& vNom, const std::vector<double>& vDenom);
+
+    /// \brief Returns version of the last published model. 0 means nothing was published yet.
+    unsigned long long GetVersion() const
+    {
+        return m_nVersion.load(std::memory_order_acquire);
+    }
+
+    /// \brief Copies the last published model. Vectors keep their capacity between calls.
+    /// \param[out] vNom Nominator (B) coefficients.
+    /// \param[out] vDenom Denominator (A) coefficients.
+    /// \return Version of the copied model.
+    unsigned long long Read(std::vector<double>& vNom, std::vector<double>& vDenom) const;
+
+private:
+    /// Single model buffer.
+    struct SSlot
+    {
+        /// Odd while the slot is being written.
+        std::atomic<unsigned int> nSeq;
+        int nNomSize;
+        int nDenomSize;
+        double dNom[MAX_COEFFS];
+        double dDenom[MAX_COEFFS];
+    };
+
+    /// Two buffers - one published, one being written.
+    SSlot m_Slots[2];
+    /// Version of the published model. Published slot is m_nVersion & 1.
+    std::atomic<unsigned long long> m_nVersion;
+
+    // Nonusable elements
+    CModelChannel(const CModelChannel&);
+    CModelChannel& operator=(const CModelChannel&);
+};
+
+#endif
@@ -0,0 +1,134 @@
+/** \class CNodeArena
+ * Memory arena for simulation nodes of one chain.
+ *
+ * \par
+ * Memory is handed out from large chunks one block after another, so nodes created
+ * in the order of the tree traversal, together with their histories and children
+ * vectors, lie next to each other in memory. Freed blocks are kept in free lists by
+ * their size and handed out again for blocks of the same size, eg. of a grown history
+ * or of a node created in place of a deleted one. The memory of all the chunks is
+ * returned when the arena is destroyed. Nodes created in an arena keep it alive, see
+ * CSimNode::operator new.
+ *
+ * \par
+ * Allocation is guarded by a mutex, so nodes can be created from several threads.
+ */
+
+#ifndef _CNODEARENA
+#define _CNODEARENA
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+class CNodeArena
+{
+public:
+    /// \brief Creates empty arena.
+    /// \param[in] nChunkSize Size of a memory chunk in bytes.
+    explicit CNodeArena(size_t nChunkSize = 64*1024);
+
+    /// \brief Allocates a block of memory.
+    /// \param[in] nBytes Size of the block.
+    /// \param[in] nAlign Alignment of the block, a power of two.
+    /// \return Pointer to the block.
+    void* Allocate(size_t nBytes, size_t nAlign = alignof(std::max_align_t));
+
+    /// \brief Returns a block to the free list of its size.
+    /// \param[in] p Block returned by Allocate().
+    /// \param[in] nBytes Size the block was allocated with.
+    void Free(void* p, size_t nBytes);
+
+    /// \brief Returns number of bytes of the blocks not freed yet.
+    size_t GetBytesUsed() const;
+
+    /// \brief Returns number of blocks not freed yet.
+    size_t GetNumOfBlocks() const;
+
+    ~CNodeArena();
+
+private:
+    CNodeArena(const CNodeArena&);
+    CNodeArena& operator=(const CNodeArena&);
+
+    /// guards the chunks
+    mutable std::mutex m_Mutex;
+    /// default chunk size
+    size_t m_nChunkSize;
+    /// allocated chunks
+    std::vector<std::unique_ptr<unsigned char[]> > m_vChunks;
+    /// free part of the current chunk
+    unsigned char* m_pNext;
+    unsigned char* m_pEnd;
+    /// first freed block of every size, the next one is stored in the block
+    std::unordered_map<size_t, void*> m_FreeLists;
+    /// bytes of the blocks not freed
+    size_t m_nBytesUsed;
+    /// blocks not freed
+    size_t m_nBlocks;
+};
+
+/** \class CArenaAllocator
+ * Standard allocator taking memory from a CNodeArena, or from the heap without one.
+ * Moved and swapped containers take the arena with them, copies use the heap.
+ */
+template <class T>
+class CArenaAllocator
+{
+public:
+    typedef T value_type;
+    typedef std::false_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    CArenaAllocator(CNodeArena* pArena = nullptr) : m_pArena(pArena) {}
+
+    template <class U>
+    CArenaAllocator(const CArenaAllocator<U>& other) : m_pArena(other.GetArena()) {}
+
+    T* allocate(size_t n)
+    {
+        if (m_pArena)
+            return static_cast<T*>(m_pArena->Allocate(n*sizeof(T), alignof(T)));
+        return static_cast<T*>(::operator new(n*sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n)
+    {
+        if (m_pArena)
+            m_pArena->Free(p, n*sizeof(T));
+        else
+            ::operator delete(p);
+    }
+
+    CArenaAllocator select_on_container_copy_construction() const
+    {
+        return CArenaAllocator();
+    }
+
+    CNodeArena* GetArena() const
+    {
+        return m_pArena;
+    }
+
+private:
+    /// arena or nullptr for the heap
+    CNodeArena* m_pArena;
+};
+
+template <class T, class U>
+bool operator==(const CArenaAllocator<T>& a, const CArenaAllocator<U>& b)
+{
+    return a.GetArena() == b.GetArena();
+}
+
+template <class T, class U>
+bool operator!=(const CArenaAllocator<T>& a, const CArenaAllocator<U>& b)
+{
+    return a.GetArena() != b.GetArena();
+}
+
+#endif
@@ -0,0 +1,86 @@
+/** \class CNodeIndex
+ * Hash index of the simulation tree - objects by name and ID, generators by name.
+ *
+ * \par
+ * The index is owned by the root of the tree and built on the first search. Nodes keep
+ * it up to date when they are added, removed or renamed, so searching does not walk
+ * the tree. Names of objects and generators are unique, see SUniqueNameController.
+ *
+ * \par
+ * Generators can be renamed without their regulator knowing, so generator entries are
+ * checked against the current generator name on lookup. A renamed generator is found
+ * again after its regulator is added to the tree anew.
+ */
+
+#ifndef _CNODEINDEX
+#define _CNODEINDEX
+
+#include <string>
+#include <unordered_map>
+
+class ISISO;
+class IGenerator;
+
+class CNodeIndex
+{
+public:
+    /// \brief Adds object with its current name and ID.
+    void Add(ISISO* pNode);
+
+    /// \brief Removes object, its generators have to be removed separately.
+    void Remove(ISISO* pNode);
+
+    /// \brief Updates the name of the object.
+    /// \param[in] pNode Renamed object.
+    /// \param[in] sOldName Name the object was added with.
+    void Rename(ISISO* pNode, const std::string& sOldName);
+
+    /// \brief Updates the ID of the object.
+    /// \param[in] pNode Object with the new ID.
+    /// \param[in] nOldID ID the object was added with.
+    void ChangeID(ISISO* pNode, int nOldID);
+
+    /// \brief Adds generator belonging to the regulator.
+    void AddGenerator(IGenerator* pGen, ISISO* pOwner);
+
+    /// \brief Removes generator.
+    void RemoveGenerator(IGenerator* pGen);
+
+    /// \brief Returns object with the given name or regulator of the generator with that name.
+    /// \return Found object or nullptr.
+    ISISO* FindObject(const std::string& sName) const;
+
+    /// \brief Returns object with the given ID.
+    /// \return Found object or nullptr.
+    ISISO* FindObject(int nID) const;
+
+    /// \brief Returns generator with the given name.
+    /// \return Found generator or nullptr.
+    IGenerator* FindGenerator(const std::string& sName) const;
+
+    /// \brief Returns number of indexed objects.
+    size_t GetNumOfObjects() const
+    {
+        return m_Names.size();
+    }
+
+private:
+    /// Generator entry.
+    struct SGenerator
+    {
+        IGenerator* pGen;
+        ISISO* pOwner;
+    };
+
+    /// \brief Returns generator entry with the current name equal to sName.
+    const SGenerator* FindGeneratorEntry(const std::string& sName) const;
+
+    /// objects by name
+    std::unordered_map<std::string, ISISO*> m_Names;
+    /// objects by ID
+    std::unordered_map<int, ISISO*> m_IDs;
+    /// generators by name
+    std::unordered_map<std::string, SGenerator> m_Generators;
+};
+
+#endif
@@ -0,0 +1,83 @@
+/** \class CParamChannel
+ * Channel of parameter edits made while the chain is being simulated.
+ *
+ * \par
+ * Editors (eg. the GUI thread) stage typed updates with Stage(). The staged updates
+ * form a shadow block which the simulation thread takes whole with Take() at the
+ * next step boundary and applies before the step, so a step never sees a half
+ * applied edit. When nothing is staged Take() costs a single atomic load, otherwise
+ * it is one pointer exchange.
+ *
+ * \par
+ * Values are parsed when staged, nothing is serialized on the way to the object.
+ * Updates of one block are applied in the order they were staged.
+ *
+ * \note
+ * Any number of threads may stage. Only one thread may take.
+ */
+
+#ifndef _CPARAMCHANNEL
+#define _CPARAMCHANNEL
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// \brief Single staged parameter update.
+struct SParamUpdate
+{
+    /// Name of the object or generator.
+    std::string sTarget;
+    /// Name of the parameter, the same as in the chain file.
+    std::string sKey;
+    /// New value, vector parameters have more than one element.
+    std::vector<double> vValue;
+};
+
+class CParamChannel
+{
+public:
+    /// Block of updates applied at once.
+    typedef std::vector<SParamUpdate> Block;
+
+    CParamChannel();
+
+    /// \brief Stages an update for the next step.
+    /// \param[in] sTarget Name of the object or generator.
+    /// \param[in] sKey Name of the parameter.
+    /// \param[in] sValue Value as edited - a number, numbers separated by spaces or true/false.
+    /// \return False if the value cannot be parsed, nothing is staged then.
+    bool Stage(const std::string& sTarget, const std::string& sKey, const std::string& sValue);
+
+    /// \brief Takes all the staged updates.
+    /// \return Block of updates or nullptr if nothing is staged.
+    std::unique_ptr<Block> Take();
+
+    /// \brief Checks if any update is staged.
+    bool IsPending() const
+    {
+        return m_pPending.load(std::memory_order_acquire) != nullptr;
+    }
+
+    /// \brief Parses a value as edited into numbers.
+    /// \param[in] sValue Value to parse.
+    /// \param[out] vValue Parsed numbers, true/false give 1/0.
+    /// \return False if the value is empty or not a number.
+    static bool Parse(const std::string& sValue, std::vector<double>& vValue);
+
+    ~CParamChannel();
+
+private:
+    /// Serializes the editors, the taking thread never waits for it.
+    std::mutex m_StageMutex;
+    /// Staged block, nullptr if nothing is staged.
+    std::atomic<Block*> m_pPending;
+
+    // Nonusable elements
+    CParamChannel(const CParamChannel&);
+    CParamChannel& operator=(const CParamChannel&);
+};
+
+#endif
@@ -0,0 +1,124 @@
+/** \class CStateArena
+ * Stores snapshots of the dynamic state of a simulation tree.
+ *
+ * \par
+ * Objects write their state (histories, generator counters, integrators) as plain
+ * bytes with ISISO::SaveSnapshot() and read it back with ISISO::LoadSnapshot(), so
+ * taking and restoring a snapshot is a sequence of memcpy calls with no allocation.
+ * The arena keeps a number of equally sized slots, either in its own memory or in
+ * a buffer provided by the caller.
+ *
+ * \par
+ * Slots can be used directly with Save() and Load(), or as a stack with Push() and
+ * Pop() for nested lookahead. A snapshot is valid as long as the structure of the
+ * tree (objects, generators and history lengths) does not change.
+ *
+ * \par
+ * Example of evaluating many candidate futures from one point:
+ * \code
+ * CStateArena arena(root, 1);
+ * arena.Push(root);
+ * for (auto& candidate : candidates)
+ * {
+ *     arena.Peek(root);
+ *     // simulate the candidate
+ * }
+ * arena.Pop(root);
+ * \endcode
+ */
+
+#ifndef _CSTATEARENA
+#define _CSTATEARENA
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+class ISISO;
+
+/// \brief Copies a plain value to the snapshot buffer.
+/// \return Pointer past the written value.
+template <class T>
+inline unsigned char* PutSnapshot(unsigned char* p, const T& value)
+{
+    std::memcpy(p, &value, sizeof(T));
+    return p + sizeof(T);
+}
+
+/// \brief Copies a plain value from the snapshot buffer.
+/// \return Pointer past the read value.
+template <class T>
+inline const unsigned char* GetSnapshot(const unsigned char* p, T& value)
+{
+    std::memcpy(&value, p, sizeof(T));
+    return p + sizeof(T);
+}
+
+class CStateArena
+{
+public:
+    /// \brief Creates arena with slots fitting the state of the given tree.
+    /// \param[in] root Root of the tree to take snapshots of.
+    /// \param[in] nSlots Number of slots.
+    CStateArena(const ISISO& root, size_t nSlots);
+
+    /// \brief Creates arena in memory provided by the caller.
+    /// \param[in] pMemory Buffer of at least nSlotSize*nSlots bytes, it has to outlive the arena.
+    /// \param[in] nSlotSize Size of a single slot, eg. ISISO::GetSnapshotSize() of the root.
+    /// \param[in] nSlots Number of slots.
+    CStateArena(unsigned char* pMemory, size_t nSlotSize, size_t nSlots);
+
+    /// \brief Saves state of the tree into the slot.
+    void Save(const ISISO& root, size_t nSlot);
+
+    /// \brief Restores state of the tree from the slot.
+    /// Throws if the snapshot size of the tree differs from the slot size.
+    void Load(ISISO& root, size_t nSlot) const;
+
+    /// \brief Saves state of the tree into the next free slot.
+    void Push(const ISISO& root);
+
+    /// \brief Restores state saved by the last Push() and releases its slot.
+    void Pop(ISISO& root);
+
+    /// \brief Restores state saved by the last Push() and keeps it.
+    void Peek(ISISO& root) const;
+
+    /// \brief Releases the slot of the last Push() without restoring it.
+    void Drop();
+
+    /// \brief Returns number of slots used by Push().
+    size_t GetDepth() const
+    {
+        return m_nDepth;
+    }
+
+    /// \brief Returns size of a single slot in bytes.
+    size_t GetSlotSize() const
+    {
+        return m_nSlotSize;
+    }
+
+    /// \brief Returns number of slots.
+    size_t GetNumOfSlots() const
+    {
+        return m_nSlots;
+    }
+
+private:
+    /// \brief Returns the beginning of the slot, throws if it does not exist.
+    unsigned char* GetSlot(size_t nSlot) const;
+
+    /// memory owned by the arena
+    std::vector<unsigned char> m_vMemory;
+    /// beginning of the slots
+    unsigned char* m_pMemory;
+    /// size of a slot in bytes
+    size_t m_nSlotSize;
+    /// number of slots
+    size_t m_nSlots;
+    /// number of slots used as a stack
+    size_t m_nDepth;
+};
+
+#endif
@@ -0,0 +1,66 @@
+/** \class CValueCodec
+ * Fast reading of single numbers and flags stored in chain files.
+ *
+ * \par
+ * ptree::get<T>() converts through a string stream, which is several times slower than
+ * the rest of reading a value and dominates loading of large chains. Get() parses the
+ * usual forms directly with from_chars and falls back to the ptree conversion for
+ * anything else, so accepted values, defaults and exceptions stay the same as with
+ * ptree::get<T>().
+ */
+
+#ifndef _CVALUECODEC
+#define _CVALUECODEC
+
+#include <string>
+#include "boost\property_tree\ptree.hpp"
+
+class CValueCodec
+{
+public:
+    /// \brief Parses an integer, white space around it is allowed.
+    /// \return False if the text is not a plain number in range.
+    static bool Parse(const std::string& s, int& n);
+    static bool Parse(const std::string& s, unsigned int& n);
+    static bool Parse(const std::string& s, long long& n);
+
+    /// \brief Parses a decimal number, white space around it is allowed.
+    /// \return False if the text is not a plain number in range.
+    static bool Parse(const std::string& s, double& d);
+
+    /// \brief Parses 0, 1, true or false, white space around it is allowed.
+    /// \return False for any other text.
+    static bool Parse(const std::string& s, bool& b);
+
+    /// \brief Reads the value of a child like ptree::get<T>(sKey).
+    /// \param[in] node Node with the child.
+    /// \param[in] sKey Path of the child.
+    /// \throw ptree_bad_path if the child is missing, ptree_bad_data if it does not convert.
+    template <class T>
+    static T Get(const boost::property_tree::ptree& node, const std::string& sKey)
+    {
+        const boost::property_tree::ptree& child = node.get_child(sKey);
+        T value;
+        if (Parse(child.data(), value))
+            return value;
+        return child.get_value<T>();
+    }
+
+    /// \brief Reads the value of a child like ptree::get<T>(sKey, defaultValue).
+    /// \param[in] node Node with the child.
+    /// \param[in] sKey Path of the child.
+    /// \param[in] defaultValue Returned if the child is missing or does not convert.
+    template <class T>
+    static T Get(const boost::property_tree::ptree& node, const std::string& sKey, T defaultValue)
+    {
+        boost::optional<const boost::property_tree::ptree&> child = node.get_child_optional(sKey);
+        if (!child)
+            return defaultValue;
+        T value;
+        if (Parse(child->data(), value))
+            return value;
+        return child->get_value<T>(defaultValue);
+    }
+};
+
+#endif
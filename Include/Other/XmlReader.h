@@ -0,0 +1,176 @@
+/** \class CXmlReader
+ * Forward-only XML reader, reports elements and text one after another.
+ *
+ * \par
+ * The document is read from the stream in one pass by blocks, text and names are
+ * scanned within the block instead of character by character. Nothing but the block,
+ * the attributes of the current element and the path to it is kept, so documents of
+ * any size are read in linear time and constant memory. The stream is read ahead of
+ * the items reported, up to the block size. Supported are elements with attributes, text with
+ * the predefined and numeric character entities, CDATA sections, comments, processing
+ * instructions and the document type declaration, the last three are skipped.
+ *
+ * \par
+ * Text consisting of white space only is not reported, other text is reported as is.
+ * A self-closing element is reported as a start followed by an end.
+ *
+ * \par
+ * Byte offsets of tags are reported, so an element can be read again later on its own,
+ * eg. from a CChainIndex.
+ *
+ * \note
+ * Malformed documents are reported by throwing std::string with the line number.
+ */
+
+#ifndef _CXMLREADER
+#define _CXMLREADER
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "boost\property_tree\ptree.hpp"
+
+class CXmlReader
+{
+public:
+    /// Kind of the item read.
+    enum EEvent
+    {
+        evStart,
+        evEnd,
+        evText,
+        evEndOfDocument
+    };
+
+    /// Attributes of an element in the order of the document.
+    typedef std::vector<std::pair<std::string, std::string> > Attributes;
+
+    /// \brief Creates reader of the stream.
+    /// \param[in] is Stream to read, has to outlive the reader.
+    /// \param[in] nLine Line of the document the stream starts at, for a part of a document.
+    explicit CXmlReader(std::istream& is, int nLine = 1);
+
+    /// \brief Reads the next item.
+    /// \return Kind of the item, evEndOfDocument after the root element is closed.
+    EEvent Next();
+
+    /// \brief Returns name of the element started or ended by the last item.
+    const std::string& GetName() const
+    {
+        return m_sName;
+    }
+
+    /// \brief Returns text of the last evText item.
+    const std::string& GetText() const
+    {
+        return m_sText;
+    }
+
+    /// \brief Returns attributes of the element started by the last item.
+    const Attributes& GetAttributes() const
+    {
+        return m_vAttributes;
+    }
+
+    /// \brief Returns depth of the element of the last start or end item, the root element has 1.
+    int GetDepth() const
+    {
+        return m_nDepth;
+    }
+
+    /// \brief Returns line of the document the reader is at, from 1.
+    int GetLine() const
+    {
+        return m_nLine;
+    }
+
+    /// \brief Returns number of bytes of the document read by the items so far.
+    uint64_t GetOffset() const
+    {
+        return m_nBlockOffset + (m_pCur - m_pBlock.get());
+    }
+
+    /// \brief Returns offset of the '<' of the last tag read.
+    uint64_t GetTagOffset() const
+    {
+        return m_nTagOffset;
+    }
+
+    /// \brief Reads the element started by the last item into the tree, up to its end.
+    /// Attributes and text are stored the same way as by the property tree parser.
+    /// \param[out] Node Tree of the element.
+    void ReadTree(boost::property_tree::ptree& Node);
+
+private:
+    /// Size of a block read from the stream.
+    static const size_t BLOCK = 64*1024;
+
+    /// \brief Reads the next block of the stream.
+    /// \return False at the end of the stream.
+    bool Fill();
+
+    /// \brief Takes the next character, EOF at the end of the stream.
+    int Get();
+
+    /// \brief Returns the next character without taking it.
+    int Peek();
+
+    /// \brief Skips white space.
+    void SkipSpace();
+
+    /// \brief Skips everything up to and including the terminator.
+    void SkipPast(const char* sTerminator);
+
+    /// \brief Reads a name of an element or attribute.
+    void ReadName(std::string& sName);
+
+    /// \brief Reads an entity after '&' and appends its character to the string.
+    void ReadEntity(std::string& s);
+
+    /// \brief Appends characters up to the first of the two stop characters to the string.
+    /// Lines are counted, entities are not resolved.
+    /// \return The stop character, EOF at the end of the stream.
+    int ReadUntil(std::string& s, char cStop1, char cStop2);
+
+    /// \brief Reads a start tag after '<', the element name is already read.
+    /// \return True if the element is self-closing.
+    bool ReadAttributes();
+
+    /// \brief Throws the error message with the current line.
+    void Error(const std::string& sMessage) const;
+
+    /// stream buffer of the document
+    std::streambuf* m_pBuf;
+    /// current block of the document, BLOCK bytes
+    std::unique_ptr<char[]> m_pBlock;
+    /// next character and the end of the characters read into the block
+    const char* m_pCur;
+    const char* m_pEnd;
+    /// offset of the block in the document
+    uint64_t m_nBlockOffset;
+    /// current line
+    int m_nLine;
+    /// offset of the last tag
+    uint64_t m_nTagOffset;
+    /// names of the open elements
+    std::vector<std::string> m_vOpen;
+    /// self-closing element waits for its end item
+    bool m_bPendingEnd;
+    /// name of the last element
+    std::string m_sName;
+    /// last text
+    std::string m_sText;
+    /// attributes of the last started element
+    Attributes m_vAttributes;
+    /// depth of the last element
+    int m_nDepth;
+
+    // Nonusable elements
+    CXmlReader(const CXmlReader&);
+    CXmlReader& operator=(const CXmlReader&);
+};
+
+#endif
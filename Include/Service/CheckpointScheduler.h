@@ -0,0 +1,217 @@
+/** \class CCheckpointScheduler
+ * Periodic incremental checkpoints of a running session, for recovery after a crash.
+ *
+ * \par
+ * The runner calls OnStep() after every step. Every given number of steps or seconds the
+ * dynamic state of the session is copied into the front buffer, which is all the control
+ * loop pays for. A background thread compares it with the back buffer - the state written
+ * last - and writes only the blocks that differ, typically the new samples of histories
+ * and the integrators of the objects that moved. The buffers are swapped afterwards. If the
+ * thread is still writing when the next checkpoint is due, the checkpoint is postponed to
+ * the next step instead of waiting.
+ *
+ * \par
+ * A full CCheckpoint file is written first, whenever the chain or its parameters change
+ * and after a given number of deltas. Delta files apply to the previous file of the same
+ * base. Files are listed in a manifest only when complete, the given number of the latest
+ * restore points is kept and files not needed by them are deleted.
+ *
+ * \par
+ * Files of the base name "run":
+ * \code
+ * run.ckpl       manifest, a line "sequence full" or "sequence delta base sequence" per file
+ * run.7.ckpt     full checkpoint, see CCheckpoint
+ * run.8.ckpd     delta to the previous file
+ * \endcode
+ * Delta layout, all values in the byte order of the machine that wrote them:
+ * \code
+ * "SIMD", version, byte order mark, flags       4 x uint32
+ * sequence, previous sequence                   2 x uint64
+ * last loop values, see CCheckpoint             5 x double
+ * state size, number of ranges,
+ * identification size, nominator and
+ * denominator lengths, hash of the state        6 x uint64
+ * ranges: offset, size, data                    aligned to 8 bytes
+ * identification, nominator, denominator        sections, each aligned to 8 bytes
+ * \endcode
+ *
+ * \par
+ * Restart() resumes a session from the latest restore point whose files are complete and
+ * match their stored hashes - the sections of the full checkpoint and the state rebuilt by
+ * every delta. Older points are tried otherwise.
+ */
+
+#ifndef _CCHECKPOINTSCHEDULER
+#define _CCHECKPOINTSCHEDULER
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SimSession.h"
+#include "Checkpoint.h"
+#include "boost\property_tree\ptree.hpp"
+
+class CCheckpointScheduler
+{
+public:
+    /// \brief Starts the writing thread, sequence numbers continue the existing manifest.
+    /// \param[in] Session Session to checkpoint.
+    /// \param[in] sBaseName Path and base name of the files.
+    CCheckpointScheduler(std::shared_ptr<CSimSession> Session, const std::string& sBaseName);
+
+    /// \brief Sets how often checkpoints are taken, whichever comes first.
+    /// \param[in] nSteps Number of steps between checkpoints, 0 for no limit.
+    /// \param[in] dSeconds Seconds between checkpoints, 0 for no limit.
+    void SetInterval(unsigned int nSteps, double dSeconds);
+
+    /// \brief Sets the number of kept restore points and full checkpoints.
+    /// \param[in] nRestorePoints Number of the latest restore points kept, at least 1.
+    /// \param[in] nFullEvery Number of deltas after which a full checkpoint is written.
+    void SetRetention(unsigned int nRestorePoints, unsigned int nFullEvery);
+
+    /// \brief Takes a checkpoint if it is due. Has to be called between steps by the thread running them.
+    void OnStep();
+
+    /// \brief Takes a checkpoint at once and waits until it is written.
+    /// \return True if written.
+    bool Checkpoint();
+
+    /// \brief Waits until the checkpoint being written is finished.
+    /// \return False if writing of the last checkpoint failed.
+    bool Flush();
+
+    /// \brief Returns sequence number of the last written checkpoint, 0 if none.
+    unsigned long GetLastSequence();
+
+    /// \brief Restores the session from the latest consistent restore point.
+    /// \param[in] Session Session to restore.
+    /// \param[in] sBaseName Path and base name of the files.
+    /// \return False if no restore point could be restored, the reasons are logged.
+    static bool Restart(CSimSession& Session, const std::string& sBaseName);
+
+    /// \brief Finishes the checkpoint being written and stops the thread.
+    ~CCheckpointScheduler();
+
+private:
+    CCheckpointScheduler(const CCheckpointScheduler&);
+    CCheckpointScheduler& operator=(const CCheckpointScheduler&);
+
+    /// File listed in the manifest.
+    struct SFileEntry
+    {
+        /// Sequence number of the file.
+        unsigned long nSeq;
+        /// Sequence number of the full checkpoint the file applies to, nSeq for a full one.
+        unsigned long nBase;
+    };
+
+    /// \brief Copies the state of the session to the front buffer and hands it to the thread.
+    /// \return False if the thread is still writing.
+    bool Capture();
+
+    /// \brief Thread routine, writes the handed states until the scheduler is destroyed.
+    void Work();
+
+    /// \brief Writes the front buffer as a full checkpoint or a delta.
+    /// \return True if written and listed in the manifest.
+    bool Write();
+
+    /// \brief Writes delta of the front buffer to the back buffer.
+    bool WriteDelta(const std::string& sFileName, unsigned long nSeq) const;
+
+    /// \brief Adds the file to the manifest and deletes files of dropped restore points.
+    bool AddToManifest(const SFileEntry& Entry);
+
+    /// \brief Returns name of a full checkpoint or delta file.
+    static std::string FileName(const std::string& sBaseName, unsigned long nSeq, bool bFull);
+
+    /// \brief Reads the manifest, a missing one is empty.
+    static void ReadManifest(const std::string& sBaseName, std::vector<SFileEntry>& vEntries);
+
+    /// \brief Builds the state of a restore point from its full checkpoint and deltas.
+    /// \param[in] sBaseName Path and base name of the files.
+    /// \param[in] Entry Restore point.
+    /// \param[out] Checkpoint Checkpoint with the chain of the base file and the rebuilt state.
+    /// \return False if a file is missing or not consistent.
+    static bool Rebuild(const std::string& sBaseName, const SFileEntry& Entry, CCheckpoint& Checkpoint);
+
+    /// \brief Applies a delta file to the state.
+    /// \param[in] sFileName Delta file.
+    /// \param[in] nSeq Sequence number of the delta, the state has to be of the previous one.
+    /// \param[in,out] State State to update.
+    /// \return False if the file is missing, does not follow the state or the result does not match its hash.
+    static bool ApplyDelta(const std::string& sFileName, unsigned long nSeq, CCheckpoint::SState& State);
+
+    /// checkpointed session
+    std::shared_ptr<CSimSession> m_Session;
+    /// path and base name of the files
+    std::string m_sBaseName;
+
+    // owned by the running thread
+    /// steps since the last checkpoint
+    unsigned int m_nStepsSince;
+    /// time of the last checkpoint
+    std::chrono::steady_clock::time_point m_LastTime;
+    /// chain revision of the last handed chain
+    unsigned long m_nHandedRevision;
+
+    // owned by the running thread when no write is pending, by the writing thread otherwise
+    /// front buffer, the state to write
+    CCheckpoint::SState m_Front;
+    /// chain revision of the front buffer
+    unsigned long m_nFrontRevision;
+    /// chain with the parameters of the front buffer, if changed since the last handed one
+    boost::property_tree::ptree m_Chain;
+    /// is m_Chain set?
+    bool m_bHasChain;
+
+    // owned by the writing thread
+    /// back buffer, the state written last
+    CCheckpoint::SState m_Back;
+    /// is the back buffer valid to write a delta to?
+    bool m_bHaveBack;
+    /// chain revision of the back buffer
+    unsigned long m_nBackRevision;
+    /// deltas written since the last full checkpoint
+    unsigned int m_nDeltas;
+    /// last full checkpoint, with the chain formatted once per revision
+    CCheckpoint m_Base;
+    /// is the chain of m_Base set?
+    bool m_bBaseChain;
+    /// chain revision of the chain of m_Base
+    unsigned long m_nBaseChainRevision;
+    /// listed files, oldest first
+    std::vector<SFileEntry> m_vEntries;
+
+    // guarded by the mutex
+    /// checkpoint interval
+    unsigned int m_nIntervalSteps;
+    double m_dIntervalSeconds;
+    /// restore points kept
+    unsigned int m_nRestorePoints;
+    /// deltas between full checkpoints
+    unsigned int m_nFullEvery;
+    /// sequence number of the last written file
+    unsigned long m_nLastSeq;
+    /// has the next capture to include the chain?
+    bool m_bChainNeeded;
+    /// is the front buffer handed to the writing thread?
+    bool m_bPending;
+    /// result of the last write
+    bool m_bLastResult;
+    /// is the thread to finish?
+    bool m_bStop;
+    /// guards the members above
+    std::mutex m_Mutex;
+    /// signals a handed state, a finished write or the stop
+    std::condition_variable m_Signal;
+
+    /// writing thread, started last
+    std::thread m_Thread;
+};
+
+#endif
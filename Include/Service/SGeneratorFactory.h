@@ -15,6 +15,7 @@
 #include "StepGen.h"
 #include "SquareGen.h"
 #include "TriangleGen.h"
+#include "ExpressionGen.h"
 
 class SGeneratorFactory
 {
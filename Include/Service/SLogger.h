@@ -0,0 +1,162 @@
+/** \class
+* SLogger.
+* Singleton collecting diagnostic messages in a fixed size, lock-free ring buffer.
+*
+* \par
+* Messages are written with SIM_LOG_DEBUG, SIM_LOG_INFO, SIM_LOG_WARNING and SIM_LOG_ERROR
+* macros. Levels below SIM_LOG_LEVEL are removed by the preprocessor, so neither the
+* message formatting nor its arguments are evaluated. By default debug messages are
+* compiled in only when _DEBUG is defined.
+*
+* \par
+* Every entry keeps its level, time, source function and text truncated to MAX_TEXT
+* characters. Writers never block - the oldest entries are overwritten when the buffer
+* is full. Stored entries can be retrieved with Read() or printed with Dump().
+*/
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef _SLOGGER
+#define _SLOGGER
+
+/// Log levels, in increasing order of importance.
+#define SIM_LOG_LEVEL_DEBUG 0
+#define SIM_LOG_LEVEL_INFO 1
+#define SIM_LOG_LEVEL_WARNING 2
+#define SIM_LOG_LEVEL_ERROR 3
+#define SIM_LOG_LEVEL_OFF 4
+
+/// Lowest level compiled into the program.
+#ifndef SIM_LOG_LEVEL
+#ifdef _DEBUG
+#define SIM_LOG_LEVEL SIM_LOG_LEVEL_DEBUG
+#else
+#define SIM_LOG_LEVEL SIM_LOG_LEVEL_INFO
+#endif
+#endif
+
+/// Formats the stream expression and writes it to the logger.
+#define SIM_LOG_WRITE(level, expr) \
+    do { \
+        std::ostringstream simLogStream; \
+        simLogStream << expr; \
+        SLogger::GetInstance().Write(level, __FUNCTION__, simLogStream.str()); \
+    } while (0)
+
+#if SIM_LOG_LEVEL <= SIM_LOG_LEVEL_DEBUG
+#define SIM_LOG_DEBUG(expr) SIM_LOG_WRITE(SIM_LOG_LEVEL_DEBUG, expr)
+#else
+#define SIM_LOG_DEBUG(expr) ((void)0)
+#endif
+
+#if SIM_LOG_LEVEL <= SIM_LOG_LEVEL_INFO
+#define SIM_LOG_INFO(expr) SIM_LOG_WRITE(SIM_LOG_LEVEL_INFO, expr)
+#else
+#define SIM_LOG_INFO(expr) ((void)0)
+#endif
+
+#if SIM_LOG_LEVEL <= SIM_LOG_LEVEL_WARNING
+#define SIM_LOG_WARNING(expr) SIM_LOG_WRITE(SIM_LOG_LEVEL_WARNING, expr)
+#else
+#define SIM_LOG_WARNING(expr) ((void)0)
+#endif
+
+#if SIM_LOG_LEVEL <= SIM_LOG_LEVEL_ERROR
+#define SIM_LOG_ERROR(expr) SIM_LOG_WRITE(SIM_LOG_LEVEL_ERROR, expr)
+#else
+#define SIM_LOG_ERROR(expr) ((void)0)
+#endif
+
+class SLogger
+{
+public:
+    /// Number of entries kept in the ring buffer, power of two.
+    static const unsigned int CAPACITY = 1024;
+    /// Longest stored message, longer ones are truncated.
+    static const unsigned int MAX_TEXT = 120;
+
+    /// Single log entry as returned by Read().
+    struct SEntry
+    {
+        /// Sequential number of the entry.
+        unsigned long long nIndex;
+        /// One of SIM_LOG_LEVEL_* values.
+        int nLevel;
+        /// Time since the logger creation in microseconds.
+        long long nTime;
+        /// Function which wrote the entry.
+        const char* szSource;
+        /// Message text.
+        std::string sText;
+    };
+
+	/// Returns the only one instance of the singleton
+	static SLogger& GetInstance()
+	{
+        //creating the only instance of the class
+		std::call_once(m_OneCreation, []()
+		{
+			SLogger::m_Instance.reset(new SLogger);
+		});
+
+		return *SLogger::m_Instance;
+	}
+
+    /// \brief Stores the message in the ring buffer. Safe to call from many threads.
+    /// \param[in] nLevel One of SIM_LOG_LEVEL_* values.
+    /// \param[in] szSource Static string naming the source of the message.
+    /// \param[in] sText Message text.
+    void Write(int nLevel, const char* szSource, const std::string& sText);
+
+    /// \brief Appends entries written since the previous call to vEntries.
+    /// Entries overwritten in the meantime are skipped. Only one reader at a time is supported.
+    /// \return Number of entries lost because of buffer overflow.
+    unsigned long long Read(std::vector<SEntry>& vEntries);
+
+    /// Prints entries written since the previous Read() or Dump() call.
+    void Dump(std::ostream& os);
+
+    /// Returns name of the level.
+    static const char* LevelName(int nLevel);
+
+	~SLogger();
+
+private:
+    /// Slot of the ring buffer.
+    struct SSlot
+    {
+        /// 0 while being written, index + 1 when complete.
+        std::atomic<unsigned long long> nSeq;
+        int nLevel;
+        long long nTime;
+        const char* szSource;
+        unsigned int nLength;
+        char szText[MAX_TEXT];
+    };
+
+    SSlot m_Slots[CAPACITY];
+    /// Index of the next entry to write.
+    std::atomic<unsigned long long> m_nHead;
+    /// Index of the next entry to read.
+    unsigned long long m_nTail;
+    /// Time of the logger creation.
+    std::chrono::steady_clock::time_point m_Start;
+
+    //Singleton implementation static variables
+	static std::once_flag m_OneCreation;
+	static std::shared_ptr<SLogger> m_Instance;
+
+    //Nonusable elements
+	SLogger();
+	SLogger(const SLogger&);
+	SLogger& operator=(const SLogger&);
+};
+
+#endif
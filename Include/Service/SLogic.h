@@ -3,7 +3,8 @@
  * 1. Responsible for connecting GUI with simulation data model and organising data flow. \n
  * 2. Enables saving and loading the state of the program from and external file. \n
  * 3. Features simulation in an external thread. \n
- * 4. Owns root of the simulation chain and identification algorithm visible to the user via GUI.
+ * 4. Owns the simulation session visible to the user via GUI - the chain, its registries
+ * and identification, see CSimSession. SLogic only passes data between the session and GUI.
  * \note
  * Implements multi-threading safe singleton pattern.
  * \warning
@@ -34,7 +35,8 @@
 #include <QtConcurrent/QtConcurrentRun>
 #include <thread>
 #include <QMetaObject>
-#include "ARXIdentification.h"
+#include "SimSession.h"
+#include "CheckpointScheduler.h"
 
 class SLogic
 {
@@ -79,11 +81,7 @@ public:
     /// objects parameters or generators.
     void ResetSimulation()
     {
-        // delete memory of every simulation object
-        m_SimRoot->ResetMemory();
-
-        // remove last stored value
-        m_dLastSimVal = 0;
+        m_Session->Reset();
     }
 
     /// \brief Deletes the only instance. This must be called after the Run() function in order
@@ -100,8 +98,27 @@ public:
 
     /// \brief Tries to load the simulation chain from the .xml file
     /// \param[in] sFileName Filename to load data from.
+    /// \param[in] bLazy True to only index the file, eg. of a large plant library. Objects are created
+    /// by branches when simulated, selected or searched, see CSimSession::OpenChain().
     /// \return True if successfully loaded.
-    bool LoadSimChain(const std::string sFileName);
+    bool LoadSimChain(const std::string sFileName, bool bLazy = false);
+
+    /// \brief Starts periodic checkpoints of the simulation, taken from the next simulation run.
+    /// \param[in] sBaseName Path and base name of the checkpoint files.
+    /// \param[in] nSteps Number of steps between checkpoints, 0 for no limit.
+    /// \param[in] dSeconds Seconds between checkpoints, 0 for no limit.
+    /// \param[in] nRestorePoints Number of the latest restore points kept.
+    void EnableCheckpoints(const std::string& sBaseName, unsigned int nSteps, double dSeconds,
+                           unsigned int nRestorePoints);
+
+    /// \brief Stops periodic checkpoints, the checkpoint being written is finished.
+    void DisableCheckpoints();
+
+    /// \brief Restores the simulation from the latest consistent checkpoint, eg. after a crash.
+    /// The simulation is resumed with ToggleSimulation().
+    /// \param[in] sBaseName Path and base name of the checkpoint files.
+    /// \return True if restored.
+    bool RestartFromCheckpoint(const std::string& sBaseName);
 
     /// \brief Sets object to save its output to specified file
     /// \param[in] sObjName Object name to search for.
@@ -129,25 +146,21 @@ public:
     void ChangeIdentificationParams(int nNomDegree,
          int nDenomDegree, int nDelay, int nTreshold, double dForgettingFactor)
     {
-        std::lock_guard<std::mutex> guard(identifyMutex);
-        m_ARXIdentAlg.reset(new CARXIdentification(nNomDegree, nDenomDegree, nDelay, 10, dForgettingFactor, nTreshold));
-        m_ARXIdentAlg->ResetWholeHistory();
+        m_Session->SetIdentificationParams(nNomDegree, nDenomDegree, nDelay, nTreshold, dForgettingFactor);
     }
 
     /// \brief Retrieves last identified nominator.
     /// \param[out] vNom Vector with nominator values.
     void GetLastIdentifiedNominator(std::vector<double>& vNom)
     {
-        std::lock_guard<std::mutex> guard(identifyMutex);
-        vNom = m_ARXIdentAlg->ReturnThetaNominator();
+        m_Session->GetLastIdentifiedNominator(vNom);
     }
 
     /// \brief Retrieves last identified denominator.
     /// \param[out] vNom Vector with denominator values.
     void GetLastIdentifiedDenominator(std::vector<double>& vDenom)
     {
-        std::lock_guard<std::mutex> guard(identifyMutex);
-        vDenom = m_ARXIdentAlg->ReturnThetaDenominator();
+        m_Session->GetLastIdentifiedDenominator(vDenom);
     }
 
     /// \brief Set the GUI handle. This method has to be called as soon as possible
@@ -189,31 +202,26 @@ private:
     /// \param[in] nPeriod Simulation period.
     void m_RunSimulation(int nTime, int nPeriod);
 
+    /// \brief Replaces the GUI tree with the objects of the session chain.
+    void SendChainToGUI();
+
     /// Property tree of the last selected object
     boost::property_tree::ptree m_SelectedObjectProperties;
 
     /// GUI handle pointer
     MainWindow* m_GUIHandle;
 
-    /// ARX object identification algorithm
-    std::shared_ptr<CARXIdentification> m_ARXIdentAlg;
-
-    /// Mutex for identification access.
-    std::mutex identifyMutex;
-    /// Mutex for simulation tree access.
-    std::mutex simTreeMutex;
-
     /// Simulation interval.
     int m_nTime;
     /// Simulation period.
     int m_nPeriod;
     /// Simulation handle.
     QFuture<void> m_Handle;
-    /// Last value received from simulation.
-    double m_dLastSimVal;
 
-    /// Root of the simulation chain.
-    std::shared_ptr<CSimObject> m_SimRoot;
+    /// Session with the chain shown in GUI.
+    std::shared_ptr<CSimSession> m_Session;
+    /// Periodic checkpoints of the session, nullptr if disabled.
+    std::shared_ptr<CCheckpointScheduler> m_Checkpoints;
 
     // variables for singleton implementation
     static std::once_flag m_OneCreation;
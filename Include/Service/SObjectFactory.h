@@ -1,6 +1,12 @@
 /** \class SObjectFactory
 * Responsible for creating discrite objects which implement ISISO interface.
 * \note Implements multi-threading safe singleton pattern.
+*
+* \par
+* With an arena set the objects are allocated in it one after another, so a chain loaded
+* in the traversal order is laid out contiguously, see CNodeArena. Created objects are
+* owned the same way in both modes. Sessions pass their own arena to CreateObject(), so
+* the factory holds no state of any of them.
 */
 
 #ifndef _SOBJECTFACTORY
@@ -33,6 +39,19 @@ public:
     /// \return Created object pointer or nullptr.
 	ISISO* CreateObject(ObjType NewObjectType);
 
+    /// \brief Creates a new type of discrite object in the given arena.
+    /// \param[in] NewObjectType Type of the object to create.
+    /// \param[in] Arena Arena to allocate the object in, nullptr for the heap.
+    /// \return Created object pointer or nullptr.
+	ISISO* CreateObject(ObjType NewObjectType, const std::shared_ptr<CNodeArena>& Arena);
+
+    /// \brief Sets the arena for the objects created afterwards.
+    /// \param[in] Arena Arena of the chain or nullptr to allocate on the heap.
+    void SetArena(std::shared_ptr<CNodeArena> Arena);
+
+    /// \brief Returns the current arena, nullptr if objects are allocated on the heap.
+    std::shared_ptr<CNodeArena> GetArena() const;
+
     /// \brief Checks whether the object is a type of regulator.
     /// \param[in] node An object to test.
     /// \return True if object is regulator.
@@ -46,6 +65,9 @@ public:
 	~SObjectFactory();
 
 private:
+    /// arena for new objects, accessed atomically
+    std::shared_ptr<CNodeArena> m_Arena;
+
     // Singleton implementation variables
 	static std::once_flag m_OneCreation;
 	static std::shared_ptr<SObjectFactory> m_OneInstance;
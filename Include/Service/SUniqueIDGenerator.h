@@ -1,10 +1,27 @@
 /** \class
 * SUniqueIDGenerator.
 * Basic singleton class to handle dispensing unique ids.
+*
+* \par
+* Used IDs are marked in an atomic bitmap, one bit per ID, so no lock is taken.
+* Every thread takes a block of 64 IDs (one bitmap word) for itself and hands out
+* IDs from it, so threads creating objects do not compete for the same word. A thread
+* keeps its block for each of the few generators it used last, eg. of sessions loaded
+* by turns.
+* Any free ID can be reserved explicitly, eg. an ID loaded from a file, and IDs
+* of destroyed objects are released and can be handed out again once the
+* never used blocks run out.
+*
+* \par
+* Besides the process-wide instance every simulation session owns its own generator,
+* see CSimSession. The generator bound to the calling thread is returned by GetCurrent().
 */
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <mutex>
+#include <vector>
 
 #ifndef _SUNIQUEIDGENERATOR
 #define _SUNIQUEIDGENERATOR
@@ -23,30 +40,73 @@ public:
 
 		return *SUniqueIDGenerator::m_Instance;
 	}
-	
+
+    /// \brief Returns generator bound to the calling thread, the process-wide one if none.
+	static SUniqueIDGenerator& GetCurrent()
+	{
+		return m_pCurrent ? *m_pCurrent : GetInstance();
+	}
+
+    /// \brief Binds the generator to the calling thread.
+    /// \param[in] pCurrent Generator to bind or nullptr for the process-wide one.
+    /// \return Previously bound generator.
+	static SUniqueIDGenerator* SetCurrent(SUniqueIDGenerator* pCurrent)
+	{
+		SUniqueIDGenerator* pOld = m_pCurrent;
+		m_pCurrent = pCurrent;
+		return pOld;
+	}
+
+    /// \brief Creates a generator with all IDs free, eg. for a session.
+	SUniqueIDGenerator();
+
     /// \brief Retrives next unique ID
-	/// Returns 0 if no unique IDs left. This usually means that there are large 
-	/// ranges of IDs not used because of toxic reservations.
+	/// Returns 0 if no unique IDs left.
 	unsigned int GetNextID();
 
-    /// \brief Reserves an ID. Returns false if reservation failed (usually because chosen ID is reserved).
-	/// TODO handle bad reservations which disable huge ranges of available IDs
+    /// \brief Reserves an ID. Returns false if reservation failed (chosen ID is reserved or out of range).
 	bool ReserveID(int nID);
 
+    /// \brief Reserves many IDs at once.
+    /// \param[in] vIDs IDs to reserve.
+    /// \param[out] vReserved True for every reserved ID, false if it was taken or out of range.
+    /// \return Number of reserved IDs.
+	unsigned int ReserveIDs(const std::vector<int>& vIDs, std::vector<bool>& vReserved);
+
+    /// \brief Releases an ID, so it can be handed out again.
+	void ReleaseID(int nID);
+
+    /// \brief Checks whether the ID is in use.
+	bool IsReserved(int nID) const;
+
 	~SUniqueIDGenerator();
 
 	static const int MAX_ID = 100000;
 
 private:
-	std::mutex m_mutCounter;
-	unsigned int m_nCounter;
+    /// Number of IDs in a bitmap word and in a block of a thread.
+	static const unsigned int BLOCK = 64;
+    /// Number of bitmap words.
+	static const unsigned int WORDS = MAX_ID / BLOCK + 1;
+
+    /// \brief Marks the lowest free ID of the word as used.
+    /// \return The ID or 0 if the word is full.
+	unsigned int ClaimInWord(unsigned int nWord);
+
+    /// bitmap of used IDs, bit set for every used ID
+	std::atomic<uint64_t> m_Used[WORDS];
+    /// next word never given to a thread
+	std::atomic<unsigned int> m_nNextWord;
+    /// position of the search for released IDs after all words were given out
+	std::atomic<unsigned int> m_nScan;
 
     //Singleton implementation static variables
 	static std::once_flag m_OneCreation;
 	static std::shared_ptr<SUniqueIDGenerator> m_Instance;
+    /// generator bound to the thread
+	static thread_local SUniqueIDGenerator* m_pCurrent;
 
     //Nonusable elements
-	SUniqueIDGenerator();
 	SUniqueIDGenerator(const SUniqueIDGenerator&);
 	SUniqueIDGenerator& operator=(const SUniqueIDGenerator&);
 
@@ -1,12 +1,24 @@
 /** \class 
  * SUniqueNameController
  * Responsible for registering and checking uniqueness of the chosen names.
+ *
+ * \par
+ * Names are kept in hash sets split into shards, each guarded by its own mutex, so
+ * objects can be created from several threads. A taken name gets a numeric postfix
+ * from a counter kept for every base name, so registering many objects with the same
+ * proposed name does not test all the previous postfixes. Postfixes of unregistered
+ * names are not reused.
+*
+* \par
+* Besides the process-wide instance every simulation session owns its own registry,
+* see CSimSession. The registry bound to the calling thread is returned by GetCurrent().
 */
 
 #include <mutex>
 #include <memory>
-#include <set>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 #ifndef _SUniqueNameController
 #define _SUniqueNameController
@@ -26,6 +38,25 @@ public:
 		return *SUniqueNameController::m_Instance;
 	}
 
+    /// \brief Returns registry bound to the calling thread, the process-wide one if none.
+	static SUniqueNameController& GetCurrent()
+	{
+		return m_pCurrent ? *m_pCurrent : GetInstance();
+	}
+
+    /// \brief Binds the registry to the calling thread.
+    /// \param[in] pCurrent Registry to bind or nullptr for the process-wide one.
+    /// \return Previously bound registry.
+	static SUniqueNameController* SetCurrent(SUniqueNameController* pCurrent)
+	{
+		SUniqueNameController* pOld = m_pCurrent;
+		m_pCurrent = pCurrent;
+		return pOld;
+	}
+
+    /// \brief Creates an empty registry, eg. for a session.
+	SUniqueNameController();
+
     /// \brief Handles checking the uniqueness of the name and generating postfix if needed.
 	/// Using referencje, returns the (fixed) name to use within the program.
     /// \param[in] sName Proposed name to register.
@@ -39,15 +70,40 @@ public:
 	~SUniqueNameController();
 
 private:
+    /// Number of shards, a power of two.
+    static const unsigned int SHARDS = 16;
+
+    /// Part of the registry.
+    struct SShard
+    {
+        /// guards the shard
+        std::mutex Mutex;
+        /// registered names with hash in the shard
+        std::unordered_set<std::string> Names;
+        /// next postfix of base names with hash in the shard
+        std::unordered_map<std::string, unsigned int> NextPostfix;
+    };
+
+    /// \brief Returns shard of the name.
+    SShard& GetShard(const std::string& sName)
+    {
+        return m_Shards[std::hash<std::string>()(sName) & (SHARDS - 1)];
+    }
+
+    /// \brief Registers the name if it is free.
+    /// \return True if registered.
+    bool TryRegister(const std::string& sName);
+
 	/// Stores registered names
-	std::set<std::string> m_SavedNames;
+	SShard m_Shards[SHARDS];
 
     // Singleton implementation variables
 	static std::shared_ptr<SUniqueNameController> m_Instance;
 	static std::once_flag m_OneCreation;
+    /// registry bound to the thread
+	static thread_local SUniqueNameController* m_pCurrent;
 
-    // Disables copying and creation from outside of the class
-	SUniqueNameController();
+    // Disables copying
 	SUniqueNameController(const SUniqueNameController&);
 	SUniqueNameController& operator=(const SUniqueNameController&);
 };
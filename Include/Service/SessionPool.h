@@ -0,0 +1,64 @@
+/** \class CSessionPool
+ * Fixed pool of threads running simulation sessions.
+ *
+ * \par
+ * Run() queues the given number of steps of a session and returns a future with the
+ * last output of the chain. Different sessions run in parallel, runs of the same
+ * session are serialized by the session itself. Queued runs are finished before the
+ * pool is destroyed.
+ */
+
+#ifndef _CSESSIONPOOL
+#define _CSESSIONPOOL
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "SimSession.h"
+
+class CSessionPool
+{
+public:
+    /// \brief Starts the threads.
+    /// \param[in] nThreads Number of threads, 0 takes the number of hardware threads.
+    explicit CSessionPool(unsigned int nThreads = 0);
+
+    /// \brief Queues steps of the session.
+    /// \param[in] Session Session to run, kept alive until the run is finished.
+    /// \param[in] nSteps Number of steps.
+    /// \return Last output of the chain, or the exception thrown by the session.
+    std::future<double> Run(std::shared_ptr<CSimSession> Session, int nSteps);
+
+    /// \brief Returns number of threads.
+    size_t GetNumOfThreads() const
+    {
+        return m_vThreads.size();
+    }
+
+    ~CSessionPool();
+
+private:
+    CSessionPool(const CSessionPool&);
+    CSessionPool& operator=(const CSessionPool&);
+
+    /// \brief Thread routine, takes queued runs until the pool is stopped.
+    void Work();
+
+    /// threads of the pool
+    std::vector<std::thread> m_vThreads;
+    /// queued runs
+    std::deque<std::function<void()> > m_Tasks;
+    /// guards the queue
+    std::mutex m_Mutex;
+    /// signals a new run or the stop
+    std::condition_variable m_Signal;
+    /// are the threads to finish?
+    bool m_bStop;
+};
+
+#endif
@@ -0,0 +1,368 @@
+/** \class CSimSession
+ * Independent simulation session - a chain with everything needed to run it.
+ *
+ * \par
+ * The session owns the chain root, the arena of its nodes, the registries of names
+ * and IDs of its objects, the identification algorithm with the channel of identified
+ * models and the state of the simulation loop. Sessions share no mutable state, so
+ * many of them can be loaded and run at the same time, eg. in a CSessionPool. Objects
+ * of different sessions can have the same names and IDs. The seed of the noise belongs
+ * to the session as well, see SetSeed().
+ *
+ * \par
+ * Calls of one session are serialized by its mutexes, steps and whole runs by the run
+ * mutex, so runs of one session from different threads do not interleave. Objects
+ * created for the session outside of its methods have to be created inside a
+ * CSessionScope to be registered in the session.
+ *
+ * \par
+ * Parameters of a running chain are changed with SetParameter(). Edits are staged in
+ * a CParamChannel and applied together at the next step boundary, so the simulating
+ * thread is never paused and never sees an object half updated.
+ *
+ * \par
+ * Fork() copies the session at the current step, eg. to simulate a what-if branch with
+ * other settings in the background while this one keeps running.
+ *
+ * \par
+ * SaveCheckpoint() stores the complete state into a CCheckpoint file, so a long run can
+ * be resumed with LoadCheckpoint() after the application is closed.
+ *
+ * \par
+ * OpenChain() opens a large chain file lazily - only its CChainIndex is read, objects are
+ * created by branches when they are needed: by Materialize(), by Prepare() for the first
+ * regulator of the file and the object "SimObject", and by parameter changes of objects
+ * not created yet. Only the created branches are simulated, so a run of a plant library
+ * creates the few branches it uses. SaveChain() copies the objects not created yet from
+ * the file, a fork shares the index, a checkpoint holds the created objects.
+ */
+
+#ifndef _CSIMSESSION
+#define _CSIMSESSION
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "SObjectFactory.h"
+#include "SUniqueIDGenerator.h"
+#include "SUniqueNameController.h"
+#include "ARXIdentification.h"
+#include "ModelChannel.h"
+#include "ParamChannel.h"
+#include "Checkpoint.h"
+#include "ChainIndex.h"
+#include "boost\property_tree\ptree.hpp"
+
+class CSimSession
+{
+public:
+    /// \brief Creates a session with an empty chain and default identification.
+    CSimSession();
+
+    /// \brief Replaces the chain with the one described by the property tree.
+    /// \param[in] pt Tree read from a chain file, with the "Object" list of objects.
+    /// \return True if loaded, false on error, see GetLastError(). The chain is empty then.
+    bool LoadChain(const boost::property_tree::ptree& pt);
+
+    /// \brief Replaces the chain with the one stored as XML in the stream.
+    /// The document is read in one pass, objects are created as soon as their elements end.
+    /// \param[in] is Stream to read.
+    /// \return True if loaded, false on error, see GetLastError(). The chain is empty then.
+    bool LoadChain(std::istream& is);
+
+    /// \brief Replaces the chain with the one stored in the XML file.
+    /// \param[in] sFileName File to load.
+    /// \return True if loaded, false on error, see GetLastError().
+    bool LoadChain(const std::string& sFileName);
+
+    /// \brief Replaces the chain with the objects of the file without creating them.
+    /// The file is indexed, or its index is read from the cache, objects are created by Materialize().
+    /// \param[in] sFileName File to open, it has to stay unchanged while the chain is used.
+    /// \return True if indexed, false on error, see GetLastError(). The chain is empty then.
+    bool OpenChain(const std::string& sFileName);
+
+    /// \brief Creates the object of the opened file with its ancestors and its whole branch.
+    /// \param[in] sName Name of the object, or of a generator of the regulator.
+    /// \return True if the object is in the chain, also if it was loaded or created before.
+    bool Materialize(const std::string& sName);
+
+    /// \brief Returns index of the file opened by OpenChain(), nullptr if the chain is loaded completely.
+    /// Has to be used with the tree mutex held.
+    const CChainIndex* GetIndex() const
+    {
+        return m_Index.get();
+    }
+
+    /// \brief Returns description of the last load error.
+    const std::string& GetLastError() const
+    {
+        return m_sLastError;
+    }
+
+    /// \brief Stores the chain into the property tree. Staged parameter changes are applied first,
+    /// objects of a lazily opened chain not created yet are copied from the file.
+    /// \param[out] pt Tree to store the chain to.
+    void SaveChain(boost::property_tree::ptree& pt);
+
+    /// \brief Returns root of the chain.
+    std::shared_ptr<CSimObject> GetRoot() const
+    {
+        return m_SimRoot;
+    }
+
+    /// \brief Returns mutex guarding the chain, to be held when the chain is accessed from outside.
+    std::mutex& GetTreeMutex()
+    {
+        return m_TreeMutex;
+    }
+
+    /// \brief Checks if the chain has any objects to simulate, created or only indexed.
+    bool IsReady();
+
+    /// \brief Links the first regulator and the object named "SimObject" with the identification.
+    /// Of a lazily opened chain, their branches are created first.
+    /// \return False if any of them is missing, steps are then run without identification.
+    bool Prepare();
+
+    /// \brief Runs one step of the chain with negative feedback and identification.
+    /// \return Output of the chain.
+    double Step();
+
+    /// \brief Runs the given number of steps.
+    /// \param[in] nSteps Number of steps.
+    /// \return Last output of the chain.
+    double Run(int nSteps);
+
+    /// \brief Changes a parameter of an object or generator of the chain.
+    /// The change is applied at once if no step or run is in progress, before the next step otherwise.
+    /// \param[in] sTarget Name of the object or generator.
+    /// \param[in] sKey Name of the parameter, the same as in the chain file.
+    /// \param[in] sValue New value as edited, vectors as numbers separated by spaces.
+    /// \return False if the value is not a number, unknown targets and keys are reported in the log.
+    bool SetParameter(const std::string& sTarget, const std::string& sKey, const std::string& sValue);
+
+    /// \brief Resets memory of all the objects and the last output.
+    void Reset();
+
+    /// \brief Sets seed of the noise of the chain, it is saved with the chain root.
+    /// Loading a chain takes the seed stored in the file, the current one is kept if there is none.
+    void SetSeed(uint64_t nSeed);
+
+    /// \brief Returns seed of the noise of the chain.
+    uint64_t GetSeed() const
+    {
+        return m_nSeed;
+    }
+
+    /// \brief Returns last output of the chain.
+    double GetLastOutput() const
+    {
+        return m_dLastSimVal;
+    }
+
+    /// \brief Returns last input of the prepared regulator - the generator value.
+    double GetLastGeneratorValue() const
+    {
+        return *m_dRegInVal;
+    }
+
+    /// \brief Returns last output of the prepared regulator - the control value.
+    double GetLastControlValue() const
+    {
+        return *m_dRegOutVal;
+    }
+
+    /// \brief Copies the session with the chain, histories, generator positions and identification.
+    /// Both sessions continue from the current step independently, names and IDs are kept.
+    /// \return New session, prepared if this one is.
+    std::shared_ptr<CSimSession> Fork();
+
+    /// \brief Copies the complete state of the session - the chain with its current parameters,
+    /// histories, generator positions, integrators, identification and the last loop values.
+    /// Has to be called between steps, eg. from the thread running them.
+    /// \return Checkpoint to save or restore later.
+    std::shared_ptr<CCheckpoint> TakeCheckpoint();
+
+    /// \brief Copies the dynamic state of the session, reusing the buffers of the previous copy.
+    /// Has to be called between steps, eg. from the thread running them.
+    /// \param[out] State State to copy to.
+    /// \param[out] pChain Tree to store the chain with its current parameters to, nullptr to skip.
+    /// The chain is stored again only for a new revision, direct changes need MarkChainChanged().
+    /// \return Revision of the chain parameters the state belongs to, see GetChainRevision().
+    unsigned long CaptureState(CCheckpoint::SState& State, boost::property_tree::ptree* pChain = nullptr);
+
+    /// \brief Returns number that changes whenever the chain or its parameters are changed
+    /// by the session, eg. by loading or by SetParameter().
+    unsigned long GetChainRevision() const
+    {
+        return m_nChainRevision;
+    }
+
+    /// \brief Tells the session that objects of the chain were changed directly, outside of its methods.
+    void MarkChainChanged()
+    {
+        ++m_nChainRevision;
+    }
+
+    /// \brief Takes a checkpoint and writes it to the file in the background.
+    /// Only the state is copied by the calling thread, the chain file is formatted and written by another one.
+    /// \param[in] sFileName File to write, an existing one is replaced when the new one is complete.
+    /// \return Result of writing, the future may be dropped.
+    std::future<bool> SaveCheckpoint(const std::string& sFileName);
+
+    /// \brief Replaces the chain and the state of the session with the checkpoint.
+    /// \param[in] Checkpoint Checkpoint taken by TakeCheckpoint() or read with CCheckpoint::Open().
+    /// \return True if restored, false on error, see GetLastError(). The chain is empty then.
+    bool RestoreCheckpoint(const CCheckpoint& Checkpoint);
+
+    /// \brief Maps the checkpoint file and restores the session from it.
+    /// \param[in] sFileName File written by SaveCheckpoint().
+    /// \return True if restored, false on error, see GetLastError().
+    bool LoadCheckpoint(const std::string& sFileName);
+
+    /// \brief Replaces the identification algorithm.
+    /// \param[in] nNomDegree Nominator degree.
+    /// \param[in] nDenomDegree Denominator degree.
+    /// \param[in] nDelay Delay value.
+    /// \param[in] nTreshold Treshold for estimator safety.
+    /// \param[in] dForgettingFactor Forgetting factor.
+    void SetIdentificationParams(int nNomDegree, int nDenomDegree, int nDelay, int nTreshold,
+                                 double dForgettingFactor);
+
+    /// \brief Retrieves last identified nominator.
+    void GetLastIdentifiedNominator(std::vector<double>& vNom);
+
+    /// \brief Retrieves last identified denominator.
+    void GetLastIdentifiedDenominator(std::vector<double>& vDenom);
+
+    /// \brief Returns registry of IDs of the session objects.
+    SUniqueIDGenerator& GetIDs()
+    {
+        return *m_IDs;
+    }
+
+    /// \brief Returns registry of names of the session objects and generators.
+    SUniqueNameController& GetNames()
+    {
+        return *m_Names;
+    }
+
+    ~CSimSession();
+
+private:
+    CSimSession(const CSimSession&);
+    CSimSession& operator=(const CSimSession&);
+
+    /// \brief Applies the staged parameter changes. Has to be called with the tree mutex held.
+    void ApplyParameters();
+
+    /// \brief Runs one step, see Step(). Has to be called with the run mutex held.
+    double DoStep();
+
+    /// Objects of the chain being loaded by their names in the file.
+    typedef std::unordered_map<std::string, ISISO*> ObjectMap;
+
+    /// \brief Replaces the chain with an empty one in a new arena. Has to be called with the tree mutex held.
+    void ClearChain();
+
+    /// \brief Creates an object of the chain from its element of the chain file.
+    /// Objects with an unknown parent or type are skipped with a warning.
+    /// \param[in] v Element of the object.
+    /// \param[in,out] Objects Objects loaded so far, the new object is added.
+    /// \param[in] nLine Line of the element in the file, 0 if unknown.
+    /// \return Created object, the root for an object describing it, nullptr if skipped.
+    ISISO* AddObject(boost::property_tree::ptree::value_type const& v, ObjectMap& Objects, int nLine);
+
+    /// \brief Creates the indexed object with its ancestors and branch. Has to be called with the tree mutex held.
+    /// \return Created object, nullptr if it cannot be created.
+    ISISO* MaterializeEntry(size_t nEntry);
+
+    /// \brief Adds objects of the lazily opened chain not created yet to the saved chain, copied from
+    /// the file, and orders the saved objects like the file. Has to be called with the tree mutex held.
+    /// \param[in,out] pt Chain saved by the root.
+    void SaveIndexed(boost::property_tree::ptree& pt);
+
+    /// \brief Creates the indexed object whose parent is created already, in the order of the file among its siblings.
+    /// \param[in] is Stream of the chain file.
+    /// \param[in] nEntry Object to create.
+    /// \return False if the object is skipped.
+    bool LoadEntry(std::istream& is, size_t nEntry);
+
+    // registries are declared first, so they outlive the objects registered in them
+    /// IDs of the session objects
+    std::unique_ptr<SUniqueIDGenerator> m_IDs;
+    /// names of the session objects
+    std::unique_ptr<SUniqueNameController> m_Names;
+
+    /// Arena of the loaded chain
+    std::shared_ptr<CNodeArena> m_Arena;
+    /// Root of the simulation chain
+    std::shared_ptr<CSimObject> m_SimRoot;
+    /// Mutex for the chain access
+    std::mutex m_TreeMutex;
+    /// Mutex held by a step or a run, taken before the tree mutex
+    std::mutex m_RunMutex;
+    /// Parameter changes waiting for the next step
+    CParamChannel m_Params;
+    /// Index of the lazily opened chain file, empty if loaded completely
+    std::shared_ptr<const CChainIndex> m_Index;
+    /// Created object of every indexed one, nullptr if not created yet
+    std::vector<ISISO*> m_vIndexed;
+    /// Indexed children of the root in the order of the file
+    std::vector<size_t> m_vRootChildren;
+
+    /// ARX object identification algorithm
+    std::shared_ptr<CARXIdentification> m_ARXIdentAlg;
+    /// Channel the identified models are published to
+    std::shared_ptr<CModelChannel> m_ModelChannel;
+    /// Mutex for identification access
+    std::mutex m_IdentifyMutex;
+
+    /// Description of the last load error
+    std::string m_sLastError;
+    /// Changed with the chain or its parameters
+    std::atomic<unsigned long> m_nChainRevision;
+    /// Chain stored by the last CaptureState(), reused while the revision is the same
+    std::shared_ptr<const boost::property_tree::ptree> m_CapturedChain;
+    /// Revision of the captured chain
+    unsigned long m_nCapturedRevision;
+
+    /// Seed of the noise, key of the random numbers of all the nodes
+    std::atomic<uint64_t> m_nSeed;
+    /// Is the identification linked with the chain?
+    bool m_bPrepared;
+    /// Last output of the chain, read by GetLastOutput() while steps are running
+    std::atomic<double> m_dLastSimVal;
+    /// Last input and output of the regulator
+    std::shared_ptr<double> m_dRegInVal;
+    std::shared_ptr<double> m_dRegOutVal;
+    /// Last input and output of the identified object
+    std::shared_ptr<double> m_dObjInVal;
+    std::shared_ptr<double> m_dObjOutVal;
+};
+
+/** \class CSessionScope
+ * Binds registries of the session to the calling thread for the lifetime of the scope,
+ * objects and generators created meanwhile take their names and IDs from the session.
+ */
+class CSessionScope
+{
+public:
+    explicit CSessionScope(CSimSession& Session);
+    ~CSessionScope();
+
+private:
+    CSessionScope(const CSessionScope&);
+    CSessionScope& operator=(const CSessionScope&);
+
+    /// registries bound before the scope
+    SUniqueIDGenerator* m_pOldIDs;
+    SUniqueNameController* m_pOldNames;
+};
+
+#endif
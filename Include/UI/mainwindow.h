@@ -58,6 +58,14 @@ public Q_SLOTS:
     /// @param[in] treeNumber - number of widget (0 - simulation tree, 1 - property tree)
     void AddTreeWidgetElement(const QString &,const QString &,const QString &, const int);
 
+    /// \brief Replaces contents of the tree view with the given elements at once.
+    /// Parents have to be listed before their children.
+    /// @param[in] parents - names of the parent nodes, empty for top level nodes
+    /// @param[in] names - names of the nodes
+    /// @param[in] types - values of the nodes
+    /// @param[in] treeNumber - number of widget (0 - simulation tree, 1 - property tree)
+    void SetTreeWidget(const QStringList &parents, const QStringList &names, const QStringList &types, const int treeNumber);
+
     /// \brief Clears a given tree widget
     /// @param[in] treeNumber - number of widget (0 - simulation tree, 1 - property tree)s
     void ClearTreeWidget(const int treeNumber);
@@ -87,6 +95,8 @@ private Q_SLOTS:
 
     void on_actionLoad_Parameters_triggered();
 
+    void on_actionOpen_Library_triggered();
+
     void on_actionSave_Parameters_triggered();
 
     void on_simulationTree_itemSelectionChanged();
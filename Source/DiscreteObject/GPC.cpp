@@ -1,15 +1,27 @@
 #include "GPC.h"
-#include "SLogic.h"
+#include "ValueCodec.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/// Value of a disabled constraint.
+static const double NO_LIMIT = std::numeric_limits<double>::infinity();
 
 CGPC::CGPC(int nID, ObjType Type, std::string sName)
     : CRegulator(nID, Type, sName)
 {
-    m_RefObj.reset(new CSimObject());
+    m_nKind |= kindGPC;
+    m_FeedbackHistory.SetArena(m_pArena);
     m_StepObj.reset(new CSimObject());
-    m_ARIXObj.reset(new CSimObject());
 
     m_LastValueFromGen = 0;
     m_noTimesIdentified = 0;
+    m_nModelVersion = 0;
+    m_nModelRevision = 0;
+    m_bQValid = false;
+    m_nQRecomputeCount = 0;
+    m_nQPIterations = 0;
+    SetConstraints(-NO_LIMIT, NO_LIMIT, NO_LIMIT, -NO_LIMIT, NO_LIMIT);
     SetParams(2, 3, 0.5, 0.4, 1);
     SetObjectForPrediction();
 }
@@ -21,11 +33,14 @@ void CGPC::Initialize()
     m_LastValueFromGen = 0;
     m_noTimesIdentified = 0;
     m_bFirstNonZeroInput = false;
-    m_ARIXObj->ResetMemory();
     m_StepObj->ResetMemory();
-    m_RefObj->ResetMemory();
     CRegulator::ResetMemory();
 
+    // no previous solution to warm start from
+    m_vDU.resize(0);
+    m_vActive.clear();
+    m_nQPIterations = 0;
+
     // create q vector
     CreateQ();
 }
@@ -37,18 +52,75 @@ void CGPC::SetParams(int nL, int nH, double dRO, double dAlpha, int nK)
     m_nK = nK;
     m_dRO = dRO;
     m_dAlpha = dAlpha;
-    m_ARIXObj->SetK(m_nK);
 
+    // reference trajectory filter
+    m_vRefB.assign(1, 1 - dAlpha);
+    m_vRefA.assign(1, -dAlpha);
+}
 
-    std::vector<double> vB(1);
-    vB[0] = 1 - dAlpha;
+void CGPC::SetConstraints(double dUMin, double dUMax, double dDUMax, double dYMin, double dYMax)
+{
+    m_dUMin = dUMin;
+    m_dUMax = dUMax;
+    m_dDUMax = dDUMax;
+    m_dYMin = dYMin;
+    m_dYMax = dYMax;
+
+    // constraint matrix is rebuilt together with Q
+    m_bQValid = false;
+}
 
-    std::vector<double> vA(1);
-    vA[0] = -dAlpha;
+ISISO* CGPC::Clone(const std::shared_ptr<CNodeArena>& Arena) const
+{
+    CGPC* pClone = new (Arena) CGPC(*this);
 
-    m_RefObj->SetVectorA(std::move(vA));
-    m_RefObj->SetVectorB(std::move(vB));
-    m_RefObj->SetK(0);
+    // members are copied by value, the prediction object is simulated so it can not be shared
+    pClone->m_FeedbackHistory.SetArena(pClone->m_pArena);
+    pClone->m_StepObj.reset(AsSimObject(m_StepObj->Clone(nullptr)));
+
+    CloneChildren(pClone, Arena);
+    return pClone;
+}
+
+bool CGPC::SetParameter(const std::string& sKey, const std::vector<double>& vValue)
+{
+    if (vValue.size() != 1)
+        return CRegulator::SetParameter(sKey, vValue);
+
+    double d = vValue[0];
+    int n = static_cast<int>(d);
+
+    // horizons have to be positive and the control horizon can not exceed the prediction one
+    if (sKey == "L" && n >= 1 && n <= m_nH)
+        SetParams(n, m_nH, m_dRO, m_dAlpha, m_nK);
+    else if (sKey == "H" && n >= m_nL)
+        SetParams(m_nL, n, m_dRO, m_dAlpha, m_nK);
+    else if (sKey == "RO")
+        SetParams(m_nL, m_nH, d, m_dAlpha, m_nK);
+    else if (sKey == "Alpha")
+        SetParams(m_nL, m_nH, m_dRO, d, m_nK);
+    else if (sKey == "K" && n >= 0)
+        SetParams(m_nL, m_nH, m_dRO, m_dAlpha, n);
+    else if (sKey == "UMin")
+        SetConstraints(d, m_dUMax, m_dDUMax, m_dYMin, m_dYMax);
+    else if (sKey == "UMax")
+        SetConstraints(m_dUMin, d, m_dDUMax, m_dYMin, m_dYMax);
+    else if (sKey == "DUMax")
+        SetConstraints(m_dUMin, m_dUMax, d, m_dYMin, m_dYMax);
+    else if (sKey == "YMin")
+        SetConstraints(m_dUMin, m_dUMax, m_dDUMax, d, m_dYMax);
+    else if (sKey == "YMax")
+        SetConstraints(m_dUMin, m_dUMax, m_dDUMax, m_dYMin, d);
+    else
+        return CRegulator::SetParameter(sKey, vValue);
+
+    return true;
+}
+
+bool CGPC::IsConstrained() const
+{
+    return std::isfinite(m_dUMin) || std::isfinite(m_dUMax) || std::isfinite(m_dDUMax) ||
+           std::isfinite(m_dYMin) || std::isfinite(m_dYMax);
 }
 
 double CGPC::Simulate(double dInSample)
@@ -77,21 +149,24 @@ double CGPC::Simulate(double dInSample)
     CreateQ();
 
     // calculating free reponse
-    Eigen::VectorXd y0(m_nH);
-    CalcFreeResponse(y0);
-    std::cout << "y0: " << y0 << std::endl;
+    m_vY0.resize(m_nH);
+    CalcFreeResponse(m_vY0);
+    SIM_LOG_DEBUG("y0: " << m_vY0.transpose());
 
     // calculating reference response
-    Eigen::VectorXd w0(m_nH);
-    CalcRefValues(w0);
-    std::cout << "w0: " << w0 << std::endl;
+    m_vW0.resize(m_nH);
+    CalcRefValues(m_vW0);
+    SIM_LOG_DEBUG("w0: " << m_vW0.transpose());
 
-    auto x = (m_vQ.transpose())*(w0 - y0);
-
-    double DELTAu = x(0);
-    std::vector<double> vLastVal;
-    m_OutputHistory.RetriveNSamples(vLastVal, 1);
-    double u = vLastVal[0] + DELTAu;
+    double DELTAu;
+    if(IsConstrained())
+    {
+        DELTAu = CalcConstrainedIncrement(m_OutputHistory.GetSample(0));
+        SIM_LOG_DEBUG("QP iterations: " << m_nQPIterations << ", relaxed: " << m_QP.GetLastRelaxed());
+    }
+    else
+        DELTAu = m_vQ.dot(m_vW0 - m_vY0);
+    double u = m_OutputHistory.GetSample(0) + DELTAu;
 
     double dRetVal = u;
 
@@ -112,16 +187,41 @@ double CGPC::Simulate(double dInSample)
     return dRetVal;
 }
 
+size_t CGPC::GetSnapshotSize() const
+{
+    return CRegulator::GetSnapshotSize() + m_FeedbackHistory.GetSnapshotSize() + sizeof(m_LastValueFromGen) +
+           sizeof(m_noTimesIdentified) + sizeof(m_bFirstNonZeroInput);
+}
+
+unsigned char* CGPC::SaveSnapshot(unsigned char* p) const
+{
+    p = CRegulator::SaveSnapshot(p);
+    p = m_FeedbackHistory.SaveSnapshot(p);
+    p = PutSnapshot(p, m_LastValueFromGen);
+    p = PutSnapshot(p, m_noTimesIdentified);
+    return PutSnapshot(p, m_bFirstNonZeroInput);
+}
+
+const unsigned char* CGPC::LoadSnapshot(const unsigned char* p)
+{
+    p = CRegulator::LoadSnapshot(p);
+    p = m_FeedbackHistory.LoadSnapshot(p);
+    p = GetSnapshot(p, m_LastValueFromGen);
+    p = GetSnapshot(p, m_noTimesIdentified);
+    return GetSnapshot(p, m_bFirstNonZeroInput);
+}
+
 void CGPC::SetObjectForPrediction(ISISO* CObj)
 {
     if(CObj != NULL)
     {
-        CSimObject* obj = dynamic_cast<CSimObject*>(CObj);
+        CSimObject* obj = AsSimObject(CObj);
 
         // TODO
 
         m_StepObj.reset(obj);
         m_StepObj->SetK(0);
+        ++m_nModelRevision;
 
         return;
     }
@@ -133,14 +233,10 @@ void CGPC::SetObjectForPrediction(ISISO* CObj)
     vB[0] = 0.5;
     std::vector<double> vA(1);
     vA[0] = -0.5;
-    std::vector<double> vA2 = vA;
-    std::vector<double> vB2 = vB;
     m_StepObj->SetVectorA(std::move(vA));
     m_StepObj->SetVectorB(std::move(vB));
     m_StepObj->SetK(0);
-    m_ARIXObj->SetVectorA(std::move(vA2));
-    m_ARIXObj->SetVectorB(std::move(vB2));
-    m_ARIXObj->SetK(m_nK);
+    ++m_nModelRevision;
 }
 
 void CGPC::Identify()
@@ -155,87 +251,208 @@ void CGPC::Identify()
         return;
     }
 
-    std::vector<double> vNom, vNom2;
-    SLogic::GetInstance().GetLastIdentifiedNominator(vNom);
-    vNom2 = vNom;
+    // rebuild the predictor only when a new model has been published
+    if(!m_ModelChannel || m_ModelChannel->GetVersion() == m_nModelVersion)
+        return;
 
-    std::vector<double> vDenom, vDenom2;
-    SLogic::GetInstance().GetLastIdentifiedDenominator(vDenom);
-    vDenom2 = vDenom;
+    m_nModelVersion = m_ModelChannel->Read(m_vNom, m_vDenom);
 
-    m_StepObj->SetVectorA(std::move(vDenom));
-    m_StepObj->SetVectorB(std::move(vNom));
-    m_ARIXObj->SetVectorA(std::move(vDenom2));
-    m_ARIXObj->SetVectorB(std::move(vNom2));
+    m_StepObj->SetVectorA(std::vector<double>(m_vDenom));
+    m_StepObj->SetVectorB(std::vector<double>(m_vNom));
+    ++m_nModelRevision;
 }
 
 void CGPC::CreateQ()
 {
-    Eigen::MatrixXd ddQp(m_nH, m_nL);
-
     Identify();
 
-    m_StepObj->ResetMemory();
-    // fill with predicted values
-    std::vector<double> v(m_nH+m_nL);
-    for(int i=m_nH-1; i>=0; --i)
-        v[i] = (m_StepObj->Simulate(1));
-    for(int i=0; i<m_nL; ++i)
-        for(int j=m_nH; j>0; --j)
-            ddQp(j-1,i) = v[m_nH-j+i];
-
-    // calculate q
-    Eigen::MatrixXd ddQ = ddQp;
-    ddQ = ddQ.transpose()*ddQ;
-    ddQ = ddQ + m_dRO*Eigen::MatrixXd::Identity(ddQ.rows(), ddQ.cols());
-    ddQ = ddQ.inverse();
-    ddQ = ddQ*ddQp.transpose();
-    m_vQ = ddQ.row(0);
-}
+    // Q depends only on the model and L, H, RO - reuse it while they are unchanged
+    if(m_bQValid && m_nQModelRevision == m_nModelRevision &&
+       m_nQL == m_nL && m_nQH == m_nH && m_dQRO == m_dRO)
+        return;
 
-void CGPC::CalcFreeResponse(Eigen::VectorXd& vOut)
-{
-    m_ARIXObj->ResetMemory();
+    // interpolate q from the table if it covers the model, the constrained problem needs the step response anyway
+    m_vQ.resize(m_nH);
+    if(!m_GainTable || IsConstrained() ||
+       !m_GainTable->Interpolate(m_StepObj->GetVectorA(), m_StepObj->GetVectorB(), m_nL, m_nH, m_dRO, m_vQ.data()))
+    {
+        // predict the step response
+        m_StepObj->ResetMemory();
+        m_vStep.resize(m_nH);
+        for(int i=0; i<m_nH; ++i)
+            m_vStep[i] = m_StepObj->Simulate(1);
 
-    std::vector<double> v;
-    m_OutputHistory.RetriveNSamples(v);
-    m_ARIXObj->SetInputHistory(v);
+        // calculate q
+        m_GainSolver.Solve(m_vStep.data(), m_nH, m_nL, m_dRO, m_vQ);
 
-    std::vector<double> v2;
-    m_FeedbackHistory.RetriveNSamples(v2);
-    m_ARIXObj->SetOutputHistory(v2);
+        if(IsConstrained())
+            CreateConstraints();
+    }
 
-    for(int i=0; i<m_nK; ++i)
-        vOut(0) = m_ARIXObj->Simulate(v[0]);
-    for(int i=0; i<m_nH; ++i)
-        vOut(i) = m_ARIXObj->Simulate(v[0]);
+    // remember what the vector was calculated for
+    m_bQValid = true;
+    m_nQModelRevision = m_nModelRevision;
+    m_nQL = m_nL;
+    m_nQH = m_nH;
+    m_dQRO = m_dRO;
+    ++m_nQRecomputeCount;
 }
 
-void CGPC::CalcRefValues(Eigen::VectorXd& vOut)
+void CGPC::CreateConstraints()
 {
-    // reset reference
-    m_RefObj->ResetMemory();
+    // G(r,c) = s(r-c+1) below the diagonal, 0 above
+    m_mG.setZero(m_nH, m_nL);
+    for(int c=0; c<m_nL; ++c)
+        for(int r=c; r<m_nH; ++r)
+            m_mG(r, c) = m_vStep[r - c];
+
+    // J = |w0 - y0 - G du|^2 + ro |du|^2
+    Eigen::MatrixXd mHessian = m_mG.transpose()*m_mG;
+    mHessian.diagonal().array() += m_dRO;
+    m_QP.SetHessian(mHessian);
+
+    // one row per horizon sample of every finite constraint, bounds are filled every step
+    m_vRowKind.clear();
+    m_vRowSample.clear();
+    auto addRows = [this](ConstraintRow kind, double dLimit, int nSamples)
+    {
+        if(!std::isfinite(dLimit))
+            return;
+        for(int j=0; j<nSamples; ++j)
+        {
+            m_vRowKind.push_back(kind);
+            m_vRowSample.push_back(j);
+        }
+    };
+    addRows(rowDUMax, m_dDUMax, m_nL);
+    addRows(rowDUMin, m_dDUMax, m_nL);
+    addRows(rowUMax, m_dUMax, m_nL);
+    addRows(rowUMin, m_dUMin, m_nL);
+    addRows(rowYMax, m_dYMax, m_nH);
+    addRows(rowYMin, m_dYMin, m_nH);
+
+    m_mA.setZero(m_vRowKind.size(), m_nL);
+    for(size_t r=0; r<m_vRowKind.size(); ++r)
+    {
+        int j = m_vRowSample[r];
+        switch(m_vRowKind[r])
+        {
+        case rowDUMax:
+            m_mA(r, j) = 1;
+            break;
+        case rowDUMin:
+            m_mA(r, j) = -1;
+            break;
+        case rowUMax:
+            // u(k+j) = u(k-1) + du(0) + ... + du(j)
+            m_mA.row(r).head(j + 1).setOnes();
+            break;
+        case rowUMin:
+            m_mA.row(r).head(j + 1).setConstant(-1);
+            break;
+        case rowYMax:
+            m_mA.row(r) = m_mG.row(j);
+            break;
+        case rowYMin:
+            m_mA.row(r) = -m_mG.row(j);
+            break;
+        }
+    }
 
-    // setting feedback as reference output history
-    std::vector<double> y;
-    m_FeedbackHistory.RetriveNSamples(y);
-    m_RefObj->SetOutputHistory(y);
+    // the old solution does not fit the new problem
+    m_vDU.resize(0);
+    m_vActive.clear();
+}
 
-    std::vector<double> u;
-    m_OutputHistory.RetriveNSamples(u);
-    m_RefObj->SetInputHistory(u);
+double CGPC::CalcConstrainedIncrement(double dLastU)
+{
+    m_vF.noalias() = -m_mG.transpose()*(m_vW0 - m_vY0);
 
-    std::cout << v2str(y) << std::endl;
+    m_vBound.resize(m_vRowKind.size());
+    for(size_t r=0; r<m_vRowKind.size(); ++r)
+    {
+        int j = m_vRowSample[r];
+        switch(m_vRowKind[r])
+        {
+        case rowDUMax:
+        case rowDUMin:
+            m_vBound(r) = m_dDUMax;
+            break;
+        case rowUMax:
+            m_vBound(r) = m_dUMax - dLastU;
+            break;
+        case rowUMin:
+            m_vBound(r) = dLastU - m_dUMin;
+            break;
+        case rowYMax:
+            m_vBound(r) = m_dYMax - m_vY0(j);
+            break;
+        case rowYMin:
+            m_vBound(r) = m_vY0(j) - m_dYMin;
+            break;
+        }
+    }
+
+    // warm start - previous solution and active set moved one sample forward
+    if(m_vDU.size() == m_nL)
+    {
+        for(int j=0; j+1<m_nL; ++j)
+            m_vDU(j) = m_vDU(j + 1);
+        m_vDU(m_nL - 1) = 0;
+    }
+    else
+        m_vDU.setZero(m_nL);
 
-    SaveGeneratorHistory();
+    // the solver keeps the control limits only from a start satisfying them, output limits are soft
+    LimitWarmStart(dLastU);
+    int nInputRows = static_cast<int>(std::count_if(m_vRowKind.begin(), m_vRowKind.end(),
+                                                    [](ConstraintRow kind) { return kind < rowYMax; }));
+
+    size_t nActive = 0;
+    for(size_t k=0; k<m_vActive.size(); ++k)
+        if(m_vRowSample[m_vActive[k]] > 0)
+            m_vActive[nActive++] = m_vActive[k] - 1;
+    m_vActive.resize(nActive);
+
+    m_QP.Solve(m_vF, m_mA, m_vBound, m_vDU, m_vActive, nInputRows);
+    m_nQPIterations = m_QP.GetLastIterations();
+
+    return m_vDU(0);
+}
 
-    // simulate H samples
-    for(int i=0; i<m_nH; ++i)
+void CGPC::LimitWarmStart(double dLastU)
+{
+    double dU = dLastU;
+    for(int j=0; j<m_nL; ++j)
     {
-        vOut(i) = m_RefObj->Simulate(GetNextGeneratorValue());
+        double dNext = std::min(std::max(dU + m_vDU(j), m_dUMin), m_dUMax);
+        m_vDU(j) = std::min(std::max(dNext - dU, -m_dDUMax), m_dDUMax);
+        dU += m_vDU(j);
     }
+}
+
+void CGPC::CalcFreeResponse(Eigen::VectorXd& vOut)
+{
+    // plant model driven by the last control value, starting from the recorded histories
+    m_Predictor.FreeResponse(m_StepObj->GetVectorA(), m_StepObj->GetVectorB(), m_nK,
+                             m_OutputHistory, m_FeedbackHistory, m_nH, vOut.data());
+}
+
+void CGPC::CalcRefValues(Eigen::VectorXd& vOut)
+{
+#if SIM_LOG_LEVEL <= SIM_LOG_LEVEL_DEBUG
+    std::vector<double> y;
+    m_FeedbackHistory.RetriveNSamples(y);
+    SIM_LOG_DEBUG("feedback: " << v2str(y));
+#endif
 
-    LoadGeneratorHistory();
+    // predict H generator samples
+    m_vRefInput.resize(m_nH);
+    FillGeneratorValues(m_vRefInput.data(), m_nH);
+
+    // filter them starting from the current feedback value
+    m_Predictor.ForcedResponse(m_vRefA, m_vRefB, 0, m_OutputHistory, m_FeedbackHistory,
+                               m_vRefInput.data(), m_nH, vOut.data());
 }
 
 void CGPC::SaveState(boost::property_tree::ptree& pt) const
@@ -254,6 +471,21 @@ void CGPC::SaveState(boost::property_tree::ptree& pt) const
     node.put("Setpoint", m_dSV);
     node.put("K", m_nK);
 
+    if(!m_sGainTableFile.empty())
+        node.put("GainTable", m_sGainTableFile);
+
+    // only finite constraints are stored
+    if(std::isfinite(m_dUMin))
+        node.put("UMin", m_dUMin);
+    if(std::isfinite(m_dUMax))
+        node.put("UMax", m_dUMax);
+    if(std::isfinite(m_dDUMax))
+        node.put("DUMax", m_dDUMax);
+    if(std::isfinite(m_dYMin))
+        node.put("YMin", m_dYMin);
+    if(std::isfinite(m_dYMax))
+        node.put("YMax", m_dYMax);
+
     // if doesnt have a parent insert 0
     if (m_Parent != nullptr)
         node.put("Parent", m_Parent->GetName());
@@ -269,31 +501,47 @@ void CGPC::SaveState(boost::property_tree::ptree& pt) const
     node.put("<xmlattr>.Name", m_sName);
 
     // ask children to write their state data
-    auto it = m_lChildren.begin();
-    for (; it != m_lChildren.end(); ++it)
+    auto it = m_vChildren.begin();
+    for (; it != m_vChildren.end(); ++it)
         (*it)->SaveState(pt);
 }
 
 void CGPC::LoadState(boost::property_tree::ptree::value_type const& v)
 {
-    boost::property_tree::ptree ptGen = v.second;
+    const boost::property_tree::ptree& ptGen = v.second;
     // Load regulator data
-    double L = v.second.get<double>("L"),
-           H = v.second.get<double>("H"),
-           RO = v.second.get<double>("RO"),
-           Alpha = v.second.get<double>("Alpha"),
-           K = v.second.get<double>("K");
+    double L = CValueCodec::Get<double>(v.second, "L"),
+           H = CValueCodec::Get<double>(v.second, "H"),
+           RO = CValueCodec::Get<double>(v.second, "RO"),
+           Alpha = CValueCodec::Get<double>(v.second, "Alpha"),
+           K = CValueCodec::Get<double>(v.second, "K");
 
     SetParams(L, H, RO, Alpha, K);
-    SetSetpointValue(v.second.get<double>("Setpoint"));
-
-#ifdef _DEBUG
-    std::cout << "L: " << v.second.get<double>("L") << std::endl;
-    std::cout << "Setpoint: " << v.second.get<double>("Setpoint") << std::endl;
-    std::cout << "H: " << v.second.get<double>("H") << std::endl;
-    std::cout << "RO: " << v.second.get<double>("RO") << std::endl;
-    std::cout << "Alpha: " << v.second.get<double>("Alpha") << std::endl;
-#endif
+    SetSetpointValue(CValueCodec::Get<double>(v.second, "Setpoint"));
+
+    // constraints are optional
+    SetConstraints(CValueCodec::Get<double>(v.second, "UMin", -NO_LIMIT),
+                   CValueCodec::Get<double>(v.second, "UMax", NO_LIMIT),
+                   CValueCodec::Get<double>(v.second, "DUMax", NO_LIMIT),
+                   CValueCodec::Get<double>(v.second, "YMin", -NO_LIMIT),
+                   CValueCodec::Get<double>(v.second, "YMax", NO_LIMIT));
+
+    // optional table of precomputed gains
+    m_sGainTableFile = v.second.get<std::string>("GainTable", "");
+    if(!m_sGainTableFile.empty())
+    {
+        std::shared_ptr<CGainTable> table(new CGainTable);
+        if(table->Load(m_sGainTableFile))
+            SetGainTable(table);
+        else
+        {
+            SIM_LOG_WARNING(m_sName << ": cannot load gain table " << m_sGainTableFile);
+            SetGainTable(nullptr);
+        }
+    }
+
+    SIM_LOG_DEBUG(m_sName << " L: " << L << " Setpoint: " << v.second.get<double>("Setpoint")
+                  << " H: " << H << " RO: " << RO << " Alpha: " << Alpha);
 
     LoadGeneratorState(ptGen);
 }
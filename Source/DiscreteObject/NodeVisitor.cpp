@@ -0,0 +1,27 @@
+#include "NodeVisitor.h"
+#include "PRegulator.h"
+#include "PIDRegulator.h"
+#include "GPC.h"
+
+void CNodeVisitor::Visit(CSimObject&)
+{
+}
+
+void CNodeVisitor::Visit(CRegulator&)
+{
+}
+
+void CNodeVisitor::Visit(CPRegulator& Reg)
+{
+    Visit(static_cast<CRegulator&>(Reg));
+}
+
+void CNodeVisitor::Visit(CPIDRegulator& Reg)
+{
+    Visit(static_cast<CRegulator&>(Reg));
+}
+
+void CNodeVisitor::Visit(CGPC& Reg)
+{
+    Visit(static_cast<CRegulator&>(Reg));
+}
@@ -1,10 +1,12 @@
 #include "PIDRegulator.h"
+#include "ValueCodec.h"
 
 
 CPIDRegulator::CPIDRegulator(int nID, ObjType Type, std::string sName) : CRegulator(nID, Type, sName),
     m_dK(1.0), m_dTp(0.0), m_dTi(0.0), m_dILast(0.0), m_dDLast(0.0), m_dTd(0.0), m_nN(0.0),
     m_dLastInput(0.0)
 {
+    m_nKind |= kindPIDRegulator;
 }
 
 double CPIDRegulator::Simulate(double dInSample)
@@ -85,35 +87,76 @@ void CPIDRegulator::SaveState(boost::property_tree::ptree& pt) const
 	node.put("<xmlattr>.Name", m_sName);
 
     // ask children to write their state data
-	auto it = m_lChildren.begin();
-	for (; it != m_lChildren.end(); ++it)
+	auto it = m_vChildren.begin();
+	for (; it != m_vChildren.end(); ++it)
 		(*it)->SaveState(pt);
 
 }
 
+size_t CPIDRegulator::GetSnapshotSize() const
+{
+    return CRegulator::GetSnapshotSize() + sizeof(m_dILast) + sizeof(m_dDLast) + sizeof(m_dLastInput);
+}
+
+unsigned char* CPIDRegulator::SaveSnapshot(unsigned char* p) const
+{
+    p = CRegulator::SaveSnapshot(p);
+    p = PutSnapshot(p, m_dILast);
+    p = PutSnapshot(p, m_dDLast);
+    return PutSnapshot(p, m_dLastInput);
+}
+
+const unsigned char* CPIDRegulator::LoadSnapshot(const unsigned char* p)
+{
+    p = CRegulator::LoadSnapshot(p);
+    p = GetSnapshot(p, m_dILast);
+    p = GetSnapshot(p, m_dDLast);
+    return GetSnapshot(p, m_dLastInput);
+}
+
 CPIDRegulator::~CPIDRegulator()
 {
 }
 
+ISISO* CPIDRegulator::Clone(const std::shared_ptr<CNodeArena>& Arena) const
+{
+    CPIDRegulator* pClone = new (Arena) CPIDRegulator(*this);
+    CloneChildren(pClone, Arena);
+    return pClone;
+}
+
+bool CPIDRegulator::SetParameter(const std::string& sKey, const std::vector<double>& vValue)
+{
+    if (vValue.size() == 1 && sKey == "Gain")
+        SetGain(vValue[0]);
+    else if (vValue.size() == 1 && sKey == "Tp")
+        SetTp(vValue[0]);
+    else if (vValue.size() == 1 && sKey == "Ti")
+        SetTi(vValue[0]);
+    else if (vValue.size() == 1 && sKey == "Td")
+        SetTd(vValue[0]);
+    else if (vValue.size() == 1 && sKey == "N")
+        SetN(static_cast<int>(vValue[0]));
+    else
+        return CRegulator::SetParameter(sKey, vValue);
+
+    return true;
+}
+
 void CPIDRegulator::LoadState(boost::property_tree::ptree::value_type const& v)
 {
-    boost::property_tree::ptree ptGen = v.second;
+    const boost::property_tree::ptree& ptGen = v.second;
     // Load regulator data
-    SetGain(v.second.get<double>("Gain"));
-    SetTp(v.second.get<double>("Tp"));
-    SetTi(v.second.get<double>("Ti"));
-    SetTd(v.second.get<double>("Td"));
-    SetN(v.second.get<int>("N"));
-    SetSetpointValue(v.second.get<double>("Setpoint"));
-
-#ifdef _DEBUG
-    std::cout << "Gain: " << v.second.get<double>("Gain") << std::endl;
-    std::cout << "Setpoint: " << v.second.get<double>("Setpoint") << std::endl;
-    std::cout << "Tp: " << v.second.get<double>("Tp") << std::endl;
-    std::cout << "Ti: " << v.second.get<double>("Ti") << std::endl;
-    std::cout << "Td: " << v.second.get<double>("Td") << std::endl;
-    std::cout << "N: " << v.second.get<int>("N") << std::endl;
-#endif
+    SetGain(CValueCodec::Get<double>(v.second, "Gain"));
+    SetTp(CValueCodec::Get<double>(v.second, "Tp"));
+    SetTi(CValueCodec::Get<double>(v.second, "Ti"));
+    SetTd(CValueCodec::Get<double>(v.second, "Td"));
+    SetN(CValueCodec::Get<int>(v.second, "N"));
+    SetSetpointValue(CValueCodec::Get<double>(v.second, "Setpoint"));
+
+    SIM_LOG_DEBUG(m_sName << " Gain: " << v.second.get<double>("Gain") << " Setpoint: " << v.second.get<double>("Setpoint")
+                  << " Tp: " << v.second.get<double>("Tp") << " Ti: " << v.second.get<double>("Ti")
+                  << " Td: " << v.second.get<double>("Td") << " N: " << v.second.get<int>("N"));
 
     LoadGeneratorState(ptGen);
 }
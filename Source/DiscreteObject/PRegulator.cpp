@@ -1,8 +1,10 @@
 #include "PRegulator.h"
+#include "ValueCodec.h"
 
 
 CPRegulator::CPRegulator(int nID, ObjType Type, std::string sName) : CRegulator(nID, Type, sName), m_dK(1.0)
 {
+    m_nKind |= kindPRegulator;
 }
 
 double CPRegulator::Simulate(double dInSample)
@@ -53,23 +55,38 @@ void CPRegulator::SaveState(boost::property_tree::ptree& pt) const
 	node.put("<xmlattr>.Name", m_sName);
 
     // ask children to write their state data
-	auto it = m_lChildren.begin();
-	for (; it != m_lChildren.end(); ++it)
+	auto it = m_vChildren.begin();
+	for (; it != m_vChildren.end(); ++it)
 		(*it)->SaveState(pt);
 
 }
 
+ISISO* CPRegulator::Clone(const std::shared_ptr<CNodeArena>& Arena) const
+{
+    CPRegulator* pClone = new (Arena) CPRegulator(*this);
+    CloneChildren(pClone, Arena);
+    return pClone;
+}
+
+bool CPRegulator::SetParameter(const std::string& sKey, const std::vector<double>& vValue)
+{
+    if (sKey == "Gain" && vValue.size() == 1)
+    {
+        SetGain(vValue[0]);
+        return true;
+    }
+
+    return CRegulator::SetParameter(sKey, vValue);
+}
+
 void CPRegulator::LoadState(boost::property_tree::ptree::value_type const& v)
 {
-    boost::property_tree::ptree ptGen = v.second;
+    const boost::property_tree::ptree& ptGen = v.second;
     // Load regulator data
-    SetGain(v.second.get<double>("Gain"));
-    SetSetpointValue(v.second.get<double>("Setpoint"));
+    SetGain(CValueCodec::Get<double>(v.second, "Gain"));
+    SetSetpointValue(CValueCodec::Get<double>(v.second, "Setpoint"));
 
-#ifdef _DEBUG
-    std::cout << "Gain: " << v.second.get<double>("Gain") << std::endl;
-    std::cout << "Setpoint: " << v.second.get<double>("Setpoint") << std::endl;
-#endif
+    SIM_LOG_DEBUG(m_sName << " Gain: " << v.second.get<double>("Gain") << " Setpoint: " << v.second.get<double>("Setpoint"));
     LoadGeneratorState(ptGen);
 }
 
@@ -1,8 +1,26 @@
 #include "Regulator.h"
+#include "ValueCodec.h"
+#include <algorithm>
 
 
 CRegulator::CRegulator(int nID, ObjType Type, std::string sName) : CSimNode(nID, Type, sName), m_dSV(0.0)
 {
+    m_nKind |= kindRegulator;
+}
+
+CRegulator::CRegulator(const CRegulator& other) : CSimNode(other), m_dSV(other.m_dSV)
+{
+    for (auto& gen : other.m_lGen)
+        m_lGen.push_back(std::shared_ptr<IGenerator>(gen->Clone()));
+}
+
+bool CRegulator::SetParameter(const std::string& sKey, const std::vector<double>& vValue)
+{
+    if (sKey != "Setpoint" || vValue.size() != 1)
+        return false;
+
+    SetSetpointValue(vValue[0]);
+    return true;
 }
 
 void CRegulator::ResetGenerators()
@@ -18,6 +36,33 @@ void CRegulator::ResetMemory()
     ResetGenerators();
 }
 
+size_t CRegulator::GetSnapshotSize() const
+{
+    size_t nSize = CSimNode::GetSnapshotSize();
+    for (auto& gen : m_lGen)
+        nSize += gen->GetSnapshotSize();
+
+    return nSize;
+}
+
+unsigned char* CRegulator::SaveSnapshot(unsigned char* p) const
+{
+    p = CSimNode::SaveSnapshot(p);
+    for (auto& gen : m_lGen)
+        p = gen->SaveSnapshot(p);
+
+    return p;
+}
+
+const unsigned char* CRegulator::LoadSnapshot(const unsigned char* p)
+{
+    p = CSimNode::LoadSnapshot(p);
+    for (auto& gen : m_lGen)
+        p = gen->LoadSnapshot(p);
+
+    return p;
+}
+
 void CRegulator::GetName(boost::property_tree::ptree& nameTree) const
 {
     using boost::property_tree::ptree;
@@ -56,6 +101,10 @@ IGenerator* CRegulator::FindGenerator(const std::string& sName)
 
 ISISO* CRegulator::SearchObject(const std::string& s)
 {
+    // generators are in the index as well
+    if (GetIndex())
+        return CSimNode::SearchObject(s);
+
     //if the searched name belongs to a generator return this regulator
     auto it = m_lGen.begin();
     for (; it != m_lGen.end(); ++it)
@@ -65,6 +114,26 @@ ISISO* CRegulator::SearchObject(const std::string& s)
     return CSimNode::SearchObject(s);
 }
 
+void CRegulator::SetIndex(CNodeIndex* pIndex)
+{
+    if (m_pIndex)
+        for (auto& gen : m_lGen)
+            m_pIndex->RemoveGenerator(gen.get());
+
+    CSimNode::SetIndex(pIndex);
+
+    if (m_pIndex)
+        for (auto& gen : m_lGen)
+            m_pIndex->AddGenerator(gen.get(), this);
+}
+
+void CRegulator::SetRandomKey(uint64_t nKey)
+{
+    CSimNode::SetRandomKey(nKey);
+    for (auto& gen : m_lGen)
+        gen->SetRandomKey(nKey);
+}
+
 void CRegulator::LoadGeneratorState(const boost::property_tree::ptree& pt)
 {
     // Create generators from stored data
@@ -85,7 +154,7 @@ void CRegulator::LoadGeneratorState(const boost::property_tree::ptree& pt)
 
             if(!gen)
             {
-                GenType type = static_cast<GenType>(vals.second.get<int>("Type"));
+                GenType type = static_cast<GenType>(CValueCodec::Get<int>(vals.second, "Type"));
                 gen = SGeneratorFactory::GetInstance().CreateGenerator(type);
                 bNewGen = true;
             }
@@ -127,6 +196,21 @@ double CRegulator::GetNextGeneratorValue()
     return dSum;
 }
 
+void CRegulator::FillGeneratorValues(double* out, size_t n, size_t offset)
+{
+    std::fill(out, out + n, 0.0);
+    m_vGenBuffer.resize(n);
+
+    // sum generator blocks in the same order GetNextGeneratorValue() does
+    auto it = m_lGen.begin();
+    for (; it != m_lGen.end(); ++it)
+    {
+        it->get()->Fill(m_vGenBuffer.data(), n, offset);
+        for (size_t i = 0; i < n; ++i)
+            out[i] += m_vGenBuffer[i];
+    }
+}
+
 CRegulator::~CRegulator()
 {
 }
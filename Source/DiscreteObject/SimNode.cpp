@@ -1,13 +1,74 @@
 #include "SimNode.h"
-#include "SObjectFactory.h"
+#include "NodeVisitor.h"
+#include <algorithm>
 
-CSimNode::CSimNode(int nID, ObjType Type, std::string const &sName) : m_Parent(nullptr),
+/// Size of the block header keeping the arena of a node, the node follows it aligned.
+static const size_t NODE_HEADER = (sizeof(std::shared_ptr<CNodeArena>) + alignof(std::max_align_t) - 1)
+                                  / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+/// Arena of the node being constructed by the current thread.
+static thread_local CNodeArena* t_pNewArena = nullptr;
+
+void* CSimNode::operator new(size_t nSize)
+{
+    unsigned char* pBlock = static_cast<unsigned char*>(::operator new(nSize + NODE_HEADER));
+    new (pBlock) std::shared_ptr<CNodeArena>();
+    t_pNewArena = nullptr;
+    return pBlock + NODE_HEADER;
+}
+
+void* CSimNode::operator new(size_t nSize, const std::shared_ptr<CNodeArena>& Arena)
+{
+    if (!Arena)
+        return CSimNode::operator new(nSize);
+
+    unsigned char* pBlock = static_cast<unsigned char*>(Arena->Allocate(nSize + NODE_HEADER));
+    new (pBlock) std::shared_ptr<CNodeArena>(Arena);
+    t_pNewArena = Arena.get();
+    return pBlock + NODE_HEADER;
+}
+
+void CSimNode::operator delete(void* p, size_t nSize)
+{
+    if (p == nullptr)
+        return;
+
+    unsigned char* pBlock = static_cast<unsigned char*>(p) - NODE_HEADER;
+    std::shared_ptr<CNodeArena>* pHeader = reinterpret_cast<std::shared_ptr<CNodeArena>*>(pBlock);
+
+    // the arena is released after the block, it may be the last node keeping it
+    std::shared_ptr<CNodeArena> arena(std::move(*pHeader));
+    pHeader->~shared_ptr();
+    if (arena)
+        arena->Free(pBlock, nSize + NODE_HEADER);
+    else
+        ::operator delete(pBlock);
+}
+
+void CSimNode::operator delete(void* p, const std::shared_ptr<CNodeArena>&)
+{
+    // size of the node is not known here, only the header is returned to the arena for reuse
+    CSimNode::operator delete(p, size_t(0));
+}
+
+CSimNode::CSimNode(int nID, ObjType Type, std::string const &sName) : m_pIDs(&SUniqueIDGenerator::GetCurrent()),
+    m_pNames(&SUniqueNameController::GetCurrent()), m_nID(0), m_Parent(nullptr),
     //m_InWindow(nullptr),
     //m_OutWindow(nullptr),
     //m_FunOut(nullptr),
     //m_FunIn(nullptr),
-    m_oStream(static_cast<std::ostream*>(nullptr))
+    m_nKind(0), m_pIndex(nullptr), m_nRandomKey(0),
+    m_oStream(static_cast<std::ostream*>(nullptr)), m_pArena(t_pNewArena)
 {
+    // histories and children of a node in an arena are placed next to it
+    t_pNewArena = nullptr;
+    if (m_pArena)
+    {
+        m_OutputHistory.SetArena(m_pArena);
+        m_InputHistory.SetArena(m_pArena);
+        m_vChildren = ChildVector(CArenaAllocator<std::shared_ptr<ISISO> >(m_pArena));
+    }
+
     std::string sName2 = sName;
 	try
 	{
@@ -20,33 +81,84 @@ CSimNode::CSimNode(int nID, ObjType Type, std::string const &sName) : m_Parent(n
         // TODO exception handling
 	}
 
-#ifdef _DEBUG
-	/// DEBUG
-	std::cout << "Created object: " << m_sName << ", ID: " << m_nID << std::endl;
-#endif
+	SIM_LOG_DEBUG("Created object: " << m_sName << ", ID: " << m_nID);
+}
+
+CSimNode::CSimNode(const CSimNode& other) : ISISO(other), std::enable_shared_from_this<CSimNode>(),
+    m_pIDs(&SUniqueIDGenerator::GetCurrent()), m_pNames(&SUniqueNameController::GetCurrent()), m_nID(0),
+    m_OutputHistory(other.m_OutputHistory), m_InputHistory(other.m_InputHistory), m_Parent(nullptr),
+    m_Type(other.m_Type), m_nKind(other.m_nKind), m_pIndex(nullptr), m_nRandomKey(other.m_nRandomKey),
+    m_pArena(t_pNewArena)
+{
+    // copied histories are taken from the heap, move them next to the node
+    t_pNewArena = nullptr;
+    if (m_pArena)
+    {
+        m_OutputHistory.SetArena(m_pArena);
+        m_InputHistory.SetArena(m_pArena);
+        m_vChildren = ChildVector(CArenaAllocator<std::shared_ptr<ISISO> >(m_pArena));
+    }
+
+    // the original name and ID are kept if they are free in the current registries
+    std::string sName = other.m_sName;
+    SetName(sName);
+    try
+    {
+        SetID(other.m_nID);
+    }
+    catch (std::string& e)
+    {
+        SetID(0);
+    }
+
+    SIM_LOG_DEBUG("Copied object: " << other.m_sName << " to " << m_sName << ", ID: " << m_nID);
+}
+
+void CSimNode::CloneChildren(ISISO* pClone, const std::shared_ptr<CNodeArena>& Arena) const
+{
+    // copies are created in the traversal order, so the subtree stays contiguous in the arena
+    for (auto& child : m_vChildren)
+        pClone->AddChild(std::shared_ptr<ISISO>(child->Clone(Arena)));
 }
 
 void CSimNode::SetID(int nID)
 {
+    int nOldID = m_nID;
+    if (nID != 0 && nID == nOldID)
+        return;
+
+    int nNewID;
     // using generated value
 	if (nID == 0)
-		m_nID = SUniqueIDGenerator::GetInstance().GetNextID();
+		nNewID = m_pIDs->GetNextID();
 	else
 		/// trying to reserve ID
-		m_nID = SUniqueIDGenerator::GetInstance().ReserveID(nID);
+		nNewID = m_pIDs->ReserveID(nID) ? nID : 0;
 
-    // if m_nID equals 0 throw an exception
-	if (m_nID == 0)
+    // if the new ID equals 0 throw an exception, the current ID is kept
+	if (nNewID == 0)
 		throw std::string("Bad ID reservation or generation.");
+
+    // the previous ID can be handed out again
+    m_pIDs->ReleaseID(nOldID);
+    m_nID = nNewID;
+
+    if (m_pIndex)
+        m_pIndex->ChangeID(this, nOldID);
 }
 
 void CSimNode::SetName(std::string& sName)
 {
+    std::string sOldName = m_sName;
+
     // first unregister the current name
-	SUniqueNameController::GetInstance().UnRegisterName(m_sName);
+	m_pNames->UnRegisterName(m_sName);
     // then register new one
-	m_sName = SUniqueNameController::GetInstance().RegisterName(sName);
+	m_sName = m_pNames->RegisterName(sName);
 	sName = m_sName;
+
+    if (m_pIndex)
+        m_pIndex->Rename(this, sOldName);
 }
 
 void CSimNode::GetName(boost::property_tree::ptree& nameTree) const
@@ -56,8 +168,8 @@ void CSimNode::GetName(boost::property_tree::ptree& nameTree) const
     ptree& node = nameTree.add("Object", "");
 
     /// ask children to write their state data
-    auto it = m_lChildren.begin();
-    for (; it != m_lChildren.end(); ++it)
+    auto it = m_vChildren.begin();
+    for (; it != m_vChildren.end(); ++it)
         (*it)->GetName(node);
 
     node.put("<xmlattr>.Name", m_sName);
@@ -67,13 +179,19 @@ void CSimNode::SetParent(ISISO* Parent)
 {
     if (Parent == this || Parent == m_Parent)
         return;
-    ISISO* temp = m_Parent;
-    m_Parent = Parent;
-    Parent->AddChild(std::shared_ptr<ISISO>(this));
 
-    /// inform old parent about the child loss
-    if (temp != nullptr && temp != Parent)
-        temp->RemoveChild(std::shared_ptr<ISISO>(this));
+    // the node shares the ownership with its current owner, a new node is owned by the parent
+    std::shared_ptr<ISISO> self;
+    try
+    {
+        self = shared_from_this();
+    }
+    catch (std::bad_weak_ptr&)
+    {
+        self.reset(this);
+    }
+
+    Attach(Parent, self);
 }
 
 void CSimNode::AddChild(std::shared_ptr<ISISO> Child)
@@ -82,40 +200,90 @@ void CSimNode::AddChild(std::shared_ptr<ISISO> Child)
     if (Child.get() == this)
         return;
 
-    // search whether Child is not in list yet
-    auto it = m_lChildren.begin();
-    for (; it != m_lChildren.end(); ++it)
-    if (*it == Child)
+    // only a child of this node can be in its list already
+    if (Child->GetParent() == this)
+    {
+        auto it = m_vChildren.begin();
+        for (; it != m_vChildren.end(); ++it)
+        if (*it == Child)
+            return;
+    }
+
+    static_cast<CSimNode*>(Child.get())->Attach(this, Child);
+}
+
+void CSimNode::Attach(ISISO* Parent, const std::shared_ptr<ISISO>& Self)
+{
+    ISISO* temp = m_Parent;
+    m_Parent = Parent;
+
+    // a node with another parent is not on the list of this one, so it is appended without
+    // searching the list - attaching stays constant time for parents with many children
+    CSimNode* pParent = static_cast<CSimNode*>(Parent);
+    pParent->m_vChildren.push_back(Self);
+
+    // the node and its subtree join the index of the tree and take its random key
+    SetIndex(pParent->m_pIndex);
+    SetRandomKey(pParent->m_nRandomKey);
+
+    /// inform old parent about the child loss
+    if (temp != nullptr && temp != Parent)
+        temp->RemoveChild(Self);
+}
+
+void CSimNode::RemoveChild(std::shared_ptr<ISISO> Child)
+{
+    if (Child.get() == nullptr)
         return;
 
-    // inform the Child about its new parent
-    m_lChildren.push_back(Child);
-    Child->SetParent(this);
+    m_vChildren.erase(std::remove(m_vChildren.begin(), m_vChildren.end(), Child), m_vChildren.end());
+
+    // a child moved to another parent stays in the index
+    if (Child->GetParent() == this)
+        Child->SetIndex(nullptr);
 }
 
 void CSimNode::GetChildren(std::list<std::weak_ptr<ISISO> >& lChildren) const
 {
-	auto it = m_lChildren.begin();
-	for (; it != m_lChildren.end(); ++it)
+	auto it = m_vChildren.begin();
+	for (; it != m_vChildren.end(); ++it)
 		lChildren.push_back(*it);
 }
 
 bool CSimNode::RemoveObject(int nID)
 {
+    // with the index only the parent of the object is asked
+    if (m_pIndex)
+    {
+        ISISO* obj = FindObject(nID);
+        if (obj == nullptr || obj == this)
+            return false;
+
+        ISISO* parent = obj->GetParent();
+        if (parent != this)
+            return parent != nullptr && parent->RemoveObject(nID);
+    }
+
     // check if the searched object is a children
-	auto it = m_lChildren.begin();
-	for (; it != m_lChildren.end(); ++it)
+	auto it = m_vChildren.begin();
+	for (; it != m_vChildren.end(); ++it)
 	{
 		if ((*it)->GetID() == nID)
 		{
-			(*it).reset();
+            // the child is erased from the list, it is destroyed if not owned elsewhere
+            std::shared_ptr<ISISO> child = *it;
+            m_vChildren.erase(it);
+            child->SetIndex(nullptr);
 			return true;
 		}
 	}
 
+    if (m_pIndex)
+        return false;
+
     // command children to search for the object
-	it = m_lChildren.begin();
-	for (; it != m_lChildren.end(); ++it)
+	it = m_vChildren.begin();
+	for (; it != m_vChildren.end(); ++it)
 	{
 		if ((*it)->RemoveObject(nID))
 			return true;
@@ -124,16 +292,91 @@ bool CSimNode::RemoveObject(int nID)
 	return false;
 }
 
+void CSimNode::SetRandomKey(uint64_t nKey)
+{
+    m_nRandomKey = nKey;
+
+    auto it = m_vChildren.begin();
+    for (; it != m_vChildren.end(); ++it)
+        (*it)->SetRandomKey(nKey);
+}
+
+CNodeIndex* CSimNode::GetIndex()
+{
+    // the root builds the index on first use, it is kept up to date afterwards
+    if (m_pIndex == nullptr && m_Parent == nullptr)
+    {
+        m_Index.reset(new CNodeIndex);
+        SetIndex(m_Index.get());
+    }
+
+    return m_pIndex;
+}
+
+void CSimNode::SetIndex(CNodeIndex* pIndex)
+{
+    if (m_pIndex)
+        m_pIndex->Remove(this);
+
+    m_pIndex = pIndex;
+    if (m_pIndex)
+        m_pIndex->Add(this);
+
+    auto it = m_vChildren.begin();
+    for (; it != m_vChildren.end(); ++it)
+        (*it)->SetIndex(pIndex);
+
+    // a node added to another tree is not a root any more
+    if (m_Index && m_Index.get() != pIndex)
+        m_Index.reset();
+}
+
+bool CSimNode::IsInSubtree(ISISO* pObj)
+{
+    for (; pObj != nullptr; pObj = pObj->GetParent())
+        if (pObj == this)
+            return true;
+
+    return false;
+}
+
+ISISO* CSimNode::FindObject(int nID)
+{
+    if (GetIndex())
+    {
+        ISISO* obj = m_pIndex->FindObject(nID);
+        return (obj && (m_Parent == nullptr || IsInSubtree(obj))) ? obj : nullptr;
+    }
+
+    ISISO* obj = nullptr;
+    if (m_nID == nID)
+        return this;
+
+    // search all the children
+    auto it = m_vChildren.begin();
+    for (; it != m_vChildren.end(); ++it)
+    if ((obj = (*it)->FindObject(nID)))
+        return obj;
+
+    return obj;
+}
+
 ISISO* CSimNode::SearchObject(const std::string& s)
 {
+    if (GetIndex())
+    {
+        ISISO* obj = m_pIndex->FindObject(s);
+        return (obj && (m_Parent == nullptr || IsInSubtree(obj))) ? obj : nullptr;
+    }
+
     ISISO* obj = nullptr;
     if (m_sName == s)
         return this;
 
     // search all the children
-    auto it = m_lChildren.begin();
-    for (; it != m_lChildren.end(); ++it)
-    if (obj = (*it)->SearchObject(s))
+    auto it = m_vChildren.begin();
+    for (; it != m_vChildren.end(); ++it)
+    if ((obj = (*it)->SearchObject(s)))
         return obj;
 
     return obj;
@@ -143,28 +386,36 @@ ISISO* CSimNode::FindFirstRegulator()
 {
     ISISO* obj = nullptr;
 
-    // make the factory check whether its an instance of a regulator
-    if(SObjectFactory::GetInstance().IsARegulator(this))
+    if (m_nKind & kindRegulator)
         return this;
 
     // search all the children
-    auto it = m_lChildren.begin();
-    for (; it != m_lChildren.end(); ++it)
-    if (obj = (*it)->FindFirstRegulator())
+    auto it = m_vChildren.begin();
+    for (; it != m_vChildren.end(); ++it)
+    if ((obj = (*it)->FindFirstRegulator()))
         return obj;
 
     return obj;
 }
 
+void CSimNode::AcceptTree(CNodeVisitor& Visitor)
+{
+    Accept(Visitor);
+
+    auto it = m_vChildren.begin();
+    for (; it != m_vChildren.end(); ++it)
+        (*it)->AcceptTree(Visitor);
+}
+
 bool CSimNode::MoveObjectToFront(ISISO* FrontObject)
 {
-    auto it = m_lChildren.begin();
-    for (; it != m_lChildren.end(); ++it)
+    auto it = m_vChildren.begin();
+    for (; it != m_vChildren.end(); ++it)
     if (it->get() == FrontObject)
     {
         std::shared_ptr<ISISO> temp(*it);
-        m_lChildren.erase(it);
-        m_lChildren.push_front(temp);
+        m_vChildren.erase(it);
+        m_vChildren.insert(m_vChildren.begin(), temp);
         return true;
     }
     return false;
@@ -176,13 +427,46 @@ void CSimNode::ResetMemory()
     m_InputHistory.Clear();
 
     // reseting all the children
-    auto it = m_lChildren.begin();
-    for(; it != m_lChildren.end(); ++it)
+    auto it = m_vChildren.begin();
+    for(; it != m_vChildren.end(); ++it)
     {
         (*it)->ResetMemory();
     }
 }
 
+size_t CSimNode::GetSnapshotSize() const
+{
+    size_t nSize = m_OutputHistory.GetSnapshotSize() + m_InputHistory.GetSnapshotSize();
+    for (auto& child : m_vChildren)
+        nSize += child->GetSnapshotSize();
+
+    return nSize;
+}
+
+unsigned char* CSimNode::SaveSnapshot(unsigned char* p) const
+{
+    p = m_OutputHistory.SaveSnapshot(p);
+    p = m_InputHistory.SaveSnapshot(p);
+
+    // children follow in the simulation order
+    for (auto& child : m_vChildren)
+        p = child->SaveSnapshot(p);
+
+    return p;
+}
+
+const unsigned char* CSimNode::LoadSnapshot(const unsigned char* p)
+{
+    p = m_OutputHistory.LoadSnapshot(p);
+    p = m_InputHistory.LoadSnapshot(p);
+
+    for (auto& child : m_vChildren)
+        p = child->LoadSnapshot(p);
+
+    return p;
+}
+
 CSimNode::~CSimNode()
 {
+    m_pIDs->ReleaseID(m_nID);
 }
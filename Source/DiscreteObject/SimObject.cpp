@@ -1,4 +1,6 @@
 #include "SimObject.h"
+#include "ArrayCodec.h"
+#include "ValueCodec.h"
 
 
 std::ostream& operator<<(std::ostream& out, const std::vector<double>& v)
@@ -12,29 +14,31 @@ std::ostream& operator<<(std::ostream& out, const std::vector<double>& v)
 std::string v2str(const std::vector<double>& v)
 {
 	std::string s;
-	auto it = v.begin();
-	for (; it != v.end(); ++it)
-		s += std::to_string(*it) + " ";
+	CArrayCodec::Format(v, s);
 	return s;
 }
 
 std::vector<double>& str2v(const std::string& s, std::vector<double>& out_v)
 {
     // transforming string into a vector of doubles
-	int nPos = s.find_first_of(' ');
-	int nPosBack = 0;
-	while (nPos <= s.length())
-    {
-		out_v.push_back(std::stod(s.substr(nPosBack, nPos)));
-		nPosBack = nPos + 1;
-        nPos = s.find_first_of(' ', nPosBack);
-	}
+	if (!CArrayCodec::Parse(s.data(), s.data() + s.size(), out_v))
+		throw std::string("Malformed number array: ") + s;
 
 	return out_v;
 }
 
-CSimObject::CSimObject(int nID, ObjType Type, std::string sName) : CSimNode(nID, Type, sName), m_nK(0)
+CSimObject::CSimObject(int nID, ObjType Type, std::string sName) : CSimNode(nID, Type, sName), m_bStationary(false),
+    m_pA(std::make_shared<std::vector<double> >()), m_pB(std::make_shared<std::vector<double> >()), m_nK(0),
+    m_dNoise(0.0), m_nNoiseSeed(0)
+{
+    m_nKind |= kindSimObject;
+}
+
+ISISO* CSimObject::Clone(const std::shared_ptr<CNodeArena>& Arena) const
 {
+    CSimObject* pClone = new (Arena) CSimObject(*this);
+    CloneChildren(pClone, Arena);
+    return pClone;
 }
 
 double CSimObject::Simulate(double dInSample)
@@ -47,38 +51,40 @@ double CSimObject::Simulate(double dInSample)
 
     // If the object has children and there is a "parallel" or "serial" flag set, run the simulation
     // exclusively on children
-	if (m_lChildren.size())
+	if (m_vChildren.size())
 	{
-		auto it = m_lChildren.begin();
+		auto it = m_vChildren.begin();
 		if (m_Type == parallel)
 		{
             // run in parallel - redirect input to each object
             // and sum the outputs
-			for (; it != m_lChildren.end(); ++it)
+			for (; it != m_vChildren.end(); ++it)
 				out_result += (*it)->Simulate(dInSample);
 		}
 		else
 		{
             // else run as serial
-			for (; it != m_lChildren.end(); ++it)
+			for (; it != m_vChildren.end(); ++it)
 				dInSample = (*it)->Simulate(dInSample);
 			out_result = dInSample;
 		}
 	}
 	else
-    // If the object is a leaf of the tree and has m_vA and m_vB run the simulation
-	if (m_vA.size() != 0 && m_vB.size() != 0)
+    // If the object is a leaf of the tree and has vectors A and B run the simulation
+	if (m_pA->size() != 0 && m_pB->size() != 0)
     {
+        const std::vector<double>& vA = *m_pA;
+        const std::vector<double>& vB = *m_pB;
 
         // Storing new input sample
         m_InputHistory.AddSample(dInSample);
 
         //a * y(i)
-        // get the stored output points
-        std::unique_ptr<std::vector<double> > yi = m_OutputHistory.RetriveNSamples(m_vA.size());
-        // multiply A with vector of stored output samples
-        double nMultAYi = std::inner_product(m_vA.begin(), m_vA.end(), yi->begin(), 0.0);
-        //nMultAYi = (*yi)[1]*m_vA[0];
+        // multiply A with stored output samples, read in place from the history
+        double nMultAYi = 0.0;
+        for (size_t i = 0; i < vA.size(); ++i)
+            nMultAYi += vA[i] * m_OutputHistory.GetSample(i);
+        //nMultAYi = (*yi)[1]*vA[0];
 
 
 #ifdef _DEBUG
@@ -88,16 +94,22 @@ double CSimObject::Simulate(double dInSample)
 #endif
 
         //z^-k * b * u(i)
-        // get the stored output points
-        std::unique_ptr<std::vector<double> > ui = m_InputHistory.RetriveNSamples(m_vB.size() + m_nK);
-        // multiply B with vector of stored input samples
-        double nMultBUi = std::inner_product(m_vB.begin(), m_vB.end(), (ui->begin() + m_nK), 0.0);
+        // multiply B with stored input samples delayed by k
+        double nMultBUi = 0.0;
+        for (size_t i = 0; i < vB.size(); ++i)
+            nMultBUi += vB[i] * m_InputHistory.GetSample(i + m_nK);
 
 #ifdef _DEBUG
 		//std::cout << "bu: " << nMultBUi << std::endl;
 #endif
         //Noise
-		double e = 0.0 * ((double) rand() / (double) (0.5*RAND_MAX) - 1); ///from -1 to 1
+		double e = 0.0;
+		if (m_dNoise != 0.0)
+		{
+			// stream of this object, indexed with the number of the sample
+			CCounterRNG rng(m_nRandomKey, (uint64_t(m_nNoiseSeed) << 32) | uint32_t(m_nID));
+			e = m_dNoise * rng.Gaussian(m_InputHistory.GetNumOfSamplesStored());
+		}
 
         //calculate output
         out_result = nMultBUi - nMultAYi + e;
@@ -129,20 +141,28 @@ void CSimObject::SaveState(boost::property_tree::ptree& pt) const
 	node.put("Type", m_Type);
 	node.put("Stationary", m_bStationary);
 	node.put("K", m_nK);
-	node.put("VectorA", v2str(m_vA));
-	node.put("VectorB", v2str(m_vB));
+	CArrayCodec::Put(node, "VectorA", *m_pA);
+	CArrayCodec::Put(node, "VectorB", *m_pB);
+	if (m_dNoise != 0.0)
+	{
+		node.put("Noise", m_dNoise);
+		node.put("NoiseSeed", m_nNoiseSeed);
+	}
 
-    // if doesnt have a parent insert 0
+    // if doesnt have a parent insert 0, the root keeps the seed of the noise too
 	if (m_Parent != nullptr)
 		node.put("Parent.name", m_Parent->GetName());
 	else
+	{
 		node.put("Parent.name", 0);
+		node.put("Seed", m_nRandomKey);
+	}
 
 	node.put("<xmlattr>.Name", m_sName);
 
     // ask children to write their state data
-	auto it = m_lChildren.begin();
-	for (; it != m_lChildren.end(); ++it)
+	auto it = m_vChildren.begin();
+	for (; it != m_vChildren.end(); ++it)
 		(*it)->SaveState(pt);
 
 }
@@ -158,39 +178,65 @@ void CSimObject::LoadState(boost::property_tree::ptree::value_type const& v)
     // Setting object data
 	std::vector<double> vA,
 		vB;
-	SetStationary(v.second.get<bool>("Stationary"));
-	SetK(v.second.get<int>("K"));
-	str2v(v.second.get<std::string>("VectorA"), vA);
-	str2v(v.second.get<std::string>("VectorB"), vB);
+	SetStationary(CValueCodec::Get<bool>(v.second, "Stationary"));
+	SetK(CValueCodec::Get<int>(v.second, "K"));
+	CArrayCodec::Get(v.second, "VectorA", vA);
+	CArrayCodec::Get(v.second, "VectorB", vB);
 	SetVectorA(std::move(vA));
 	SetVectorB(std::move(vB));
+	SetNoise(CValueCodec::Get<double>(v.second, "Noise", 0.0), CValueCodec::Get<unsigned int>(v.second, "NoiseSeed", 0));
+}
+
+bool CSimObject::SetParameter(const std::string& sKey, const std::vector<double>& vValue)
+{
+    // model vectors may have any length
+    if (sKey == "VectorA")
+        SetVectorA(std::vector<double>(vValue));
+    else if (sKey == "VectorB")
+        SetVectorB(std::vector<double>(vValue));
+    else if (vValue.size() != 1)
+        return false;
+    else if (sKey == "Stationary")
+        SetStationary(vValue[0] != 0);
+    else if (sKey == "K" && vValue[0] >= 0)
+    {
+        // input history has to hold the longer delay
+        SetK(static_cast<int>(vValue[0]));
+        unsigned int nMinBKSize = m_pB->size() + m_nK;
+        if (nMinBKSize > m_InputHistory.GetMaxSamples())
+            m_InputHistory.SetMaxSamples(nMinBKSize);
+    }
+    else if (sKey == "Noise")
+        SetNoise(vValue[0], m_nNoiseSeed);
+    else if (sKey == "NoiseSeed" && vValue[0] >= 0)
+        SetNoise(m_dNoise, static_cast<unsigned int>(vValue[0]));
+    else
+        return false;
+
+    return true;
 }
 
 void CSimObject::SetVectorA(std::vector<double>&& vA)
 {
-    m_vA = std::move(vA);
+    m_pA = std::make_shared<std::vector<double> >(std::move(vA));
     // determine the amount of samples that needed to properly calculate output
     // minimal size is size of the vector.
-    int nMinAKSize = m_vA.size();
+    int nMinAKSize = m_pA->size();
     int nMinSampleSize = (nMinAKSize > m_OutputHistory.GetMaxSamples()) ? nMinAKSize : m_OutputHistory.GetMaxSamples();
     m_OutputHistory.SetMaxSamples(nMinSampleSize);
 }
 
 void CSimObject::SetVectorB(std::vector<double>&& vB)
 {
-    m_vB = std::move(vB);
+    m_pB = std::make_shared<std::vector<double> >(std::move(vB));
     // determine the amount of samples that needed to properly calculate output
-    int nMinBKSize = m_vB.size() + m_nK;
+    int nMinBKSize = m_pB->size() + m_nK;
     int nMinSampleSize = (nMinBKSize > m_InputHistory.GetMaxSamples()) ? nMinBKSize : m_InputHistory.GetMaxSamples();
     m_InputHistory.SetMaxSamples(nMinSampleSize);
 }
 
 CSimObject::~CSimObject()
 {
-
-#ifdef _DEBUG
-    // DEBUG
-	std::cout << "Destroyed object: " << m_sName << ", ID: " << m_nID << std::endl;
-#endif
-	SUniqueNameController::GetInstance().UnRegisterName(m_sName);
+	SIM_LOG_DEBUG("Destroyed object: " << m_sName << ", ID: " << m_nID);
+	m_pNames->UnRegisterName(m_sName);
 }
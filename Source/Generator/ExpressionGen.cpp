@@ -0,0 +1,379 @@
+#include "ExpressionGen.h"
+#include "SGeneratorFactory.h"
+#include "ValueCodec.h"
+#include <algorithm>
+#include <limits>
+#include "boost\foreach.hpp"
+
+/// operator names used in the XML
+static const char* OP_NAMES[] = { "sum", "product", "modulate", "sequence" };
+
+const size_t CExpressionGen::BLOCK;
+const int CExpressionGen::STACK_LEVELS;
+
+CExpressionGen::CExpressionGen(std::string sName) : CGenerator(sName, expression), m_Op(opSum),
+    m_dGain(1.0), m_dOffset(0.0), m_dDepth(1.0), m_bRepeat(false), m_nLevels(0), m_nCacheFirst(0)
+{
+    Compile();
+}
+
+CExpressionGen::CExpressionGen(const CExpressionGen& other) : CGenerator(other), m_Op(other.m_Op),
+    m_dGain(other.m_dGain), m_dOffset(other.m_dOffset), m_dDepth(other.m_dDepth), m_bRepeat(other.m_bRepeat),
+    m_nLevels(0), m_nCacheFirst(0)
+{
+    // the compiled tree points to the operands, so it is built again for their copies
+    for (auto& operand : other.m_vOperands)
+    {
+        SOperand copy = { std::shared_ptr<IGenerator>(operand.Gen ? operand.Gen->Clone() : nullptr), operand.nLength };
+        m_vOperands.push_back(copy);
+    }
+    Compile();
+}
+
+double CExpressionGen::GenerateNext()
+{
+    ++m_nI;
+
+    // samples come from the cached block, a new block is calculated when the number leaves it
+    if (!m_nCacheFirst || m_nI < m_nCacheFirst || m_nI >= m_nCacheFirst + (long long)BLOCK)
+    {
+        EvaluateBlocks(m_vCache.data(), BLOCK, m_nI, m_vScratch.data());
+        m_nCacheFirst = m_nI;
+    }
+
+    return m_vCache[m_nI - m_nCacheFirst];
+}
+
+void CExpressionGen::Fill(double* out, size_t n, size_t offset) const
+{
+    // scratch buffers of this call only, so calls on one generator from several threads do not share them
+    double aScratch[STACK_LEVELS * BLOCK];
+    std::vector<double> vScratch;
+    double* pScratch = aScratch;
+    if (m_nLevels > STACK_LEVELS)
+    {
+        vScratch.resize(m_nLevels * BLOCK);
+        pScratch = vScratch.data();
+    }
+
+    EvaluateBlocks(out, n, m_nI + (long long)offset + 1, pScratch);
+}
+
+void CExpressionGen::Reset()
+{
+    m_nI = 0;
+}
+
+void CExpressionGen::SetOp(EOp op)
+{
+    m_Op = op;
+    Compile();
+}
+
+void CExpressionGen::SetScale(double dGain, double dOffset)
+{
+    m_dGain = dGain;
+    m_dOffset = dOffset;
+    Compile();
+}
+
+void CExpressionGen::SetDepth(double dDepth)
+{
+    m_dDepth = dDepth;
+    Compile();
+}
+
+void CExpressionGen::SetRepeat(bool bRepeat)
+{
+    m_bRepeat = bRepeat;
+    Compile();
+}
+
+void CExpressionGen::AddOperand(std::shared_ptr<IGenerator> Gen, long long nLength)
+{
+    SOperand operand = { Gen, nLength };
+    m_vOperands.push_back(operand);
+    KeyOperand(m_vOperands.size() - 1);
+    Compile();
+}
+
+void CExpressionGen::SetStreamKey(uint32_t nKey)
+{
+    CGenerator::SetStreamKey(nKey);
+    for (size_t i = 0; i < m_vOperands.size(); ++i)
+        KeyOperand(i);
+}
+
+void CExpressionGen::SetRandomKey(uint64_t nKey)
+{
+    CGenerator::SetRandomKey(nKey);
+    for (size_t i = 0; i < m_vOperands.size(); ++i)
+        KeyOperand(i);
+}
+
+void CExpressionGen::KeyOperand(size_t nOperand)
+{
+    IGenerator* pGen = m_vOperands[nOperand].Gen.get();
+    if (!pGen)
+        return;
+
+    pGen->SetRandomKey(m_nRandomKey);
+    if (!m_nStreamKey || pGen->GetStreamKey())
+        return;
+
+    // keys of the operands are scattered over the keys of the regulators
+    pGen->SetStreamKey(((m_nStreamKey * 0x9E3779B1u) + uint32_t(nOperand) + 1) & 0x7FFFFFFFu);
+}
+
+bool CExpressionGen::SetParameter(const std::string& sKey, const std::vector<double>& vValue)
+{
+    if (vValue.size() == 1 && sKey == "Gain")
+        SetScale(vValue[0], m_dOffset);
+    else if (vValue.size() == 1 && sKey == "Offset")
+        SetScale(m_dGain, vValue[0]);
+    else if (vValue.size() == 1 && sKey == "Depth")
+        SetDepth(vValue[0]);
+    else if (vValue.size() == 1 && sKey == "Repeat")
+        SetRepeat(vValue[0] != 0);
+    else
+        return CGenerator::SetParameter(sKey, vValue);
+    return true;
+}
+
+void CExpressionGen::SetDelay(int nD)
+{
+    CGenerator::SetDelay(nD);
+    Compile();
+}
+
+void CExpressionGen::Compile()
+{
+    m_vNodes.clear();
+    m_vChildren.clear();
+    m_vLengths.clear();
+    m_nLevels = 0;
+    CompileNode(*this, 0);
+
+    m_vScratch.assign(m_nLevels * BLOCK, 0.0);
+    m_vCache.assign(BLOCK, 0.0);
+    m_nCacheFirst = 0;
+}
+
+int CExpressionGen::CompileNode(const CExpressionGen& expr, int nLevel)
+{
+    int nNode = (int)m_vNodes.size();
+    SNode node;
+    node.pLeaf = nullptr;
+    node.op = expr.m_Op;
+    node.nLevel = nLevel;
+    node.dGain = expr.m_dGain;
+    node.dOffset = expr.m_dOffset;
+    node.dDepth = expr.m_dDepth;
+    node.nDelay = expr.m_nDelay;
+    node.nPeriod = 0;
+    m_vNodes.push_back(node);
+    m_nLevels = std::max(m_nLevels, nLevel + 1);
+
+    // children of a node have to be stored one after another, so they are collected first
+    std::vector<int> vChildren;
+    std::vector<long long> vLengths;
+    for (auto& operand : expr.m_vOperands)
+    {
+        if (!operand.Gen)
+            continue;
+
+        const CExpressionGen* pExpr = dynamic_cast<const CExpressionGen*>(operand.Gen.get());
+        if (pExpr)
+        {
+            // nested expressions are inlined
+            vChildren.push_back(CompileNode(*pExpr, nLevel + 1));
+        }
+        else
+        {
+            SNode leaf = node;
+            leaf.pLeaf = operand.Gen.get();
+            leaf.nLevel = nLevel + 1;
+            vChildren.push_back((int)m_vNodes.size());
+            m_vNodes.push_back(leaf);
+        }
+        vLengths.push_back(std::max(operand.nLength, 0LL));
+    }
+
+    m_vNodes[nNode].nFirstChild = (int)m_vChildren.size();
+    m_vNodes[nNode].nChildren = (int)vChildren.size();
+    m_vChildren.insert(m_vChildren.end(), vChildren.begin(), vChildren.end());
+    m_vLengths.insert(m_vLengths.end(), vLengths.begin(), vLengths.end());
+
+    if (expr.m_Op == opSequence && expr.m_bRepeat)
+    {
+        for (auto nLength : vLengths)
+            m_vNodes[nNode].nPeriod += nLength;
+    }
+
+    return nNode;
+}
+
+void CExpressionGen::EvaluateBlocks(double* out, size_t n, long long nFirst, double* pScratch) const
+{
+    for (size_t nBegin = 0; nBegin < n; nBegin += BLOCK)
+        Evaluate(0, out + nBegin, std::min(BLOCK, n - nBegin), nFirst + (long long)nBegin, pScratch);
+}
+
+void CExpressionGen::Evaluate(int nNode, double* out, size_t n, long long nFirst, double* pScratch) const
+{
+    const SNode& node = m_vNodes[nNode];
+
+    // leaf generators are never advanced, so sample nFirst is at offset nFirst - 1
+    if (node.pLeaf)
+    {
+        node.pLeaf->Fill(out, n, (size_t)(nFirst - 1));
+        return;
+    }
+
+    // samples up to the end of the delay are 0
+    size_t nZeros = (size_t)std::min<long long>(std::max<long long>(node.nDelay - nFirst + 1, 0), n);
+    std::fill(out, out + nZeros, 0.0);
+    out += nZeros;
+    n -= nZeros;
+    nFirst += nZeros;
+    if (!n)
+        return;
+
+    const int* pChildren = m_vChildren.data() + node.nFirstChild;
+    const long long* pLengths = m_vLengths.data() + node.nFirstChild;
+    double* pBuffer = pScratch + node.nLevel * BLOCK;
+
+    if (!node.nChildren)
+        std::fill(out, out + n, 0.0);
+    else if (node.op == opSequence)
+    {
+        size_t nPos = 0;
+        while (nPos < n)
+        {
+            long long nI = nFirst + (long long)nPos;
+            if (node.nPeriod)
+                nI = (nI - 1) % node.nPeriod + 1;
+
+            // find the operand of the sample, the last one has no end without repetition
+            long long nStart = 0;
+            int nChild = 0;
+            for (; nChild < node.nChildren - 1; ++nChild)
+            {
+                if (nI <= nStart + pLengths[nChild])
+                    break;
+                nStart += pLengths[nChild];
+            }
+
+            long long nEnd = (nChild == node.nChildren - 1 && !node.nPeriod) ?
+                std::numeric_limits<long long>::max() : nStart + pLengths[nChild];
+            size_t nCount = (size_t)std::min<long long>(nEnd - nI + 1, (long long)(n - nPos));
+            Evaluate(pChildren[nChild], out + nPos, nCount, nI - nStart, pScratch);
+            nPos += nCount;
+        }
+    }
+    else
+    {
+        Evaluate(pChildren[0], out, n, nFirst, pScratch);
+        for (int i = 1; i < node.nChildren; ++i)
+        {
+            Evaluate(pChildren[i], pBuffer, n, nFirst, pScratch);
+            switch (node.op)
+            {
+            case opProduct:
+                for (size_t j = 0; j < n; ++j)
+                    out[j] *= pBuffer[j];
+                break;
+            case opModulate:
+                // only the second operand modulates the first one
+                if (i == 1)
+                {
+                    for (size_t j = 0; j < n; ++j)
+                        out[j] *= 1.0 + node.dDepth*pBuffer[j];
+                }
+                break;
+            default:
+                for (size_t j = 0; j < n; ++j)
+                    out[j] += pBuffer[j];
+                break;
+            }
+        }
+    }
+
+    for (size_t j = 0; j < n; ++j)
+        out[j] = node.dGain*out[j] + node.dOffset;
+}
+
+void CExpressionGen::LoadState(boost::property_tree::ptree::value_type const& vParams)
+{
+    m_nDelay = CValueCodec::Get<int>(vParams.second, "Delay");
+    m_dGain = CValueCodec::Get<double>(vParams.second, "Gain", 1.0);
+    m_dOffset = CValueCodec::Get<double>(vParams.second, "Offset", 0.0);
+    m_dDepth = CValueCodec::Get<double>(vParams.second, "Depth", 1.0);
+    m_bRepeat = CValueCodec::Get<bool>(vParams.second, "Repeat", false);
+
+    std::string sOp = vParams.second.get<std::string>("Op", OP_NAMES[opSum]);
+    auto itOp = std::find(std::begin(OP_NAMES), std::end(OP_NAMES), sOp);
+    if (itOp == std::end(OP_NAMES))
+    {
+        SIM_LOG_ERROR("ExpressionGen " << m_sName << " unknown operator " << sOp << ", sum used");
+        m_Op = opSum;
+    }
+    else
+        m_Op = static_cast<EOp>(itOp - std::begin(OP_NAMES));
+
+    // operands are created from their own generator nodes
+    m_vOperands.clear();
+    auto operands = vParams.second.get_child_optional("Operands");
+    if (operands)
+    {
+        BOOST_FOREACH(boost::property_tree::ptree::value_type const& vals, *operands)
+        {
+            if (vals.first != "Generator")
+                continue;
+
+            GenType type = static_cast<GenType>(CValueCodec::Get<int>(vals.second, "Type"));
+            std::shared_ptr<IGenerator> gen(SGeneratorFactory::GetInstance().CreateGenerator(type));
+            if (!gen)
+            {
+                SIM_LOG_ERROR("ExpressionGen " << m_sName << " unknown operand type " << type);
+                continue;
+            }
+
+            gen->LoadState(vals);
+            SOperand operand = { gen, CValueCodec::Get<long long>(vals.second, "Length", 0) };
+            m_vOperands.push_back(operand);
+            KeyOperand(m_vOperands.size() - 1);
+        }
+    }
+
+    m_nI = 0;
+    Compile();
+    SIM_LOG_DEBUG("ExpressionGen " << m_sName << " Delay: " << m_nDelay << " Op: " << OP_NAMES[m_Op]
+                  << " Operands: " << m_vOperands.size() << " Nodes: " << m_vNodes.size());
+}
+
+void CExpressionGen::SaveState(boost::property_tree::ptree& pt) const
+{
+    // saving all the properties to the tree
+    boost::property_tree::ptree& node = pt.add("Generator", "");
+    node.put("Type", m_Type);
+    node.put("Delay", m_nDelay);
+    node.put("Op", OP_NAMES[m_Op]);
+    node.put("Gain", m_dGain);
+    node.put("Offset", m_dOffset);
+    node.put("Depth", m_dDepth);
+    node.put("Repeat", m_bRepeat);
+
+    boost::property_tree::ptree& operands = node.add("Operands", "");
+    for (auto& operand : m_vOperands)
+    {
+        if (!operand.Gen)
+            continue;
+
+        operand.Gen->SaveState(operands);
+        if (operand.nLength)
+            operands.back().second.put("Length", operand.nLength);
+    }
+
+    node.put("<xmlattr>.Name", m_sName);
+}
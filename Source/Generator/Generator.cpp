@@ -1,10 +1,21 @@
 #include "Generator.h"
 
-CGenerator::CGenerator(std::string& sName, GenType type) : m_Type(type), m_nI(0), m_nDelay(0)
+CGenerator::CGenerator(std::string& sName, GenType type) : m_Type(type),
+    m_pNames(&SUniqueNameController::GetCurrent()), m_nI(0), m_nIBack(0), m_nDelay(0),
+    m_nStreamKey(0), m_nRandomKey(0)
 {
     SetName(sName);
 }
 
+CGenerator::CGenerator(const CGenerator& other) : m_Type(other.m_Type),
+    m_pNames(&SUniqueNameController::GetCurrent()), m_nI(other.m_nI), m_nIBack(other.m_nIBack),
+    m_nDelay(other.m_nDelay), m_nStreamKey(other.m_nStreamKey),
+    m_nRandomKey(other.m_nRandomKey)
+{
+    std::string sName = other.m_sName;
+    SetName(sName);
+}
+
 GenType CGenerator::GetType() const
 {
     return m_Type;
@@ -18,17 +29,41 @@ const std::string& CGenerator::GetName() const
 void CGenerator::SetName(std::string& sName)
 {
     // first unregister current name
-    SUniqueNameController::GetInstance().UnRegisterName(m_sName);
+    m_pNames->UnRegisterName(m_sName);
     // then register new one
-    m_sName = SUniqueNameController::GetInstance().RegisterName(sName);
+    m_sName = m_pNames->RegisterName(sName);
     sName = m_sName;
 }
 
+void CGenerator::SetStreamKey(uint32_t nKey)
+{
+    m_nStreamKey = nKey;
+}
+
+uint32_t CGenerator::GetStreamKey() const
+{
+    return m_nStreamKey;
+}
+
+void CGenerator::SetRandomKey(uint64_t nKey)
+{
+    m_nRandomKey = nKey;
+}
+
 void CGenerator::SetDelay(int nD)
 {
     m_nDelay = nD;
 }
 
+bool CGenerator::SetParameter(const std::string& sKey, const std::vector<double>& vValue)
+{
+    if (sKey != "Delay" || vValue.size() != 1)
+        return false;
+
+    SetDelay(static_cast<int>(vValue[0]));
+    return true;
+}
+
 void CGenerator::SaveHistory()
 {
     m_nIBack = m_nI;
@@ -41,3 +76,18 @@ void CGenerator::LoadHistory()
 
     m_nI = m_nIBack;
 }
+
+size_t CGenerator::GetSnapshotSize() const
+{
+    return sizeof(m_nI);
+}
+
+unsigned char* CGenerator::SaveSnapshot(unsigned char* p) const
+{
+    return PutSnapshot(p, m_nI);
+}
+
+const unsigned char* CGenerator::LoadSnapshot(const unsigned char* p)
+{
+    return GetSnapshot(p, m_nI);
+}
@@ -0,0 +1,33 @@
+#include "WaveKernels.h"
+#include <algorithm>
+
+constexpr double CWaveKernels::SIN_MAX_ERROR;
+
+void CWaveKernels::Sine(double* out, size_t n, long long nFirst, double dFullAngle, double dT, double dA)
+{
+    for (size_t i = 0; i < n; ++i)
+        out[i] = dA * Sin(dFullAngle * (double)(nFirst + (long long)i) / dT);
+}
+
+void CWaveKernels::Square(double* out, size_t n, size_t nFirstRun, size_t nRun, double dFirst)
+{
+    // runs shorter than one sample would never end
+    nRun = std::max<size_t>(nRun, 1);
+
+    size_t nLength = std::min(nFirstRun, n);
+    std::fill(out, out + nLength, dFirst);
+
+    double dValue = -dFirst;
+    for (size_t i = nLength; i < n; i += nRun)
+    {
+        std::fill(out + i, out + std::min(i + nRun, n), dValue);
+        dValue = -dValue;
+    }
+}
+
+void CWaveKernels::Slope(double* out, size_t n, long long nJ, double dT, double dA, int nSign)
+{
+    double dOffset = dA*(nSign - 1.0)*(-0.5);
+    for (size_t i = 0; i < n; ++i)
+        out[i] = nSign * dA * ((double)(nJ + (long long)i) / dT) + dOffset;
+}
@@ -1,7 +1,11 @@
 #include "ARXIdentification.h"
+#include "StateArena.h"
 #include <stdio.h>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <string>
 #include <vector>
 #include <Eigen/Dense>
 
@@ -394,3 +398,113 @@ void CARXIdentification::UpdateThetaHistory()
 
     }
 }
+
+/// \brief Returns number of bytes of a matrix in the snapshot, its dimensions first.
+static size_t MatrixSnapshotSize(const Eigen::MatrixXd& m)
+{
+    return 2*sizeof(int64_t) + m.size()*sizeof(double);
+}
+
+/// \brief Copies dimensions and coefficients of a matrix to the snapshot buffer.
+static unsigned char* SaveMatrix(unsigned char* p, const Eigen::MatrixXd& m)
+{
+    p = PutSnapshot<int64_t>(p, m.rows());
+    p = PutSnapshot<int64_t>(p, m.cols());
+    std::memcpy(p, m.data(), m.size()*sizeof(double));
+    return p + m.size()*sizeof(double);
+}
+
+/// \brief Reads a matrix saved by SaveMatrix(), resizing it to the stored dimensions.
+static const unsigned char* LoadMatrix(const unsigned char* p, const unsigned char* pEnd, Eigen::MatrixXd& m)
+{
+    int64_t nRows, nCols;
+    if (pEnd - p < static_cast<ptrdiff_t>(2*sizeof(int64_t)))
+        throw std::string("Identification snapshot is truncated.");
+    p = GetSnapshot(GetSnapshot(p, nRows), nCols);
+    if (nRows < 0 || nCols < 0 || (nCols && nRows > (pEnd - p)/static_cast<ptrdiff_t>(sizeof(double))/nCols))
+        throw std::string("Identification snapshot is truncated.");
+
+    m.resize(nRows, nCols);
+    std::memcpy(m.data(), p, m.size()*sizeof(double));
+    return p + m.size()*sizeof(double);
+}
+
+/// \brief Copies length and samples of a history to the snapshot buffer.
+static unsigned char* SaveVector(unsigned char* p, const std::vector<double>& v)
+{
+    p = PutSnapshot<int64_t>(p, v.size());
+    std::memcpy(p, v.data(), v.size()*sizeof(double));
+    return p + v.size()*sizeof(double);
+}
+
+/// \brief Reads a history saved by SaveVector().
+static const unsigned char* LoadVector(const unsigned char* p, const unsigned char* pEnd, std::vector<double>& v)
+{
+    int64_t nSize;
+    if (pEnd - p < static_cast<ptrdiff_t>(sizeof(int64_t)))
+        throw std::string("Identification snapshot is truncated.");
+    p = GetSnapshot(p, nSize);
+    if (nSize < 0 || nSize > (pEnd - p)/static_cast<ptrdiff_t>(sizeof(double)))
+        throw std::string("Identification snapshot is truncated.");
+
+    v.resize(nSize);
+    std::memcpy(v.data(), p, v.size()*sizeof(double));
+    return p + v.size()*sizeof(double);
+}
+
+size_t CARXIdentification::GetSnapshotSize() const
+{
+    return 4*sizeof(int) + 6*sizeof(double) +
+           2*sizeof(int64_t) + (m_vOutputHistory.size() + m_vInputHistory.size())*sizeof(double) +
+           MatrixSnapshotSize(m_vTheta) + MatrixSnapshotSize(m_mThetaHistory) +
+           MatrixSnapshotSize(m_vFi) + MatrixSnapshotSize(m_mP);
+}
+
+unsigned char* CARXIdentification::SaveSnapshot(unsigned char* p) const
+{
+    p = PutSnapshot(p, m_iPolynomial_i_degree);
+    p = PutSnapshot(p, m_iPolynomial_o_degree);
+    p = PutSnapshot(p, m_iDelayTime);
+    p = PutSnapshot(p, m_iHistoryLength);
+
+    p = PutSnapshot(p, m_dSigma);
+    p = PutSnapshot(p, m_dForgettingFactor);
+    p = PutSnapshot(p, m_dBeta);
+    p = PutSnapshot(p, m_dBetaNE);
+    p = PutSnapshot(p, m_dAlpha);
+    p = PutSnapshot(p, m_dT);
+
+    p = SaveVector(p, m_vOutputHistory);
+    p = SaveVector(p, m_vInputHistory);
+
+    p = SaveMatrix(p, m_vTheta);
+    p = SaveMatrix(p, m_mThetaHistory);
+    p = SaveMatrix(p, m_vFi);
+    return SaveMatrix(p, m_mP);
+}
+
+const unsigned char* CARXIdentification::LoadSnapshot(const unsigned char* p, const unsigned char* pEnd)
+{
+    if (pEnd - p < static_cast<ptrdiff_t>(4*sizeof(int) + 6*sizeof(double)))
+        throw std::string("Identification snapshot is truncated.");
+
+    p = GetSnapshot(p, m_iPolynomial_i_degree);
+    p = GetSnapshot(p, m_iPolynomial_o_degree);
+    p = GetSnapshot(p, m_iDelayTime);
+    p = GetSnapshot(p, m_iHistoryLength);
+
+    p = GetSnapshot(p, m_dSigma);
+    p = GetSnapshot(p, m_dForgettingFactor);
+    p = GetSnapshot(p, m_dBeta);
+    p = GetSnapshot(p, m_dBetaNE);
+    p = GetSnapshot(p, m_dAlpha);
+    p = GetSnapshot(p, m_dT);
+
+    p = LoadVector(p, pEnd, m_vOutputHistory);
+    p = LoadVector(p, pEnd, m_vInputHistory);
+
+    p = LoadMatrix(p, pEnd, m_vTheta);
+    p = LoadMatrix(p, pEnd, m_mThetaHistory);
+    p = LoadMatrix(p, pEnd, m_vFi);
+    return LoadMatrix(p, pEnd, m_mP);
+}
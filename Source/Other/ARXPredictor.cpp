@@ -0,0 +1,68 @@
+#include "ARXPredictor.h"
+
+void CARXPredictor::FreeResponse(const std::vector<double>& vA, const std::vector<double>& vB, int nK,
+                                 const CHistorian& InputHistory, const CHistorian& OutputHistory,
+                                 int nH, double* pOut)
+{
+    // the last input is repeated over the whole horizon
+    double dLastInput = InputHistory.GetSample(0);
+    Predict(vA, vB, nK, InputHistory, OutputHistory, &dLastInput, 0, nK, nH, pOut);
+}
+
+void CARXPredictor::ForcedResponse(const std::vector<double>& vA, const std::vector<double>& vB, int nK,
+                                   const CHistorian& InputHistory, const CHistorian& OutputHistory,
+                                   const double* pInput, int nH, double* pOut)
+{
+    Predict(vA, vB, nK, InputHistory, OutputHistory, pInput, 1, 0, nH, pOut);
+}
+
+void CARXPredictor::Predict(const std::vector<double>& vA, const std::vector<double>& vB, int nK,
+                            const CHistorian& InputHistory, const CHistorian& OutputHistory,
+                            const double* pInput, int nStride, int nSkip, int nOut, double* pOut)
+{
+    int nSteps = nSkip + nOut;
+    m_vPred.resize(nSteps);
+
+    // histories only remember as many samples as their limit allows
+    int nInputLimit = InputHistory.GetMaxSamples();
+    int nOutputLimit = OutputHistory.GetMaxSamples();
+    int nA = vA.size();
+    int nB = vB.size();
+
+    for (int n = 0; n < nSteps; ++n)
+    {
+        // z^-k * b * u(i) - predicted inputs come first, then the stored ones
+        double dBU = 0.0;
+        for (int j = 0; j < nB; ++j)
+        {
+            int nAge = nK + j;
+            double u;
+            if (nAge >= nInputLimit)
+                u = 0.0;
+            else if (nAge <= n)
+                u = pInput[(n - nAge)*nStride];
+            else
+                u = InputHistory.GetSample(nAge - n - 1);
+            dBU += vB[j]*u;
+        }
+
+        // a * y(i) - predicted outputs come first, then the stored ones
+        double dAY = 0.0;
+        for (int i = 0; i < nA; ++i)
+        {
+            double y;
+            if (i >= nOutputLimit)
+                y = 0.0;
+            else if (i < n)
+                y = m_vPred[n - 1 - i];
+            else
+                y = OutputHistory.GetSample(i - n);
+            dAY += vA[i]*y;
+        }
+
+        m_vPred[n] = dBU - dAY;
+    }
+
+    for (int i = 0; i < nOut; ++i)
+        pOut[i] = m_vPred[nSkip + i];
+}
@@ -0,0 +1,217 @@
+#include "ActiveSetQP.h"
+#include <algorithm>
+#include <cmath>
+
+/// Feasibility and optimality tolerance.
+static const double TOL = 1e-9;
+
+/// Is the constraint value dAx above the bound dB?
+static bool IsViolated(double dAx, double dB)
+{
+    return dAx - dB > TOL*(1.0 + std::fabs(dB));
+}
+
+CActiveSetQP::CActiveSetQP() : m_nLastIterations(0), m_nLastRelaxed(0), m_nMaxIterations(100)
+{
+}
+
+void CActiveSetQP::SetHessian(const Eigen::MatrixXd& mH)
+{
+    m_mH = mH;
+    m_HLLT.compute(m_mH);
+}
+
+int CActiveSetQP::CountViolated(const Eigen::MatrixXd& mA, const Eigen::VectorXd& vB, const Eigen::VectorXd& vX,
+                                int nHard, int& nHardViolated)
+{
+    m_vAx.noalias() = mA*vX;
+    int nViolated = 0;
+    nHardViolated = 0;
+    for (int i = 0; i < mA.rows(); ++i)
+    {
+        if (IsViolated(m_vAx(i), vB(i)))
+        {
+            ++nViolated;
+            if (i < nHard)
+                ++nHardViolated;
+        }
+    }
+    return nViolated;
+}
+
+bool CActiveSetQP::SolveSubproblem(const Eigen::VectorXd& vG, const Eigen::MatrixXd& mA)
+{
+    int nW = m_vWorking.size();
+    m_vHiG = m_HLLT.solve(vG);
+
+    // no active constraints - Newton step
+    if (nW == 0)
+    {
+        m_vP = -m_vHiG;
+        m_vLambda.resize(0);
+        return true;
+    }
+
+    // range-space method: (AW H^-1 AW') lambda = -AW H^-1 g, p = -H^-1 (g + AW' lambda)
+    m_mAW.resize(nW, mA.cols());
+    for (int i = 0; i < nW; ++i)
+        m_mAW.row(i) = mA.row(m_vWorking[i]);
+
+    m_mHiAW = m_HLLT.solve(m_mAW.transpose());
+    m_mS.noalias() = m_mAW*m_mHiAW;
+    m_SLDLT.compute(m_mS);
+
+    Eigen::VectorXd vD = m_SLDLT.vectorD().cwiseAbs();
+    if (m_SLDLT.info() != Eigen::Success || vD.minCoeff() <= TOL*std::max(1.0, vD.maxCoeff()))
+        return false;
+
+    m_vLambda = m_SLDLT.solve(-(m_mAW*m_vHiG));
+    m_vP = -m_vHiG;
+    m_vP.noalias() -= m_mHiAW*m_vLambda;
+    return true;
+}
+
+bool CActiveSetQP::Solve(const Eigen::VectorXd& vF, const Eigen::MatrixXd& mA, const Eigen::VectorXd& vB,
+                         Eigen::VectorXd& vX, std::vector<int>& vWorking, int nHard)
+{
+    int n = vF.size();
+    int m = mA.rows();
+    m_nLastIterations = 0;
+    m_nLastRelaxed = 0;
+
+    // unconstrained optimum is the solution whenever it is feasible
+    int nHardViolated;
+    m_vX = -m_HLLT.solve(vF);
+    if (CountViolated(mA, vB, m_vX, nHard, nHardViolated) == 0)
+    {
+        vX = m_vX;
+        vWorking.clear();
+        return true;
+    }
+
+    // start from the given point unless the zero vector violates fewer hard constraints,
+    // or as many of them and fewer constraints in total
+    if (vX.size() != n)
+        vX.setZero(n);
+    int nViolated = CountViolated(mA, vB, vX, nHard, nHardViolated);
+    if (nViolated > 0)
+    {
+        int nZeroHardViolated;
+        m_vG.setZero(n);
+        int nZeroViolated = CountViolated(mA, vB, m_vG, nHard, nZeroHardViolated);
+        if (nZeroHardViolated < nHardViolated || (nZeroHardViolated == nHardViolated && nZeroViolated < nViolated))
+            vX.setZero();
+    }
+    m_vX = vX;
+
+    // constraints violated at the start point are relaxed, the caller keeps the hard ones satisfied there
+    m_vAx.noalias() = mA*m_vX;
+    m_vRelaxed.assign(m, 0);
+    for (int i = 0; i < m; ++i)
+    {
+        if (IsViolated(m_vAx(i), vB(i)))
+        {
+            m_vRelaxed[i] = 1;
+            ++m_nLastRelaxed;
+        }
+    }
+
+    // keep the expected constraints which are active at the start point and independent
+    m_vWorking.clear();
+    m_vInWorking.assign(m, 0);
+    for (size_t k = 0; k < vWorking.size(); ++k)
+    {
+        int i = vWorking[k];
+        if (i < 0 || i >= m || m_vRelaxed[i] || m_vInWorking[i] ||
+            std::fabs(m_vAx(i) - vB(i)) > TOL*(1.0 + std::fabs(vB(i))))
+            continue;
+
+        m_vWorking.push_back(i);
+        if (!SolveSubproblem(vF, mA))
+        {
+            m_vWorking.pop_back();
+            continue;
+        }
+        m_vInWorking[i] = 1;
+    }
+    m_vDependent.assign(m, 0);
+
+    bool bConverged = false;
+    while (m_nLastIterations < m_nMaxIterations)
+    {
+        ++m_nLastIterations;
+
+        m_vG = vF;
+        m_vG.noalias() += m_mH*m_vX;
+        if (!SolveSubproblem(m_vG, mA))
+        {
+            // only the blocking constraint added last can make the working set dependent,
+            // it stays active along steps in the span of the others, so it is left out;
+            // the current point is feasible, it is returned if even that does not help
+            if (m_vWorking.empty())
+                break;
+            m_vInWorking[m_vWorking.back()] = 0;
+            m_vDependent[m_vWorking.back()] = 1;
+            m_vWorking.pop_back();
+            if (!SolveSubproblem(m_vG, mA))
+                break;
+        }
+
+        if (m_vP.lpNorm<Eigen::Infinity>() <= TOL*(1.0 + m_vX.lpNorm<Eigen::Infinity>()))
+        {
+            // optimal on the working set - check the multipliers
+            int nMin = -1;
+            double dMin = -TOL;
+            for (int k = 0; k < m_vLambda.size(); ++k)
+            {
+                if (m_vLambda(k) < dMin)
+                {
+                    dMin = m_vLambda(k);
+                    nMin = k;
+                }
+            }
+
+            if (nMin < 0)
+            {
+                bConverged = true;
+                break;
+            }
+
+            // drop the constraint with the most negative multiplier, the constraints left out
+            // as dependent can block steps off the old span again
+            m_vInWorking[m_vWorking[nMin]] = 0;
+            m_vWorking.erase(m_vWorking.begin() + nMin);
+            m_vDependent.assign(m, 0);
+            continue;
+        }
+
+        // longest step keeping all the constraints satisfied
+        double dAlpha = 1.0;
+        int nBlocking = -1;
+        m_vAx.noalias() = mA*m_vP;
+        for (int i = 0; i < m; ++i)
+        {
+            if (m_vInWorking[i] || m_vRelaxed[i] || m_vDependent[i] || m_vAx(i) <= TOL)
+                continue;
+
+            double dStep = (vB(i) - mA.row(i).dot(m_vX))/m_vAx(i);
+            if (dStep < dAlpha)
+            {
+                dAlpha = std::max(dStep, 0.0);
+                nBlocking = i;
+            }
+        }
+
+        m_vX.noalias() += dAlpha*m_vP;
+
+        if (nBlocking >= 0)
+        {
+            m_vWorking.push_back(nBlocking);
+            m_vInWorking[nBlocking] = 1;
+        }
+    }
+
+    vX = m_vX;
+    vWorking = m_vWorking;
+    return bConverged;
+}
@@ -0,0 +1,232 @@
+#include "ArrayCodec.h"
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+/// Longest shortest representation of a double, eg. -2.2250738585072014e-308.
+static const size_t MAX_DOUBLE_CHARS = 24;
+
+/// Characters of base64 by their values.
+static const char BASE64_CHARS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::atomic<size_t> CArrayCodec::m_nBinaryThreshold(4096);
+
+/// \brief Checks if the character is an XML white space.
+static bool IsSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/// \brief Checks if doubles are stored little-endian on this machine.
+static bool IsLittleEndian()
+{
+    const uint16_t nOne = 1;
+    unsigned char c;
+    std::memcpy(&c, &nOne, 1);
+    return c == 1;
+}
+
+/// \brief Reverses bytes of every double of the array.
+static void SwapBytes(unsigned char* p, size_t nDoubles)
+{
+    for (size_t i = 0; i < nDoubles; ++i, p += sizeof(double))
+        for (size_t j = 0; j < sizeof(double)/2; ++j)
+            std::swap(p[j], p[sizeof(double) - 1 - j]);
+}
+
+/// \brief Returns values of base64 characters by the character, -1 for other characters.
+static const signed char* Base64Values()
+{
+    struct STable
+    {
+        signed char vValues[256];
+        STable()
+        {
+            std::memset(vValues, -1, sizeof(vValues));
+            for (int i = 0; i < 64; ++i)
+                vValues[static_cast<unsigned char>(BASE64_CHARS[i])] = static_cast<signed char>(i);
+        }
+    };
+    static const STable table;
+    return table.vValues;
+}
+
+void CArrayCodec::Format(const std::vector<double>& v, std::string& s)
+{
+    // written in place, the string is shrunk to the written length
+    s.resize(v.size()*(MAX_DOUBLE_CHARS + 1));
+    char* pOut = &s[0];
+    char* pEnd = pOut + s.size();
+    for (size_t i = 0; i < v.size(); ++i)
+    {
+        if (i)
+            *pOut++ = ' ';
+        pOut = std::to_chars(pOut, pEnd, v[i]).ptr;
+    }
+    s.resize(pOut - s.data());
+}
+
+bool CArrayCodec::Parse(const char* pFirst, const char* pLast, std::vector<double>& v)
+{
+    // numbers are counted first, so the array is allocated once
+    size_t nCount = 0;
+    bool bInNumber = false;
+    for (const char* p = pFirst; p != pLast; ++p)
+    {
+        bool bSpace = IsSpace(*p);
+        if (!bSpace && !bInNumber)
+            ++nCount;
+        bInNumber = !bSpace;
+    }
+
+    v.resize(nCount);
+    const char* p = pFirst;
+    for (size_t i = 0; i < nCount; ++i)
+    {
+        while (IsSpace(*p))
+            ++p;
+
+        // the sign is optional in the file, from_chars takes only the minus
+        if (*p == '+' && p + 1 != pLast && p[1] != '-')
+            ++p;
+
+        std::from_chars_result result = std::from_chars(p, pLast, v[i]);
+        if (result.ec != std::errc() || (result.ptr != pLast && !IsSpace(*result.ptr)))
+        {
+            v.clear();
+            return false;
+        }
+        p = result.ptr;
+    }
+
+    return true;
+}
+
+void CArrayCodec::EncodeBase64(const std::vector<double>& v, std::string& s)
+{
+    const unsigned char* pIn = reinterpret_cast<const unsigned char*>(v.data());
+    std::vector<unsigned char> vSwapped;
+    if (!IsLittleEndian())
+    {
+        vSwapped.assign(pIn, pIn + v.size()*sizeof(double));
+        SwapBytes(vSwapped.data(), v.size());
+        pIn = vSwapped.data();
+    }
+
+    size_t nBytes = v.size()*sizeof(double);
+    s.resize((nBytes + 2)/3*4);
+    char* pOut = &s[0];
+    size_t i = 0;
+    for (; i + 3 <= nBytes; i += 3)
+    {
+        unsigned long nTriple = (pIn[i] << 16) | (pIn[i + 1] << 8) | pIn[i + 2];
+        *pOut++ = BASE64_CHARS[(nTriple >> 18) & 0x3F];
+        *pOut++ = BASE64_CHARS[(nTriple >> 12) & 0x3F];
+        *pOut++ = BASE64_CHARS[(nTriple >> 6) & 0x3F];
+        *pOut++ = BASE64_CHARS[nTriple & 0x3F];
+    }
+
+    // the last one or two bytes are padded
+    if (i < nBytes)
+    {
+        unsigned long nTriple = pIn[i] << 16;
+        if (i + 1 < nBytes)
+            nTriple |= pIn[i + 1] << 8;
+        *pOut++ = BASE64_CHARS[(nTriple >> 18) & 0x3F];
+        *pOut++ = BASE64_CHARS[(nTriple >> 12) & 0x3F];
+        *pOut++ = (i + 1 < nBytes) ? BASE64_CHARS[(nTriple >> 6) & 0x3F] : '=';
+        *pOut++ = '=';
+    }
+}
+
+bool CArrayCodec::DecodeBase64(const char* pFirst, const char* pLast, std::vector<double>& v)
+{
+    v.clear();
+    const signed char* pValues = Base64Values();
+
+    // the length is known before decoding, so the array is allocated once
+    size_t nChars = 0;
+    size_t nPadding = 0;
+    for (const char* p = pFirst; p != pLast; ++p)
+    {
+        if (IsSpace(*p))
+            continue;
+        if (*p == '=')
+            ++nPadding;
+        else if (nPadding || pValues[static_cast<unsigned char>(*p)] < 0)
+            return false;
+        ++nChars;
+    }
+    if (nChars % 4 != 0 || nPadding > 2)
+        return false;
+
+    size_t nBytes = nChars/4*3 - nPadding;
+    if (nBytes % sizeof(double) != 0)
+        return false;
+    v.resize(nBytes/sizeof(double));
+
+    unsigned char* pOut = reinterpret_cast<unsigned char*>(v.data());
+    unsigned long nQuad = 0;
+    int nQuadChars = 0;
+    size_t nWritten = 0;
+    for (const char* p = pFirst; p != pLast && *p != '='; ++p)
+    {
+        if (IsSpace(*p))
+            continue;
+        nQuad = (nQuad << 6) | pValues[static_cast<unsigned char>(*p)];
+        if (++nQuadChars == 4)
+        {
+            pOut[nWritten++] = static_cast<unsigned char>(nQuad >> 16);
+            pOut[nWritten++] = static_cast<unsigned char>(nQuad >> 8);
+            pOut[nWritten++] = static_cast<unsigned char>(nQuad);
+            nQuad = 0;
+            nQuadChars = 0;
+        }
+    }
+
+    // the last group holds one or two bytes
+    if (nQuadChars == 3)
+    {
+        pOut[nWritten++] = static_cast<unsigned char>(nQuad >> 10);
+        pOut[nWritten++] = static_cast<unsigned char>(nQuad >> 2);
+    }
+    else if (nQuadChars == 2)
+        pOut[nWritten++] = static_cast<unsigned char>(nQuad >> 4);
+
+    if (!IsLittleEndian())
+        SwapBytes(pOut, v.size());
+    return true;
+}
+
+void CArrayCodec::Put(boost::property_tree::ptree& node, const std::string& sKey, const std::vector<double>& v)
+{
+    // encoded straight into the node
+    boost::property_tree::ptree& child = node.put(sKey, std::string());
+    size_t nThreshold = GetBinaryThreshold();
+    if (nThreshold != 0 && v.size() >= nThreshold)
+    {
+        EncodeBase64(v, child.data());
+        child.put("<xmlattr>.Encoding", "base64");
+    }
+    else
+        Format(v, child.data());
+}
+
+void CArrayCodec::Get(const boost::property_tree::ptree& node, const std::string& sKey, std::vector<double>& v)
+{
+    const boost::property_tree::ptree& child = node.get_child(sKey);
+    const std::string& s = child.data();
+    std::string sEncoding = child.get<std::string>("<xmlattr>.Encoding", "text");
+
+    bool bParsed;
+    if (sEncoding == "text")
+        bParsed = Parse(s.data(), s.data() + s.size(), v);
+    else if (sEncoding == "base64")
+        bParsed = DecodeBase64(s.data(), s.data() + s.size(), v);
+    else
+        throw std::string("Unknown encoding ") + sEncoding + std::string(" of ") + sKey + std::string(".");
+
+    if (!bParsed)
+        throw std::string("Malformed number array ") + sKey + std::string(".");
+}
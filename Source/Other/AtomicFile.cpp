@@ -0,0 +1,16 @@
+#include "AtomicFile.h"
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+
+bool CAtomicFile::Replace(const std::string& sTempName, const std::string& sFileName)
+{
+    // the target is replaced in one step, on Windows by MoveFileEx with MOVEFILE_REPLACE_EXISTING
+    std::error_code error;
+    std::filesystem::rename(sTempName, sFileName, error);
+    if (!error)
+        return true;
+
+    std::remove(sTempName.c_str());
+    return false;
+}
@@ -0,0 +1,318 @@
+#include "ChainIndex.h"
+#include "AtomicFile.h"
+#include "XmlReader.h"
+#include "ValueCodec.h"
+#include "SLogger.h"
+#include "boost\foreach.hpp"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+/// Tag at the beginning of the cache.
+static const char INDEX_TAG[4] = { 'S', 'I', 'M', 'X' };
+/// Version of the cache format.
+static const uint32_t INDEX_VERSION = 1;
+/// Written as is, reads differently on a machine of the other byte order.
+static const uint32_t INDEX_BYTE_ORDER = 0x01020304;
+/// Parents stored in the cache for ROOT and NONE.
+static const uint64_t INDEX_ROOT = static_cast<uint64_t>(-1);
+static const uint64_t INDEX_NONE = static_cast<uint64_t>(-2);
+
+/// Fixed part at the beginning of the cache.
+struct SIndexHeader
+{
+    char sTag[4];
+    uint32_t nVersion;
+    uint32_t nByteOrder;
+    uint32_t nReserved;
+    uint64_t nFileSize;
+    uint64_t nFileTime;
+    uint64_t nEntries;
+    uint64_t nNamesSize;
+};
+
+/// Object in the cache.
+struct SIndexRecord
+{
+    uint64_t nOffset;
+    uint64_t nLength;
+    uint64_t nParent;
+    uint32_t nLine;
+    int32_t nType;
+    uint32_t nGenerators;
+    uint32_t nReserved;
+};
+
+/// \brief Appends a name with its length to the names of the cache.
+static void PutName(std::string& sNames, const std::string& sName)
+{
+    uint32_t nLength = static_cast<uint32_t>(sName.size());
+    sNames.append(reinterpret_cast<const char*>(&nLength), sizeof(nLength));
+    sNames += sName;
+}
+
+/// \brief Takes a name from the names of the cache.
+/// \return False if the names end before the name.
+static bool GetName(const char*& p, const char* pEnd, std::string& sName)
+{
+    uint32_t nLength;
+    if (static_cast<size_t>(pEnd - p) < sizeof(nLength))
+        return false;
+    std::memcpy(&nLength, p, sizeof(nLength));
+    p += sizeof(nLength);
+    if (static_cast<size_t>(pEnd - p) < nLength)
+        return false;
+    sName.assign(p, nLength);
+    p += nLength;
+    return true;
+}
+
+CChainIndex::CChainIndex() : m_nFileSize(0), m_nFileTime(0)
+{
+}
+
+void CChainIndex::Open(const std::string& sFileName)
+{
+    m_sFileName = sFileName;
+    m_vEntries.clear();
+
+    std::string sCacheName = sFileName + ".idx";
+    if (Load(sCacheName))
+    {
+        SIM_LOG_DEBUG("Index of " << sFileName << " read from " << sCacheName);
+        Link();
+        return;
+    }
+
+    Build();
+    Link();
+    if (!Save(sCacheName))
+        SIM_LOG_WARNING("Index of " << sFileName << " cannot be cached in " << sCacheName);
+}
+
+bool CChainIndex::IsCurrent() const
+{
+    uint64_t nSize, nTime;
+    return Stat(nSize, nTime) && nSize == m_nFileSize && nTime == m_nFileTime;
+}
+
+size_t CChainIndex::Find(const std::string& sName) const
+{
+    std::unordered_map<std::string, size_t>::const_iterator it = m_Names.find(sName);
+    if (it != m_Names.end())
+        return it->second;
+
+    it = m_Generators.find(sName);
+    return it != m_Generators.end() ? it->second : NONE;
+}
+
+bool CChainIndex::ReadElement(std::istream& is, size_t nEntry, std::string& sElement) const
+{
+    const SEntry& entry = m_vEntries[nEntry];
+    is.clear();
+    is.seekg(entry.nOffset);
+    sElement.resize(entry.nLength);
+    is.read(&sElement[0], entry.nLength);
+    return static_cast<uint64_t>(is.gcount()) == entry.nLength;
+}
+
+void CChainIndex::Build()
+{
+    using boost::property_tree::ptree;
+
+    // offsets are counted in bytes of the file as it is
+    std::ifstream fs(m_sFileName, std::ios::binary);
+    if (!fs || !Stat(m_nFileSize, m_nFileTime))
+        throw "Cannot open chain file " + m_sFileName;
+
+    std::unordered_map<std::string, size_t> names;
+    CXmlReader reader(fs);
+    for (CXmlReader::EEvent ev = reader.Next(); ev != CXmlReader::evEndOfDocument; ev = reader.Next())
+    {
+        if (ev != CXmlReader::evStart)
+            continue;
+
+        if (reader.GetDepth() == 1)
+        {
+            if (reader.GetName() != "Object")
+                throw "Line " + std::to_string(reader.GetLine()) + ": Object list expected, found " + reader.GetName();
+            continue;
+        }
+
+        SEntry entry;
+        entry.nOffset = reader.GetTagOffset();
+        entry.nLine = reader.GetLine();
+        bool bObject = reader.GetName() == "Name";
+        ptree element;
+        reader.ReadTree(element);
+        if (!bObject)
+            continue;
+        entry.nLength = reader.GetOffset() - entry.nOffset;
+
+        entry.sName = element.get<std::string>("<xmlattr>.Name", "no_name");
+        entry.nType = CValueCodec::Get<int>(element, "Type", 0);
+        BOOST_FOREACH(const ptree::value_type& child, element)
+            if (child.first == "Generator")
+                entry.vGenerators.push_back(child.second.get<std::string>("<xmlattr>.Name", ""));
+
+        // parents are looked up among the objects written before, like by the loader
+        std::string sParentName = element.get<std::string>("Parent", "");
+        if (sParentName.empty())
+            sParentName = element.get<std::string>("Parent.name", "");
+        if (sParentName.empty() || sParentName == "0")
+            entry.nParent = ROOT;
+        else
+        {
+            std::unordered_map<std::string, size_t>::const_iterator parent = names.find(sParentName);
+            entry.nParent = parent != names.end() ? parent->second : NONE;
+        }
+
+        names.insert(std::make_pair(entry.sName, m_vEntries.size()));
+        m_vEntries.push_back(entry);
+    }
+}
+
+bool CChainIndex::Load(const std::string& sCacheName)
+{
+    std::ifstream fs(sCacheName, std::ios::binary);
+    if (!fs)
+        return false;
+    std::vector<char> vFile((std::istreambuf_iterator<char>(fs)), std::istreambuf_iterator<char>());
+    const char* p = vFile.data();
+    const char* pEnd = p + vFile.size();
+
+    // the cache is valid only for the same chain file
+    SIndexHeader header;
+    uint64_t nSize, nTime;
+    if (vFile.size() < sizeof(header) || !Stat(nSize, nTime))
+        return false;
+    std::memcpy(&header, p, sizeof(header));
+    p += sizeof(header);
+    if (std::memcmp(header.sTag, INDEX_TAG, sizeof(INDEX_TAG)) != 0 || header.nVersion != INDEX_VERSION ||
+        header.nByteOrder != INDEX_BYTE_ORDER || header.nFileSize != nSize || header.nFileTime != nTime)
+        return false;
+    if (header.nEntries > static_cast<uint64_t>(pEnd - p)/sizeof(SIndexRecord) ||
+        header.nNamesSize != static_cast<uint64_t>(pEnd - p) - header.nEntries*sizeof(SIndexRecord))
+        return false;
+
+    const char* pNames = p + header.nEntries*sizeof(SIndexRecord);
+    std::vector<SEntry> vEntries(header.nEntries);
+    for (size_t i = 0; i < vEntries.size(); ++i, p += sizeof(SIndexRecord))
+    {
+        SIndexRecord record;
+        std::memcpy(&record, p, sizeof(record));
+        SEntry& entry = vEntries[i];
+        entry.nOffset = record.nOffset;
+        entry.nLength = record.nLength;
+        entry.nLine = record.nLine;
+        entry.nType = record.nType;
+        if (record.nOffset > nSize || record.nLength > nSize - record.nOffset)
+            return false;
+
+        // parents are written before their children
+        if (record.nParent == INDEX_ROOT)
+            entry.nParent = ROOT;
+        else if (record.nParent == INDEX_NONE)
+            entry.nParent = NONE;
+        else if (record.nParent < i)
+            entry.nParent = static_cast<size_t>(record.nParent);
+        else
+            return false;
+
+        if (!GetName(pNames, pEnd, entry.sName) || record.nGenerators > static_cast<uint64_t>(pEnd - pNames))
+            return false;
+        entry.vGenerators.resize(record.nGenerators);
+        for (size_t j = 0; j < entry.vGenerators.size(); ++j)
+            if (!GetName(pNames, pEnd, entry.vGenerators[j]))
+                return false;
+    }
+
+    m_nFileSize = nSize;
+    m_nFileTime = nTime;
+    m_vEntries.swap(vEntries);
+    return true;
+}
+
+bool CChainIndex::Save(const std::string& sCacheName) const
+{
+    std::vector<SIndexRecord> vRecords(m_vEntries.size());
+    std::string sNames;
+    for (size_t i = 0; i < m_vEntries.size(); ++i)
+    {
+        const SEntry& entry = m_vEntries[i];
+        SIndexRecord& record = vRecords[i];
+        std::memset(&record, 0, sizeof(record));
+        record.nOffset = entry.nOffset;
+        record.nLength = entry.nLength;
+        record.nParent = entry.nParent == ROOT ? INDEX_ROOT : entry.nParent == NONE ? INDEX_NONE : entry.nParent;
+        record.nLine = entry.nLine;
+        record.nType = entry.nType;
+        record.nGenerators = static_cast<uint32_t>(entry.vGenerators.size());
+
+        PutName(sNames, entry.sName);
+        for (size_t j = 0; j < entry.vGenerators.size(); ++j)
+            PutName(sNames, entry.vGenerators[j]);
+    }
+
+    SIndexHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.sTag, INDEX_TAG, sizeof(INDEX_TAG));
+    header.nVersion = INDEX_VERSION;
+    header.nByteOrder = INDEX_BYTE_ORDER;
+    header.nFileSize = m_nFileSize;
+    header.nFileTime = m_nFileTime;
+    header.nEntries = vRecords.size();
+    header.nNamesSize = sNames.size();
+
+    // a reader never sees a partial cache
+    std::string sTempName = sCacheName + ".tmp";
+    {
+        std::ofstream fs(sTempName, std::ios::binary | std::ios::trunc);
+        if (!fs)
+            return false;
+
+        fs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        fs.write(reinterpret_cast<const char*>(vRecords.data()), vRecords.size()*sizeof(SIndexRecord));
+        fs.write(sNames.data(), sNames.size());
+        fs.flush();
+        if (!fs)
+        {
+            fs.close();
+            std::remove(sTempName.c_str());
+            return false;
+        }
+    }
+
+    return CAtomicFile::Replace(sTempName, sCacheName);
+}
+
+void CChainIndex::Link()
+{
+    m_vChildren.assign(m_vEntries.size(), std::vector<size_t>());
+    m_Names.clear();
+    m_Generators.clear();
+    for (size_t i = 0; i < m_vEntries.size(); ++i)
+    {
+        const SEntry& entry = m_vEntries[i];
+        if (entry.nParent != ROOT && entry.nParent != NONE)
+            m_vChildren[entry.nParent].push_back(i);
+
+        // the first object of a name is found, like by the loader
+        m_Names.insert(std::make_pair(entry.sName, i));
+        for (size_t j = 0; j < entry.vGenerators.size(); ++j)
+            m_Generators.insert(std::make_pair(entry.vGenerators[j], i));
+    }
+}
+
+bool CChainIndex::Stat(uint64_t& nSize, uint64_t& nTime) const
+{
+    std::error_code error;
+    std::filesystem::path path(m_sFileName);
+    nSize = std::filesystem::file_size(path, error);
+    if (error)
+        return false;
+    nTime = static_cast<uint64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+    return !error;
+}
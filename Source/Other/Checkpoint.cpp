@@ -0,0 +1,287 @@
+#include "Checkpoint.h"
+#include "AtomicFile.h"
+#include "boost\property_tree\xml_parser.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+/// Tag at the beginning of the file.
+static const char CHECKPOINT_TAG[4] = { 'S', 'I', 'M', 'C' };
+/// Version of the file format.
+static const uint32_t CHECKPOINT_VERSION = 2;
+/// Written as is, reads differently on a machine of the other byte order.
+static const uint32_t CHECKPOINT_BYTE_ORDER = 0x01020304;
+/// Flag of a session with identification.
+static const uint32_t CHECKPOINT_PREPARED = 1;
+/// Sections are aligned to this number of bytes.
+static const size_t CHECKPOINT_ALIGN = 8;
+
+/// Fixed part at the beginning of the file.
+struct SCheckpointHeader
+{
+    char sTag[4];
+    uint32_t nVersion;
+    uint32_t nByteOrder;
+    uint32_t nFlags;
+    double dLastSimVal;
+    double dRegInVal;
+    double dRegOutVal;
+    double dObjInVal;
+    double dObjOutVal;
+    uint64_t nChainSize;
+    uint64_t nStateSize;
+    uint64_t nIdentificationSize;
+    uint64_t nNomSize;
+    uint64_t nDenomSize;
+    uint64_t nHash;
+};
+
+/// \brief Returns size of a section with its padding.
+static uint64_t Aligned(uint64_t nSize)
+{
+    return (nSize + CHECKPOINT_ALIGN - 1)/CHECKPOINT_ALIGN*CHECKPOINT_ALIGN;
+}
+
+const uint64_t CCheckpoint::HASH_BASIS;
+
+/// \brief Writes a section followed by its padding.
+static void WriteSection(std::ostream& os, const void* pData, uint64_t nSize)
+{
+    static const char PADDING[CHECKPOINT_ALIGN] = {};
+    os.write(static_cast<const char*>(pData), nSize);
+    os.write(PADDING, Aligned(nSize) - nSize);
+}
+
+CCheckpoint::CCheckpoint()
+{
+    m_State.Loop.bPrepared = false;
+    m_State.Loop.dLastSimVal = m_State.Loop.dRegInVal = m_State.Loop.dRegOutVal = 0.0;
+    m_State.Loop.dObjInVal = m_State.Loop.dObjOutVal = 0.0;
+    PointToOwned();
+}
+
+void CCheckpoint::SwapState(SState& State)
+{
+    // the chain of a mapped file is kept, the file is not needed any more
+    if (m_Region.get_address() != nullptr)
+    {
+        GetState(m_State);
+        m_sChain = GetChain();
+        boost::interprocess::mapped_region().swap(m_Region);
+        boost::interprocess::file_mapping().swap(m_File);
+    }
+
+    std::swap(m_State.Loop, State.Loop);
+    m_State.vState.swap(State.vState);
+    m_State.vIdentification.swap(State.vIdentification);
+    m_State.vNom.swap(State.vNom);
+    m_State.vDenom.swap(State.vDenom);
+    PointToOwned();
+}
+
+void CCheckpoint::GetState(SState& State) const
+{
+    State.Loop = m_State.Loop;
+    State.vState.assign(m_pState, m_pState + m_nStateSize);
+    State.vIdentification.assign(m_pIdentification, m_pIdentification + m_nIdentificationSize);
+    State.vNom.assign(m_pNom, m_pNom + m_nNomSize);
+    State.vDenom.assign(m_pDenom, m_pDenom + m_nDenomSize);
+}
+
+void CCheckpoint::SetChain(const boost::property_tree::ptree& Chain)
+{
+    std::ostringstream os;
+    boost::property_tree::write_xml(os, Chain);
+    m_sChain = os.str();
+    m_pChain = reinterpret_cast<const unsigned char*>(m_sChain.data());
+    m_nChainSize = m_sChain.size();
+}
+
+void CCheckpoint::PointToOwned()
+{
+    m_pChain = reinterpret_cast<const unsigned char*>(m_sChain.data());
+    m_nChainSize = m_sChain.size();
+    m_pState = m_State.vState.data();
+    m_nStateSize = m_State.vState.size();
+    m_pIdentification = m_State.vIdentification.data();
+    m_nIdentificationSize = m_State.vIdentification.size();
+    m_pNom = m_State.vNom.data();
+    m_nNomSize = m_State.vNom.size();
+    m_pDenom = m_State.vDenom.data();
+    m_nDenomSize = m_State.vDenom.size();
+}
+
+bool CCheckpoint::Save(const std::string& sFileName) const
+{
+    SCheckpointHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.sTag, CHECKPOINT_TAG, sizeof(CHECKPOINT_TAG));
+    header.nVersion = CHECKPOINT_VERSION;
+    header.nByteOrder = CHECKPOINT_BYTE_ORDER;
+    header.nFlags = m_State.Loop.bPrepared ? CHECKPOINT_PREPARED : 0;
+    header.dLastSimVal = m_State.Loop.dLastSimVal;
+    header.dRegInVal = m_State.Loop.dRegInVal;
+    header.dRegOutVal = m_State.Loop.dRegOutVal;
+    header.dObjInVal = m_State.Loop.dObjInVal;
+    header.dObjOutVal = m_State.Loop.dObjOutVal;
+    header.nChainSize = m_nChainSize;
+    header.nStateSize = m_nStateSize;
+    header.nIdentificationSize = m_nIdentificationSize;
+    header.nNomSize = m_nNomSize;
+    header.nDenomSize = m_nDenomSize;
+
+    // the sections are hashed without their padding
+    uint64_t nHash = Hash(m_pChain, m_nChainSize);
+    nHash = Hash(m_pState, m_nStateSize, nHash);
+    nHash = Hash(m_pIdentification, m_nIdentificationSize, nHash);
+    nHash = Hash(m_pNom, m_nNomSize*sizeof(double), nHash);
+    header.nHash = Hash(m_pDenom, m_nDenomSize*sizeof(double), nHash);
+
+    // the previous checkpoint is replaced only by a complete file
+    std::string sTempName = sFileName + ".tmp";
+    {
+        std::ofstream fs(sTempName, std::ios::binary | std::ios::trunc);
+        if (!fs)
+            return false;
+
+        fs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        WriteSection(fs, m_pChain, m_nChainSize);
+        WriteSection(fs, m_pState, m_nStateSize);
+        WriteSection(fs, m_pIdentification, m_nIdentificationSize);
+        WriteSection(fs, m_pNom, m_nNomSize*sizeof(double));
+        WriteSection(fs, m_pDenom, m_nDenomSize*sizeof(double));
+        fs.flush();
+        if (!fs)
+        {
+            fs.close();
+            std::remove(sTempName.c_str());
+            return false;
+        }
+    }
+
+    return CAtomicFile::Replace(sTempName, sFileName);
+}
+
+std::future<bool> CCheckpoint::SaveAsync(std::shared_ptr<CCheckpoint> Checkpoint, const std::string& sFileName,
+                                         std::shared_ptr<const boost::property_tree::ptree> Chain)
+{
+    std::shared_ptr<std::promise<bool> > result = std::make_shared<std::promise<bool> >();
+    std::future<bool> future = result->get_future();
+
+    // detached, so dropping the future does not wait for the file
+    std::thread([Checkpoint, sFileName, Chain, result]()
+    {
+        try
+        {
+            if (Chain)
+                Checkpoint->SetChain(*Chain);
+            result->set_value(Checkpoint->Save(sFileName));
+        }
+        catch (...)
+        {
+            result->set_exception(std::current_exception());
+        }
+    }).detach();
+
+    return future;
+}
+
+bool CCheckpoint::Open(const std::string& sFileName)
+{
+    using namespace boost::interprocess;
+
+    file_mapping file;
+    mapped_region region;
+    try
+    {
+        file_mapping(sFileName.c_str(), read_only).swap(file);
+        mapped_region(file, read_only).swap(region);
+    }
+    catch (interprocess_exception&)
+    {
+        return false;
+    }
+
+    // the header and all the sections have to be in the file
+    const unsigned char* pBegin = static_cast<const unsigned char*>(region.get_address());
+    uint64_t nSize = region.get_size();
+    SCheckpointHeader header;
+    if (nSize < sizeof(header))
+        return false;
+    std::memcpy(&header, pBegin, sizeof(header));
+    if (std::memcmp(header.sTag, CHECKPOINT_TAG, sizeof(CHECKPOINT_TAG)) != 0 ||
+        header.nVersion != CHECKPOINT_VERSION || header.nByteOrder != CHECKPOINT_BYTE_ORDER)
+        return false;
+    if (header.nNomSize > nSize/sizeof(double) || header.nDenomSize > nSize/sizeof(double))
+        return false;
+
+    const uint64_t vSizes[] = { header.nChainSize, header.nStateSize, header.nIdentificationSize,
+                                header.nNomSize*sizeof(double), header.nDenomSize*sizeof(double) };
+    const unsigned char* vSections[5];
+    uint64_t nOffset = sizeof(header);
+    for (int i = 0; i < 5; ++i)
+    {
+        if (vSizes[i] > nSize || Aligned(vSizes[i]) > nSize - nOffset)
+            return false;
+        vSections[i] = pBegin + nOffset;
+        nOffset += Aligned(vSizes[i]);
+    }
+
+    // a damaged file is refused, so an older restore point can be used instead
+    uint64_t nHash = HASH_BASIS;
+    for (int i = 0; i < 5; ++i)
+        nHash = Hash(vSections[i], vSizes[i], nHash);
+    if (nHash != header.nHash)
+        return false;
+
+    // the checkpoint is replaced only by a valid file
+    m_sChain.clear();
+    m_State.vState.clear();
+    m_State.vIdentification.clear();
+    m_State.vNom.clear();
+    m_State.vDenom.clear();
+    m_File.swap(file);
+    m_Region.swap(region);
+
+    m_State.Loop.bPrepared = (header.nFlags & CHECKPOINT_PREPARED) != 0;
+    m_State.Loop.dLastSimVal = header.dLastSimVal;
+    m_State.Loop.dRegInVal = header.dRegInVal;
+    m_State.Loop.dRegOutVal = header.dRegOutVal;
+    m_State.Loop.dObjInVal = header.dObjInVal;
+    m_State.Loop.dObjOutVal = header.dObjOutVal;
+
+    m_pChain = vSections[0];
+    m_nChainSize = header.nChainSize;
+    m_pState = vSections[1];
+    m_nStateSize = header.nStateSize;
+    m_pIdentification = vSections[2];
+    m_nIdentificationSize = header.nIdentificationSize;
+    m_pNom = reinterpret_cast<const double*>(vSections[3]);
+    m_nNomSize = header.nNomSize;
+    m_pDenom = reinterpret_cast<const double*>(vSections[4]);
+    m_nDenomSize = header.nDenomSize;
+    return true;
+}
+
+void CCheckpoint::GetModel(std::vector<double>& vNom, std::vector<double>& vDenom) const
+{
+    vNom.assign(m_pNom, m_pNom + m_nNomSize);
+    vDenom.assign(m_pDenom, m_pDenom + m_nDenomSize);
+}
+
+uint64_t CCheckpoint::Hash(const void* pData, size_t nSize, uint64_t nHash)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(pData);
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= nSize; i += sizeof(uint64_t))
+    {
+        uint64_t nWord;
+        std::memcpy(&nWord, p + i, sizeof(nWord));
+        nHash = (nHash ^ nWord)*1099511628211ULL;
+    }
+    for (; i < nSize; ++i)
+        nHash = (nHash ^ p[i])*1099511628211ULL;
+    return nHash;
+}
@@ -0,0 +1,52 @@
+#include "CounterRNG.h"
+#include <algorithm>
+#include <cmath>
+
+CCounterRNG::CCounterRNG(uint64_t nKey, uint64_t nStream) : m_nStream(nStream)
+{
+    m_nKey[0] = uint32_t(nKey);
+    m_nKey[1] = uint32_t(nKey >> 32);
+}
+
+double CCounterRNG::Gaussian(uint64_t nIndex) const
+{
+    uint32_t w[4];
+    Generate(nIndex, w);
+
+    // Box-Muller, 1 - u keeps the logarithm argument in (0,1]
+    double u1 = 1.0 - ToUnit(w[0], w[1]);
+    double u2 = ToUnit(w[2], w[3]);
+    return std::sqrt(-2.0*std::log(u1))*std::cos(6.28318530717958647692*u2);
+}
+
+void CCounterRNG::FillUniform(double* out, size_t n, uint64_t nFirst) const
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint32_t w[4];
+        Generate(nFirst + i, w);
+        out[i] = ToUnit(w[0], w[1]);
+    }
+}
+
+void CCounterRNG::FillGaussian(double* out, size_t n, uint64_t nFirst) const
+{
+    // random words of a block first, then the transform as a separate loop
+    const size_t BLOCK = 64;
+    double u1[BLOCK], u2[BLOCK];
+
+    for (size_t nBegin = 0; nBegin < n; nBegin += BLOCK)
+    {
+        size_t nSize = std::min(BLOCK, n - nBegin);
+        for (size_t i = 0; i < nSize; ++i)
+        {
+            uint32_t w[4];
+            Generate(nFirst + nBegin + i, w);
+            u1[i] = 1.0 - ToUnit(w[0], w[1]);
+            u2[i] = ToUnit(w[2], w[3]);
+        }
+
+        for (size_t i = 0; i < nSize; ++i)
+            out[nBegin + i] = std::sqrt(-2.0*std::log(u1[i]))*std::cos(6.28318530717958647692*u2[i]);
+    }
+}
@@ -0,0 +1,69 @@
+#include "GPCGainSolver.h"
+
+/// Fixed-size variant of CGPCGainSolver::Solve(). Rows are fixed, columns are
+/// bounded by MAX_FIXED, so nothing is allocated on the heap.
+template<int H>
+static void SolveFixed(const double* pStep, int nL, double dRO, double* pQ)
+{
+    typedef Eigen::Matrix<double, H, Eigen::Dynamic, (H == 1 ? Eigen::RowMajor : Eigen::ColMajor), H, CGPCGainSolver::MAX_FIXED> MatrixG;
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, CGPCGainSolver::MAX_FIXED, CGPCGainSolver::MAX_FIXED> MatrixM;
+    typedef Eigen::Matrix<double, Eigen::Dynamic, 1, 0, CGPCGainSolver::MAX_FIXED, 1> VectorX;
+
+    // G(r,c) = s(r-c+1) below the diagonal, 0 above
+    MatrixG G = MatrixG::Zero(H, nL);
+    for (int c = 0; c < nL; ++c)
+        for (int r = c; r < H; ++r)
+            G(r, c) = pStep[r - c];
+
+    MatrixM M = G.transpose()*G;
+    M.diagonal().array() += dRO;
+
+    VectorX x = M.ldlt().solve(VectorX::Unit(nL, 0));
+    Eigen::Map<Eigen::Matrix<double, H, 1> > q(pQ);
+    q.noalias() = G*x;
+}
+
+typedef void (*FixedSolver)(const double*, int, double, double*);
+
+/// Returns SolveFixed<H> instance for every H <= MAX_FIXED.
+static FixedSolver GetFixedSolver(int nH)
+{
+    static const FixedSolver solvers[CGPCGainSolver::MAX_FIXED] =
+    {
+        &SolveFixed<1>, &SolveFixed<2>, &SolveFixed<3>, &SolveFixed<4>,
+        &SolveFixed<5>, &SolveFixed<6>, &SolveFixed<7>, &SolveFixed<8>
+    };
+    return solvers[nH - 1];
+}
+
+void CGPCGainSolver::Solve(const double* pStep, int nH, int nL, double dRO, Eigen::VectorXd& vQ)
+{
+    vQ.setZero(nH > 0 ? nH : 0);
+    if (nH < 1 || nL < 1)
+        return;
+
+    // small horizons - everything on the stack
+    if (nH <= MAX_FIXED && nL <= MAX_FIXED)
+    {
+        GetFixedSolver(nH)(pStep, nL, dRO, vQ.data());
+        return;
+    }
+
+    // resizing is a no-op while the horizons stay the same
+    m_mG.setZero(nH, nL);
+    for (int c = 0; c < nL; ++c)
+        for (int r = c; r < nH; ++r)
+            m_mG(r, c) = pStep[r - c];
+
+    m_mM.resize(nL, nL);
+    m_mM.noalias() = m_mG.transpose()*m_mG;
+    m_mM.diagonal().array() += dRO;
+
+    // only the first row of M^-1 G' is needed: q = G M^-1 e1
+    m_LDLT.compute(m_mM);
+    m_vE.setZero(nL);
+    m_vE(0) = 1.0;
+    m_vX.resize(nL);
+    m_vX = m_LDLT.solve(m_vE);
+    vQ.noalias() = m_mG*m_vX;
+}
@@ -0,0 +1,360 @@
+#include "GainTable.h"
+#include "GPCGainSolver.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <thread>
+
+/// Tag at the beginning of the file.
+static const char TABLE_TAG[4] = { 'G', 'P', 'C', 'T' };
+/// Version of the file format.
+static const uint32_t TABLE_VERSION = 1;
+/// Relative tolerance of grid bounds and RO matching.
+static const double TABLE_TOL = 1e-9;
+
+/// Writes a plain value to the stream.
+template<typename T>
+static void WriteValue(std::ostream& os, T value)
+{
+    os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/// Reads a plain value from the stream.
+template<typename T>
+static bool ReadValue(std::istream& is, T& value)
+{
+    return static_cast<bool>(is.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+/// Are the values equal within the table tolerance?
+static bool IsClose(double dX, double dY)
+{
+    return std::fabs(dX - dY) <= TABLE_TOL*(1.0 + std::fabs(dY));
+}
+
+/// Does the axis have points, and a range to spread them over if there are more of them?
+static bool IsValidAxis(const CGainTable::SAxis& axis)
+{
+    if (axis.nPoints == 0 || !std::isfinite(axis.dMin))
+        return false;
+    return axis.nPoints == 1 || (std::isfinite(axis.dMax) && axis.dMax > axis.dMin);
+}
+
+CGainTable::CGainTable() : m_nA(0), m_nB(0), m_nPoints(0)
+{
+}
+
+void CGainTable::SetGrid(const std::vector<SAxis>& vAAxes, const std::vector<SAxis>& vBAxes)
+{
+    if (vAAxes.size() + vBAxes.size() > MAX_AXES)
+        throw std::string("Gain table supports at most ") + std::to_string(MAX_AXES) + std::string(" model coefficients.");
+    for (auto& axis : vAAxes)
+        if (!IsValidAxis(axis))
+            throw std::string("Gain table axis needs a point, and a range for more points.");
+    for (auto& axis : vBAxes)
+        if (!IsValidAxis(axis))
+            throw std::string("Gain table axis needs a point, and a range for more points.");
+
+    m_nA = vAAxes.size();
+    m_nB = vBAxes.size();
+    m_vAxes = vAAxes;
+    m_vAxes.insert(m_vAxes.end(), vBAxes.begin(), vBAxes.end());
+    m_vGains.clear();
+    UpdateLayout();
+}
+
+void CGainTable::AddSetting(int nL, int nH, double dRO)
+{
+    SSetting setting;
+    setting.nL = nL;
+    setting.nH = nH;
+    setting.dRO = dRO;
+    m_vSettings.push_back(setting);
+    m_vGains.clear();
+    UpdateLayout();
+}
+
+void CGainTable::UpdateLayout()
+{
+    m_nPoints = m_vAxes.empty() ? 0 : 1;
+    for (auto& axis : m_vAxes)
+        m_nPoints *= axis.nPoints;
+
+    // gains of every setting are stored one after another
+    m_vOffset.resize(m_vSettings.size());
+    size_t nOffset = 0;
+    for (size_t s = 0; s < m_vSettings.size(); ++s)
+    {
+        m_vOffset[s] = nOffset;
+        nOffset += m_nPoints*std::max(m_vSettings[s].nH, 0);
+    }
+}
+
+void CGainTable::GetPointModel(size_t nPoint, std::vector<double>& vA, std::vector<double>& vB) const
+{
+    vA.resize(m_nA);
+    vB.resize(m_nB);
+
+    // the last axis changes fastest
+    for (int d = m_vAxes.size() - 1; d >= 0; --d)
+    {
+        const SAxis& axis = m_vAxes[d];
+        unsigned int nIdx = nPoint % axis.nPoints;
+        nPoint /= axis.nPoints;
+
+        double dValue = axis.dMin;
+        if (axis.nPoints > 1)
+            dValue += (axis.dMax - axis.dMin)*nIdx/(axis.nPoints - 1);
+
+        if (d < static_cast<int>(m_nA))
+            vA[d] = dValue;
+        else
+            vB[d - m_nA] = dValue;
+    }
+}
+
+void CGainTable::StepResponse(const std::vector<double>& vA, const std::vector<double>& vB,
+                              int nH, double* pOut)
+{
+    int nA = vA.size();
+    int nB = vB.size();
+
+    for (int n = 0; n < nH; ++n)
+    {
+        // input is 1 from the first sample on
+        double dBU = 0.0;
+        for (int j = 0; j < nB; ++j)
+            dBU += vB[j]*(j <= n ? 1.0 : 0.0);
+
+        double dAY = 0.0;
+        for (int i = 0; i < nA; ++i)
+            dAY += vA[i]*(i < n ? pOut[n - 1 - i] : 0.0);
+
+        pOut[n] = dBU - dAY;
+    }
+}
+
+void CGainTable::Build(unsigned int nThreads)
+{
+    UpdateLayout();
+    size_t nTotal = 0;
+    int nMaxH = 0;
+    for (auto& setting : m_vSettings)
+    {
+        nTotal += m_nPoints*std::max(setting.nH, 0);
+        nMaxH = std::max(nMaxH, setting.nH);
+    }
+    m_vGains.assign(nTotal, 0.0);
+    if (nTotal == 0)
+        return;
+
+    if (nThreads == 0)
+        nThreads = std::max(1u, std::thread::hardware_concurrency());
+    nThreads = static_cast<unsigned int>(std::min<size_t>(nThreads, m_nPoints));
+
+    // grid points are handed out one by one, every thread has its own workspace
+    std::atomic<size_t> nNext(0);
+    auto worker = [this, &nNext, nMaxH]()
+    {
+        CGPCGainSolver solver;
+        Eigen::VectorXd vQ;
+        std::vector<double> vA, vB, vStep(nMaxH);
+
+        for (size_t p = nNext.fetch_add(1); p < m_nPoints; p = nNext.fetch_add(1))
+        {
+            GetPointModel(p, vA, vB);
+            StepResponse(vA, vB, nMaxH, vStep.data());
+
+            for (size_t s = 0; s < m_vSettings.size(); ++s)
+            {
+                const SSetting& setting = m_vSettings[s];
+                if (setting.nH <= 0)
+                    continue;
+                solver.Solve(vStep.data(), setting.nH, setting.nL, setting.dRO, vQ);
+                std::copy(vQ.data(), vQ.data() + setting.nH, m_vGains.begin() + m_vOffset[s] + p*setting.nH);
+            }
+        }
+    };
+
+    std::vector<std::thread> vThreads;
+    for (unsigned int i = 1; i < nThreads; ++i)
+        vThreads.emplace_back(worker);
+    worker();
+    for (auto& thread : vThreads)
+        thread.join();
+}
+
+bool CGainTable::Save(const std::string& sFileName) const
+{
+    std::ofstream fs(sFileName, std::ios::binary);
+    if (!fs)
+        return false;
+
+    fs.write(TABLE_TAG, sizeof(TABLE_TAG));
+    WriteValue<uint32_t>(fs, TABLE_VERSION);
+    WriteValue<uint32_t>(fs, m_nA);
+    WriteValue<uint32_t>(fs, m_nB);
+    for (auto& axis : m_vAxes)
+    {
+        WriteValue<double>(fs, axis.dMin);
+        WriteValue<double>(fs, axis.dMax);
+        WriteValue<uint32_t>(fs, axis.nPoints);
+    }
+
+    WriteValue<uint32_t>(fs, m_vSettings.size());
+    for (auto& setting : m_vSettings)
+    {
+        WriteValue<int32_t>(fs, setting.nL);
+        WriteValue<int32_t>(fs, setting.nH);
+        WriteValue<double>(fs, setting.dRO);
+    }
+
+    fs.write(reinterpret_cast<const char*>(m_vGains.data()), m_vGains.size()*sizeof(double));
+    return static_cast<bool>(fs);
+}
+
+bool CGainTable::Load(const std::string& sFileName)
+{
+    m_nA = m_nB = 0;
+    m_vAxes.clear();
+    m_vSettings.clear();
+    m_vGains.clear();
+    UpdateLayout();
+
+    // counts are checked against the bytes left, so a corrupt file cannot make a huge allocation
+    std::ifstream fs(sFileName, std::ios::binary | std::ios::ate);
+    if (!fs)
+        return false;
+    uint64_t nLeft = static_cast<uint64_t>(fs.tellg());
+    fs.seekg(0);
+
+    char tag[sizeof(TABLE_TAG)];
+    uint32_t nVersion, nA, nB, nSettings;
+    if (!fs.read(tag, sizeof(tag)) || std::memcmp(tag, TABLE_TAG, sizeof(tag)) != 0 ||
+        !ReadValue(fs, nVersion) || nVersion != TABLE_VERSION ||
+        !ReadValue(fs, nA) || !ReadValue(fs, nB) || nA > MAX_AXES || nB > MAX_AXES - nA)
+        return false;
+
+    std::vector<SAxis> vAxes(nA + nB);
+    uint64_t nPoints = 1;
+    for (auto& axis : vAxes)
+    {
+        uint32_t nAxisPoints;
+        if (!ReadValue(fs, axis.dMin) || !ReadValue(fs, axis.dMax) || !ReadValue(fs, nAxisPoints))
+            return false;
+        axis.nPoints = nAxisPoints;
+        if (!IsValidAxis(axis) || nAxisPoints > std::numeric_limits<size_t>::max()/nPoints)
+            return false;
+        nPoints *= nAxisPoints;
+    }
+
+    // a setting takes 16 bytes
+    if (!ReadValue(fs, nSettings))
+        return false;
+    nLeft -= static_cast<uint64_t>(fs.tellg());
+    if (nSettings > nLeft/16)
+        return false;
+    nLeft -= nSettings*16ull;
+
+    std::vector<SSetting> vSettings(nSettings);
+    uint64_t nTotal = 0;
+    for (auto& setting : vSettings)
+    {
+        int32_t nL, nH;
+        if (!ReadValue(fs, nL) || !ReadValue(fs, nH) || !ReadValue(fs, setting.dRO))
+            return false;
+        setting.nL = nL;
+        setting.nH = nH;
+
+        // gains of the setting have to fit into the rest of the file
+        uint64_t nGains = nH > 0 ? static_cast<uint64_t>(nH) : 0;
+        if (nGains && nPoints > (nLeft/sizeof(double) - nTotal)/nGains)
+            return false;
+        nTotal += nPoints*nGains;
+    }
+
+    std::vector<double> vGains(nTotal);
+    if (!fs.read(reinterpret_cast<char*>(vGains.data()), nTotal*sizeof(double)))
+        return false;
+
+    // the layout is committed only when the gains are read completely
+    m_nA = nA;
+    m_nB = nB;
+    m_vAxes.swap(vAxes);
+    m_vSettings.swap(vSettings);
+    m_vGains.swap(vGains);
+    UpdateLayout();
+    return true;
+}
+
+bool CGainTable::Interpolate(const std::vector<double>& vA, const std::vector<double>& vB,
+                             int nL, int nH, double dRO, double* pQ) const
+{
+    if (m_vGains.empty() || vA.size() != m_nA || vB.size() != m_nB)
+        return false;
+
+    size_t s = 0;
+    for (; s < m_vSettings.size(); ++s)
+        if (m_vSettings[s].nL == nL && m_vSettings[s].nH == nH && IsClose(m_vSettings[s].dRO, dRO))
+            break;
+    if (s == m_vSettings.size() || nH <= 0)
+        return false;
+
+    // lower grid index and weight of the upper neighbour along every axis
+    unsigned int nDims = m_vAxes.size();
+    size_t vIdx[MAX_AXES];
+    double vWeight[MAX_AXES];
+    size_t vStride[MAX_AXES];
+    size_t nStride = 1;
+    for (int d = nDims - 1; d >= 0; --d)
+    {
+        const SAxis& axis = m_vAxes[d];
+        double dValue = d < static_cast<int>(m_nA) ? vA[d] : vB[d - m_nA];
+        vStride[d] = nStride;
+        nStride *= axis.nPoints;
+
+        if (axis.nPoints == 1)
+        {
+            if (!IsClose(dValue, axis.dMin))
+                return false;
+            vIdx[d] = 0;
+            vWeight[d] = 0.0;
+            continue;
+        }
+
+        double dPos = (dValue - axis.dMin)/(axis.dMax - axis.dMin)*(axis.nPoints - 1);
+        // written to reject a NaN too, it cannot be converted to an index
+        if (!(dPos >= -TABLE_TOL*(axis.nPoints - 1) && dPos <= (1.0 + TABLE_TOL)*(axis.nPoints - 1)))
+            return false;
+        dPos = std::min(std::max(dPos, 0.0), double(axis.nPoints - 1));
+
+        vIdx[d] = std::min<size_t>(static_cast<size_t>(dPos), axis.nPoints - 2);
+        vWeight[d] = dPos - vIdx[d];
+    }
+
+    // weighted sum over the corners of the cell, corners with zero weight are skipped
+    std::fill(pQ, pQ + nH, 0.0);
+    const double* pGains = m_vGains.data() + m_vOffset[s];
+    for (unsigned long nCorner = 0; nCorner < (1ul << nDims); ++nCorner)
+    {
+        double dWeight = 1.0;
+        size_t nPoint = 0;
+        for (unsigned int d = 0; d < nDims && dWeight != 0.0; ++d)
+        {
+            bool bUpper = (nCorner >> d) & 1;
+            dWeight *= bUpper ? vWeight[d] : 1.0 - vWeight[d];
+            nPoint += (vIdx[d] + (bUpper ? 1 : 0))*vStride[d];
+        }
+        if (dWeight == 0.0)
+            continue;
+
+        const double* pCorner = pGains + nPoint*nH;
+        for (int i = 0; i < nH; ++i)
+            pQ[i] += dWeight*pCorner[i];
+    }
+    return true;
+}
@@ -1,56 +1,63 @@
 #include "Historian.h"
+#include "StateArena.h"
+#include <algorithm>
+#include <string>
 
 void CHistorian::SetHistory(std::vector<double>& v)
 {
     m_nMaxSamples = v.size();
-    m_nSamplesStored = v.size();
+    m_vSamples.assign(v.size(), 0.0);
+    m_nHead = 0;
+    m_nCount = 0;
 
-    deqSamples.clear();
-    for(int i=m_nSamplesStored-1; i>=0; --i)
+    // the first element is the newest one
+    for(int i=int(v.size())-1; i>=0; --i)
         AddSample(v[i]);
+
+    m_nSamplesStored = v.size();
 }
 
 void CHistorian::SetMaxSamples(unsigned int nMaxSamples)
 {
-    // Rejecting the samples which exceed the limit
-    if (deqSamples.size() > nMaxSamples)
-    {
-        int nRejected = (int(deqSamples.size()) - nMaxSamples);
-        for (int i = 0; i < nRejected; ++i)
-            deqSamples.pop_front();
-    }
+    // Rejecting the samples which exceed the limit, the newest ones are kept
+    unsigned int nKept = std::min(m_nCount, nMaxSamples);
+    std::vector<double, CArenaAllocator<double> > vSamples(nMaxSamples, 0.0, m_vSamples.get_allocator());
+    for (unsigned int i = 0; i < nKept; ++i)
+        vSamples[nKept - 1 - i] = GetSample(i);
 
+    m_vSamples.swap(vSamples);
     m_nMaxSamples = nMaxSamples;
+    m_nCount = nKept;
+    m_nHead = nKept ? nKept - 1 : 0;
 }
 
-void CHistorian::AddSample(double dSample)
+void CHistorian::SetArena(CNodeArena* pArena)
 {
-    // push newest sample into the back of the queue
-	deqSamples.push_back(dSample);
-    // if the amonth of stored data exceeds size of the queue, delete a front sample
-	if (deqSamples.size() > m_nMaxSamples)
-		deqSamples.pop_front();
-
-    // increment number of samples stored
-	++m_nSamplesStored;
+    std::vector<double, CArenaAllocator<double> > vSamples(m_vSamples.begin(), m_vSamples.end(),
+        CArenaAllocator<double>(pArena));
+    m_vSamples.swap(vSamples);
 }
 
-std::unique_ptr<std::vector<double> > CHistorian::RetriveNSamples(int nN) const
+void CHistorian::AddSample(double dSample)
 {
-    //default parameter is 0 - fetch all the stored data
-	if (nN == 0)
-		nN = GetMaxSamples();
-
-	std::unique_ptr<std::vector<double> > v(new std::vector<double>(nN, 0));
+    // increment number of samples stored
+    ++m_nSamplesStored;
 
-    // determine number of samples to retrive from deque
-	int nRet = (nN > deqSamples.size()) ? deqSamples.size() : nN;
+    if (!m_nMaxSamples)
+        return;
 
-    // copy elements from deque to vector
-	auto it = deqSamples.rbegin();
-	for (int i = 0; i < nRet; ++i)
-		(*v)[i] = *(it++);
+    // the newest sample overwrites the oldest one when the buffer is full
+    if (m_nCount)
+        m_nHead = (m_nHead + 1 == m_nMaxSamples) ? 0 : m_nHead + 1;
+    m_vSamples[m_nHead] = dSample;
+    if (m_nCount < m_nMaxSamples)
+        ++m_nCount;
+}
 
+std::unique_ptr<std::vector<double> > CHistorian::RetriveNSamples(int nN) const
+{
+	std::unique_ptr<std::vector<double> > v(new std::vector<double>());
+	RetriveNSamples(*v, nN);
 	return v;
 }
 
@@ -60,15 +67,40 @@ void CHistorian::RetriveNSamples(std::vector<double>& v, int nN) const
     if (nN == 0)
         nN = GetMaxSamples();
 
-    v.resize(nN,0);
+    v.assign(nN, 0);
 
-    // determine number of samples to retrive from deque
-    int nRet = (nN > deqSamples.size()) ? deqSamples.size() : nN;
+    // determine number of samples to retrive from the buffer
+    int nRet = (nN > int(m_nCount)) ? m_nCount : nN;
 
-    // copy elements from deque to vector
-    auto it = deqSamples.rbegin();
+    // copy elements from the newest one
     for (int i = 0; i < nRet; ++i)
-        v[i] = *(it++);
+        v[i] = GetSample(i);
+}
+
+unsigned char* CHistorian::SaveSnapshot(unsigned char* p) const
+{
+    p = PutSnapshot(p, m_nHead);
+    p = PutSnapshot(p, m_nCount);
+    p = PutSnapshot(p, m_nSamplesStored);
+    std::memcpy(p, m_vSamples.data(), m_vSamples.size()*sizeof(double));
+    return p + m_vSamples.size()*sizeof(double);
+}
+
+const unsigned char* CHistorian::LoadSnapshot(const unsigned char* p)
+{
+    unsigned int nHead, nCount;
+    p = GetSnapshot(p, nHead);
+    p = GetSnapshot(p, nCount);
+
+    // positions outside of the buffer would be used as indices by GetSample() and AddSample()
+    if (nCount > m_nMaxSamples || (m_nMaxSamples ? nHead >= m_nMaxSamples : nHead != 0))
+        throw std::string("History snapshot does not fit the history of ") + std::to_string(m_nMaxSamples) + " samples.";
+
+    m_nHead = nHead;
+    m_nCount = nCount;
+    p = GetSnapshot(p, m_nSamplesStored);
+    std::memcpy(m_vSamples.data(), p, m_vSamples.size()*sizeof(double));
+    return p + m_vSamples.size()*sizeof(double);
 }
 
 CHistorian::~CHistorian()
@@ -0,0 +1,55 @@
+#include "ModelChannel.h"
+#include <algorithm>
+
+CModelChannel::CModelChannel() : m_nVersion(0)
+{
+    for (int i = 0; i < 2; ++i)
+    {
+        m_Slots[i].nSeq.store(0, std::memory_order_relaxed);
+        m_Slots[i].nNomSize = 0;
+        m_Slots[i].nDenomSize = 0;
+    }
+}
+
+void CModelChannel::Publish(const std::vector<double>& vNom, const std::vector<double>& vDenom)
+{
+    unsigned long long nVersion = m_nVersion.load(std::memory_order_relaxed) + 1;
+    SSlot& slot = m_Slots[nVersion & 1];
+
+    // mark the slot as being written
+    unsigned int nSeq = slot.nSeq.load(std::memory_order_relaxed);
+    slot.nSeq.store(nSeq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.nNomSize = static_cast<int>(std::min<size_t>(vNom.size(), MAX_COEFFS));
+    slot.nDenomSize = static_cast<int>(std::min<size_t>(vDenom.size(), MAX_COEFFS));
+    std::copy(vNom.begin(), vNom.begin() + slot.nNomSize, slot.dNom);
+    std::copy(vDenom.begin(), vDenom.begin() + slot.nDenomSize, slot.dDenom);
+
+    // close the slot and make it the published one
+    slot.nSeq.store(nSeq + 2, std::memory_order_release);
+    m_nVersion.store(nVersion, std::memory_order_release);
+}
+
+unsigned long long CModelChannel::Read(std::vector<double>& vNom, std::vector<double>& vDenom) const
+{
+    for (;;)
+    {
+        unsigned long long nVersion = m_nVersion.load(std::memory_order_acquire);
+        const SSlot& slot = m_Slots[nVersion & 1];
+
+        unsigned int nSeq = slot.nSeq.load(std::memory_order_acquire);
+        if (nSeq & 1)
+            continue;
+
+        int nNomSize = std::min(std::max(slot.nNomSize, 0), int(MAX_COEFFS));
+        int nDenomSize = std::min(std::max(slot.nDenomSize, 0), int(MAX_COEFFS));
+        vNom.assign(slot.dNom, slot.dNom + nNomSize);
+        vDenom.assign(slot.dDenom, slot.dDenom + nDenomSize);
+
+        // the copy is valid only if the writer did not touch the slot meanwhile
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.nSeq.load(std::memory_order_relaxed) == nSeq)
+            return nVersion;
+    }
+}
@@ -0,0 +1,88 @@
+#include "NodeArena.h"
+#include <algorithm>
+#include <cstdint>
+
+/// Blocks are aligned and sized in multiples of the granule, so any freed block fits another of its size.
+static const size_t GRANULE = alignof(std::max_align_t);
+
+/// \brief Returns size of the block holding nBytes.
+static size_t BlockSize(size_t nBytes)
+{
+    return (std::max<size_t>(nBytes, 1) + GRANULE - 1) & ~(GRANULE - 1);
+}
+
+CNodeArena::CNodeArena(size_t nChunkSize) : m_nChunkSize(nChunkSize), m_pNext(nullptr), m_pEnd(nullptr),
+    m_nBytesUsed(0), m_nBlocks(0)
+{
+}
+
+void* CNodeArena::Allocate(size_t nBytes, size_t nAlign)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    nBytes = BlockSize(nBytes);
+    nAlign = std::max(nAlign, GRANULE);
+
+    // a freed block of the same size is taken first, it is aligned to the granule only
+    if (nAlign == GRANULE)
+    {
+        std::unordered_map<size_t, void*>::iterator list = m_FreeLists.find(nBytes);
+        if (list != m_FreeLists.end() && list->second)
+        {
+            void* p = list->second;
+            list->second = *static_cast<void**>(p);
+            m_nBytesUsed += nBytes;
+            ++m_nBlocks;
+            return p;
+        }
+    }
+
+    uintptr_t nNext = reinterpret_cast<uintptr_t>(m_pNext);
+    uintptr_t nAligned = (nNext + nAlign - 1) & ~uintptr_t(nAlign - 1);
+    if (!m_pNext || nAligned + nBytes > reinterpret_cast<uintptr_t>(m_pEnd))
+    {
+        // new chunk, blocks larger than a chunk get their own one
+        size_t nSize = std::max(m_nChunkSize, nBytes + nAlign);
+        m_vChunks.emplace_back(new unsigned char[nSize]);
+        m_pNext = m_vChunks.back().get();
+        m_pEnd = m_pNext + nSize;
+        nNext = reinterpret_cast<uintptr_t>(m_pNext);
+        nAligned = (nNext + nAlign - 1) & ~uintptr_t(nAlign - 1);
+    }
+
+    m_pNext = reinterpret_cast<unsigned char*>(nAligned + nBytes);
+    m_nBytesUsed += nBytes;
+    ++m_nBlocks;
+    return reinterpret_cast<void*>(nAligned);
+}
+
+void CNodeArena::Free(void* p, size_t nBytes)
+{
+    if (p == nullptr)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    nBytes = BlockSize(nBytes);
+    void*& pHead = m_FreeLists[nBytes];
+    *static_cast<void**>(p) = pHead;
+    pHead = p;
+
+    m_nBytesUsed -= std::min(m_nBytesUsed, nBytes);
+    if (m_nBlocks)
+        --m_nBlocks;
+}
+
+size_t CNodeArena::GetBytesUsed() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_nBytesUsed;
+}
+
+size_t CNodeArena::GetNumOfBlocks() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_nBlocks;
+}
+
+CNodeArena::~CNodeArena()
+{
+}
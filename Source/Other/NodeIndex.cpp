@@ -0,0 +1,97 @@
+#include "NodeIndex.h"
+#include "ISISO.h"
+#include "IGenerator.h"
+
+void CNodeIndex::Add(ISISO* pNode)
+{
+    m_Names[pNode->GetName()] = pNode;
+    m_IDs[pNode->GetID()] = pNode;
+}
+
+void CNodeIndex::Remove(ISISO* pNode)
+{
+    // entries are removed only if they still point to the object
+    auto itName = m_Names.find(pNode->GetName());
+    if (itName != m_Names.end() && itName->second == pNode)
+        m_Names.erase(itName);
+
+    auto itID = m_IDs.find(pNode->GetID());
+    if (itID != m_IDs.end() && itID->second == pNode)
+        m_IDs.erase(itID);
+}
+
+void CNodeIndex::Rename(ISISO* pNode, const std::string& sOldName)
+{
+    auto it = m_Names.find(sOldName);
+    if (it != m_Names.end() && it->second == pNode)
+        m_Names.erase(it);
+
+    m_Names[pNode->GetName()] = pNode;
+}
+
+void CNodeIndex::ChangeID(ISISO* pNode, int nOldID)
+{
+    auto it = m_IDs.find(nOldID);
+    if (it != m_IDs.end() && it->second == pNode)
+        m_IDs.erase(it);
+
+    m_IDs[pNode->GetID()] = pNode;
+}
+
+void CNodeIndex::AddGenerator(IGenerator* pGen, ISISO* pOwner)
+{
+    SGenerator entry = { pGen, pOwner };
+    m_Generators[pGen->GetName()] = entry;
+}
+
+void CNodeIndex::RemoveGenerator(IGenerator* pGen)
+{
+    auto it = m_Generators.find(pGen->GetName());
+    if (it != m_Generators.end() && it->second.pGen == pGen)
+    {
+        m_Generators.erase(it);
+        return;
+    }
+
+    // the generator was renamed after it had been added
+    for (it = m_Generators.begin(); it != m_Generators.end(); ++it)
+    {
+        if (it->second.pGen == pGen)
+        {
+            m_Generators.erase(it);
+            return;
+        }
+    }
+}
+
+const CNodeIndex::SGenerator* CNodeIndex::FindGeneratorEntry(const std::string& sName) const
+{
+    auto it = m_Generators.find(sName);
+    if (it == m_Generators.end() || it->second.pGen->GetName() != sName)
+        return nullptr;
+
+    return &it->second;
+}
+
+ISISO* CNodeIndex::FindObject(const std::string& sName) const
+{
+    auto it = m_Names.find(sName);
+    if (it != m_Names.end())
+        return it->second;
+
+    // the name of a generator gives its regulator
+    const SGenerator* pEntry = FindGeneratorEntry(sName);
+    return pEntry ? pEntry->pOwner : nullptr;
+}
+
+ISISO* CNodeIndex::FindObject(int nID) const
+{
+    auto it = m_IDs.find(nID);
+    return it != m_IDs.end() ? it->second : nullptr;
+}
+
+IGenerator* CNodeIndex::FindGenerator(const std::string& sName) const
+{
+    const SGenerator* pEntry = FindGeneratorEntry(sName);
+    return pEntry ? pEntry->pGen : nullptr;
+}
@@ -0,0 +1,58 @@
+#include "ParamChannel.h"
+#include "ArrayCodec.h"
+
+CParamChannel::CParamChannel() : m_pPending(nullptr)
+{
+}
+
+bool CParamChannel::Stage(const std::string& sTarget, const std::string& sKey, const std::string& sValue)
+{
+    SParamUpdate update;
+    if (!Parse(sValue, update.vValue))
+        return false;
+    update.sTarget = sTarget;
+    update.sKey = sKey;
+
+    std::lock_guard<std::mutex> lock(m_StageMutex);
+
+    // take the block back from the simulation thread, add to it and hand it over again
+    Block* pBlock = m_pPending.exchange(nullptr, std::memory_order_acquire);
+    if (pBlock == nullptr)
+        pBlock = new Block;
+    pBlock->push_back(std::move(update));
+    m_pPending.store(pBlock, std::memory_order_release);
+
+    return true;
+}
+
+std::unique_ptr<CParamChannel::Block> CParamChannel::Take()
+{
+    // a plain load is enough when nothing is staged, which is almost every step
+    if (m_pPending.load(std::memory_order_relaxed) == nullptr)
+        return std::unique_ptr<Block>();
+
+    return std::unique_ptr<Block>(m_pPending.exchange(nullptr, std::memory_order_acquire));
+}
+
+bool CParamChannel::Parse(const std::string& sValue, std::vector<double>& vValue)
+{
+    vValue.clear();
+
+    if (sValue == "true")
+    {
+        vValue.push_back(1);
+        return true;
+    }
+    if (sValue == "false")
+    {
+        vValue.push_back(0);
+        return true;
+    }
+
+    return CArrayCodec::Parse(sValue.data(), sValue.data() + sValue.size(), vValue) && !vValue.empty();
+}
+
+CParamChannel::~CParamChannel()
+{
+    delete m_pPending.load(std::memory_order_acquire);
+}
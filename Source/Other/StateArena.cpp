@@ -0,0 +1,65 @@
+#include "StateArena.h"
+#include "ISISO.h"
+#include <string>
+
+CStateArena::CStateArena(const ISISO& root, size_t nSlots) : m_nSlotSize(root.GetSnapshotSize()),
+    m_nSlots(nSlots), m_nDepth(0)
+{
+    m_vMemory.resize(m_nSlotSize*m_nSlots);
+    m_pMemory = m_vMemory.data();
+}
+
+CStateArena::CStateArena(unsigned char* pMemory, size_t nSlotSize, size_t nSlots) : m_pMemory(pMemory),
+    m_nSlotSize(nSlotSize), m_nSlots(nSlots), m_nDepth(0)
+{
+}
+
+unsigned char* CStateArena::GetSlot(size_t nSlot) const
+{
+    if (nSlot >= m_nSlots)
+        throw std::string("State arena has no slot ") + std::to_string(nSlot) + ".";
+    return m_pMemory + nSlot*m_nSlotSize;
+}
+
+void CStateArena::Save(const ISISO& root, size_t nSlot)
+{
+    // the tree changed since the arena was created
+    if (root.GetSnapshotSize() != m_nSlotSize)
+        throw std::string("Snapshot of ") + root.GetName() + " does not fit the state arena slot.";
+
+    root.SaveSnapshot(GetSlot(nSlot));
+}
+
+void CStateArena::Load(ISISO& root, size_t nSlot) const
+{
+    // the slot holds the state of another tree
+    if (root.GetSnapshotSize() != m_nSlotSize)
+        throw std::string("Snapshot of ") + root.GetName() + " does not fit the state arena slot.";
+
+    root.LoadSnapshot(GetSlot(nSlot));
+}
+
+void CStateArena::Push(const ISISO& root)
+{
+    Save(root, m_nDepth);
+    ++m_nDepth;
+}
+
+void CStateArena::Pop(ISISO& root)
+{
+    Peek(root);
+    --m_nDepth;
+}
+
+void CStateArena::Peek(ISISO& root) const
+{
+    if (!m_nDepth)
+        throw std::string("State arena stack is empty.");
+    Load(root, m_nDepth - 1);
+}
+
+void CStateArena::Drop()
+{
+    if (m_nDepth)
+        --m_nDepth;
+}
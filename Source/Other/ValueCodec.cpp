@@ -0,0 +1,87 @@
+#include "ValueCodec.h"
+#include <charconv>
+
+/// \brief Checks if the character is skipped around numbers by a stream.
+static bool IsSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/// \brief Narrows the text to the characters between the white space around it.
+/// \return False if nothing is left.
+static bool Trim(const std::string& s, const char*& pFirst, const char*& pLast)
+{
+    pFirst = s.data();
+    pLast = pFirst + s.size();
+    while (pFirst != pLast && IsSpace(*pFirst))
+        ++pFirst;
+    while (pLast != pFirst && IsSpace(pLast[-1]))
+        --pLast;
+    return pFirst != pLast;
+}
+
+/// \brief Parses the whole trimmed text as a number, skipping a plus sign like a stream.
+template <class T>
+static bool ParseNumber(const std::string& s, T& value)
+{
+    const char* pFirst;
+    const char* pLast;
+    if (!Trim(s, pFirst, pLast))
+        return false;
+
+    // from_chars takes only the minus, signs of unsigned numbers are left to the stream
+    if (*pFirst == '+' && pLast - pFirst > 1 && pFirst[1] != '-')
+        ++pFirst;
+
+    std::from_chars_result result = std::from_chars(pFirst, pLast, value);
+    return result.ec == std::errc() && result.ptr == pLast;
+}
+
+bool CValueCodec::Parse(const std::string& s, int& n)
+{
+    return ParseNumber(s, n);
+}
+
+bool CValueCodec::Parse(const std::string& s, unsigned int& n)
+{
+    return ParseNumber(s, n);
+}
+
+bool CValueCodec::Parse(const std::string& s, long long& n)
+{
+    return ParseNumber(s, n);
+}
+
+bool CValueCodec::Parse(const std::string& s, double& d)
+{
+    const char* pFirst;
+    const char* pLast;
+    if (!Trim(s, pFirst, pLast))
+        return false;
+
+    // from_chars reads inf and nan, which the stream does not
+    const char* pDigits = *pFirst == '+' || *pFirst == '-' ? pFirst + 1 : pFirst;
+    if (pDigits == pLast || !((*pDigits >= '0' && *pDigits <= '9') || *pDigits == '.'))
+        return false;
+
+    return ParseNumber(s, d);
+}
+
+bool CValueCodec::Parse(const std::string& s, bool& b)
+{
+    const char* pFirst;
+    const char* pLast;
+    if (!Trim(s, pFirst, pLast))
+        return false;
+
+    std::string::size_type nLength = pLast - pFirst;
+    if (nLength == 1 && (*pFirst == '0' || *pFirst == '1'))
+        b = *pFirst == '1';
+    else if (s.compare(pFirst - s.data(), nLength, "true") == 0)
+        b = true;
+    else if (s.compare(pFirst - s.data(), nLength, "false") == 0)
+        b = false;
+    else
+        return false;
+    return true;
+}
@@ -0,0 +1,384 @@
+#include "XmlReader.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+/// \brief Checks if the character is an XML white space.
+static bool IsSpace(int c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/// \brief Appends a code point to the string in UTF-8.
+static void AppendUtf8(std::string& s, unsigned long nCode)
+{
+    if (nCode < 0x80)
+        s += static_cast<char>(nCode);
+    else if (nCode < 0x800)
+    {
+        s += static_cast<char>(0xC0 | (nCode >> 6));
+        s += static_cast<char>(0x80 | (nCode & 0x3F));
+    }
+    else if (nCode < 0x10000)
+    {
+        s += static_cast<char>(0xE0 | (nCode >> 12));
+        s += static_cast<char>(0x80 | ((nCode >> 6) & 0x3F));
+        s += static_cast<char>(0x80 | (nCode & 0x3F));
+    }
+    else
+    {
+        s += static_cast<char>(0xF0 | (nCode >> 18));
+        s += static_cast<char>(0x80 | ((nCode >> 12) & 0x3F));
+        s += static_cast<char>(0x80 | ((nCode >> 6) & 0x3F));
+        s += static_cast<char>(0x80 | (nCode & 0x3F));
+    }
+}
+
+CXmlReader::CXmlReader(std::istream& is, int nLine) : m_pBuf(is.rdbuf()), m_pBlock(new char[BLOCK]), m_pCur(m_pBlock.get()),
+    m_pEnd(m_pCur), m_nBlockOffset(0), m_nLine(nLine), m_nTagOffset(0), m_bPendingEnd(false), m_nDepth(0)
+{
+}
+
+CXmlReader::EEvent CXmlReader::Next()
+{
+    // the end of a self-closing element
+    if (m_bPendingEnd)
+    {
+        m_bPendingEnd = false;
+        m_nDepth = static_cast<int>(m_vOpen.size()) + 1;
+        return evEnd;
+    }
+
+    for (;;)
+    {
+        int c = Peek();
+        if (c == EOF)
+        {
+            if (!m_vOpen.empty())
+                Error("Unexpected end of document, element " + m_vOpen.back() + " is not closed");
+            return evEndOfDocument;
+        }
+
+        if (c != '<')
+        {
+            // text up to the next tag, runs without entities are taken at once
+            m_sText.clear();
+            bool bSpaceOnly = true;
+            while (ReadUntil(m_sText, '<', '&') == '&')
+            {
+                Get();
+                ReadEntity(m_sText);
+                bSpaceOnly = false;
+            }
+
+            bSpaceOnly = bSpaceOnly && std::all_of(m_sText.begin(), m_sText.end(), [](char ch) { return IsSpace(ch); });
+            if (bSpaceOnly)
+                continue;
+            if (m_vOpen.empty())
+                Error("Text outside of the root element");
+            return evText;
+        }
+
+        m_nTagOffset = GetOffset();
+        Get();
+        c = Peek();
+        if (c == '?')
+        {
+            // processing instruction or XML declaration
+            SkipPast("?>");
+            continue;
+        }
+
+        if (c == '!')
+        {
+            Get();
+            if (Peek() == '-')
+            {
+                Get();
+                if (Get() != '-')
+                    Error("Malformed comment");
+                SkipPast("-->");
+                continue;
+            }
+
+            if (Peek() == '[')
+            {
+                // CDATA section is reported as text
+                const char* sCData = "[CDATA[";
+                for (const char* p = sCData; *p; ++p)
+                    if (Get() != *p)
+                        Error("Malformed CDATA section");
+                if (m_vOpen.empty())
+                    Error("CDATA section outside of the root element");
+
+                m_sText.clear();
+                while (m_sText.size() < 3 || m_sText.compare(m_sText.size() - 3, 3, "]]>") != 0)
+                {
+                    int ch = Get();
+                    if (ch == EOF)
+                        Error("Unexpected end of document in CDATA section");
+                    m_sText += static_cast<char>(ch);
+                }
+                m_sText.resize(m_sText.size() - 3);
+                return evText;
+            }
+
+            // document type declaration, internal subsets are not supported
+            SkipPast(">");
+            continue;
+        }
+
+        if (c == '/')
+        {
+            // end tag
+            Get();
+            ReadName(m_sName);
+            SkipSpace();
+            if (Get() != '>')
+                Error("Malformed end tag of element " + m_sName);
+            if (m_vOpen.empty() || m_vOpen.back() != m_sName)
+                Error("Unexpected end tag of element " + m_sName +
+                      (m_vOpen.empty() ? std::string() : ", element " + m_vOpen.back() + " is open"));
+
+            m_nDepth = static_cast<int>(m_vOpen.size());
+            m_vOpen.pop_back();
+            return evEnd;
+        }
+
+        // start tag
+        if (m_vOpen.empty() && m_nDepth != 0)
+            Error("Second root element");
+
+        ReadName(m_sName);
+        if (ReadAttributes())
+        {
+            m_nDepth = static_cast<int>(m_vOpen.size()) + 1;
+            m_bPendingEnd = true;
+        }
+        else
+        {
+            m_vOpen.push_back(m_sName);
+            m_nDepth = static_cast<int>(m_vOpen.size());
+        }
+        return evStart;
+    }
+}
+
+bool CXmlReader::Fill()
+{
+    m_nBlockOffset += m_pEnd - m_pBlock.get();
+    std::streamsize nRead = m_pBuf->sgetn(m_pBlock.get(), static_cast<std::streamsize>(BLOCK));
+    m_pCur = m_pBlock.get();
+    m_pEnd = m_pCur + std::max<std::streamsize>(nRead, 0);
+    return m_pCur != m_pEnd;
+}
+
+int CXmlReader::Get()
+{
+    if (m_pCur == m_pEnd && !Fill())
+        return EOF;
+
+    int c = static_cast<unsigned char>(*m_pCur++);
+    if (c == '\n')
+        ++m_nLine;
+    return c;
+}
+
+void CXmlReader::ReadTree(boost::property_tree::ptree& Node)
+{
+    using boost::property_tree::ptree;
+
+    // path from the element to the current one
+    std::vector<ptree*> path;
+    path.push_back(&Node);
+    int nDepth = m_nDepth;
+
+    for (;;)
+    {
+        if (!m_vAttributes.empty())
+        {
+            ptree& attrs = path.back()->push_back(ptree::value_type("<xmlattr>", ptree()))->second;
+            for (Attributes::const_iterator it = m_vAttributes.begin(); it != m_vAttributes.end(); ++it)
+                attrs.push_back(ptree::value_type(it->first, ptree(it->second)));
+        }
+
+        // content up to the next start tag, or up to the end of the element
+        EEvent ev;
+        while ((ev = Next()) != evStart)
+        {
+            if (ev == evText)
+                path.back()->data() += m_sText;
+            else if (ev == evEnd)
+            {
+                if (m_nDepth == nDepth)
+                    return;
+                path.pop_back();
+            }
+            else
+                Error("Unexpected end of document in element " + m_sName);
+        }
+
+        path.push_back(&path.back()->push_back(ptree::value_type(m_sName, ptree()))->second);
+    }
+}
+
+int CXmlReader::Peek()
+{
+    if (m_pCur == m_pEnd && !Fill())
+        return EOF;
+
+    return static_cast<unsigned char>(*m_pCur);
+}
+
+int CXmlReader::ReadUntil(std::string& s, char cStop1, char cStop2)
+{
+    for (;;)
+    {
+        if (m_pCur == m_pEnd && !Fill())
+            return EOF;
+
+        // the first stop character in the block ends the run
+        const char* pStop = static_cast<const char*>(std::memchr(m_pCur, cStop1, m_pEnd - m_pCur));
+        const char* pLast = pStop ? pStop : m_pEnd;
+        if (const char* pStop2 = static_cast<const char*>(std::memchr(m_pCur, cStop2, pLast - m_pCur)))
+            pStop = pLast = pStop2;
+
+        m_nLine += static_cast<int>(std::count(m_pCur, pLast, '\n'));
+        s.append(m_pCur, pLast);
+        m_pCur = pLast;
+        if (pStop)
+            return static_cast<unsigned char>(*pStop);
+    }
+}
+
+void CXmlReader::SkipSpace()
+{
+    while (IsSpace(Peek()))
+        Get();
+}
+
+void CXmlReader::SkipPast(const char* sTerminator)
+{
+    size_t nLength = std::strlen(sTerminator);
+    size_t nMatched = 0;
+    while (nMatched < nLength)
+    {
+        int c = Get();
+        if (c == EOF)
+            Error(std::string("Unexpected end of document, ") + sTerminator + " expected");
+
+        if (c == sTerminator[nMatched])
+            ++nMatched;
+        else
+            nMatched = (c == sTerminator[0]) ? 1 : 0;
+    }
+}
+
+void CXmlReader::ReadName(std::string& sName)
+{
+    // names hold no line breaks, they are taken from the block at once
+    sName.clear();
+    while (m_pCur != m_pEnd || Fill())
+    {
+        const char* p = m_pCur;
+        while (p != m_pEnd && !IsSpace(*p) && *p != '/' && *p != '>' && *p != '=' && *p != '<')
+            ++p;
+        sName.append(m_pCur, p);
+        m_pCur = p;
+        if (p != m_pEnd)
+            break;
+    }
+
+    if (sName.empty())
+        Error("Name expected");
+}
+
+void CXmlReader::ReadEntity(std::string& s)
+{
+    std::string sEntity;
+    int c;
+    while ((c = Get()) != ';')
+    {
+        if (c == EOF || c == '<' || sEntity.size() > 10)
+            Error("Malformed entity &" + sEntity);
+        sEntity += static_cast<char>(c);
+    }
+
+    if (sEntity == "lt")
+        s += '<';
+    else if (sEntity == "gt")
+        s += '>';
+    else if (sEntity == "amp")
+        s += '&';
+    else if (sEntity == "quot")
+        s += '"';
+    else if (sEntity == "apos")
+        s += '\'';
+    else if (sEntity.size() > 1 && sEntity[0] == '#')
+    {
+        bool bHex = sEntity[1] == 'x';
+        const char* pFirst = sEntity.c_str() + (bHex ? 2 : 1);
+        char* pEnd = nullptr;
+        unsigned long nCode = std::strtoul(pFirst, &pEnd, bHex ? 16 : 10);
+        if (pEnd == pFirst || *pEnd != '\0' || nCode == 0 || nCode > 0x10FFFF)
+            Error("Malformed character reference &" + sEntity + ";");
+        AppendUtf8(s, nCode);
+    }
+    else
+        Error("Unknown entity &" + sEntity + ";");
+}
+
+bool CXmlReader::ReadAttributes()
+{
+    m_vAttributes.clear();
+    for (;;)
+    {
+        SkipSpace();
+        int c = Peek();
+        if (c == '>')
+        {
+            Get();
+            return false;
+        }
+
+        if (c == '/')
+        {
+            Get();
+            if (Get() != '>')
+                Error("Malformed start tag of element " + m_sName);
+            return true;
+        }
+
+        if (c == EOF)
+            Error("Unexpected end of document in start tag of element " + m_sName);
+
+        // name="value" or name='value'
+        m_vAttributes.push_back(std::make_pair(std::string(), std::string()));
+        std::pair<std::string, std::string>& attr = m_vAttributes.back();
+        ReadName(attr.first);
+        SkipSpace();
+        if (Get() != '=')
+            Error("Value of attribute " + attr.first + " expected");
+        SkipSpace();
+
+        int nQuote = Get();
+        if (nQuote != '"' && nQuote != '\'')
+            Error("Quoted value of attribute " + attr.first + " expected");
+        for (;;)
+        {
+            size_t nFirst = attr.second.size();
+            c = ReadUntil(attr.second, static_cast<char>(nQuote), '&');
+            if (c == EOF || attr.second.find('<', nFirst) != std::string::npos)
+                Error("Malformed value of attribute " + attr.first);
+            Get();
+            if (c == nQuote)
+                break;
+            ReadEntity(attr.second);
+        }
+    }
+}
+
+void CXmlReader::Error(const std::string& sMessage) const
+{
+    throw "Line " + std::to_string(m_nLine) + ": " + sMessage;
+}
@@ -0,0 +1,543 @@
+#include "CheckpointScheduler.h"
+#include "AtomicFile.h"
+#include "SLogger.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+/// Tag at the beginning of a delta file.
+static const char DELTA_TAG[4] = { 'S', 'I', 'M', 'D' };
+/// Version of the delta file format.
+static const uint32_t DELTA_VERSION = 1;
+/// Written as is, reads differently on a machine of the other byte order.
+static const uint32_t DELTA_BYTE_ORDER = 0x01020304;
+/// Flag of a session with identification.
+static const uint32_t DELTA_PREPARED = 1;
+/// Sections are aligned to this number of bytes.
+static const size_t DELTA_ALIGN = 8;
+/// States are compared in blocks of this number of bytes, a sample of a history.
+static const size_t DELTA_BLOCK = 8;
+/// Ranges closer than this are joined, it costs less than the offset and size of a new one.
+static const size_t DELTA_GAP = 16;
+
+/// Fixed part at the beginning of a delta file.
+struct SDeltaHeader
+{
+    char sTag[4];
+    uint32_t nVersion;
+    uint32_t nByteOrder;
+    uint32_t nFlags;
+    uint64_t nSeq;
+    uint64_t nPrevSeq;
+    double dLastSimVal;
+    double dRegInVal;
+    double dRegOutVal;
+    double dObjInVal;
+    double dObjOutVal;
+    uint64_t nStateSize;
+    uint64_t nRanges;
+    uint64_t nIdentificationSize;
+    uint64_t nNomSize;
+    uint64_t nDenomSize;
+    uint64_t nHash;
+};
+
+/// \brief Returns size of a section with its padding.
+static uint64_t Aligned(uint64_t nSize)
+{
+    return (nSize + DELTA_ALIGN - 1)/DELTA_ALIGN*DELTA_ALIGN;
+}
+
+/// \brief Writes a section followed by its padding.
+static void WriteSection(std::ostream& os, const void* pData, uint64_t nSize)
+{
+    static const char PADDING[DELTA_ALIGN] = {};
+    os.write(static_cast<const char*>(pData), nSize);
+    os.write(PADDING, Aligned(nSize) - nSize);
+}
+
+/// \brief Returns hash of the state, the same as full checkpoints store for their sections.
+static uint64_t HashState(const std::vector<unsigned char>& vState)
+{
+    return CCheckpoint::Hash(vState.data(), vState.size());
+}
+
+CCheckpointScheduler::CCheckpointScheduler(std::shared_ptr<CSimSession> Session, const std::string& sBaseName) :
+    m_Session(Session), m_sBaseName(sBaseName),
+    m_nStepsSince(0), m_LastTime(std::chrono::steady_clock::now()), m_nHandedRevision(0),
+    m_nFrontRevision(0), m_bHasChain(false),
+    m_bHaveBack(false), m_nBackRevision(0), m_nDeltas(0), m_bBaseChain(false), m_nBaseChainRevision(0),
+    m_nIntervalSteps(1000), m_dIntervalSeconds(60.0), m_nRestorePoints(3), m_nFullEvery(50),
+    m_nLastSeq(0), m_bChainNeeded(true), m_bPending(false), m_bLastResult(true), m_bStop(false)
+{
+    // files of an earlier run are kept as restore points until replaced
+    ReadManifest(m_sBaseName, m_vEntries);
+    if (!m_vEntries.empty())
+        m_nLastSeq = m_vEntries.back().nSeq;
+
+    m_Thread = std::thread(&CCheckpointScheduler::Work, this);
+}
+
+void CCheckpointScheduler::SetInterval(unsigned int nSteps, double dSeconds)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_nIntervalSteps = nSteps;
+    m_dIntervalSeconds = dSeconds;
+}
+
+void CCheckpointScheduler::SetRetention(unsigned int nRestorePoints, unsigned int nFullEvery)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_nRestorePoints = std::max(nRestorePoints, 1u);
+    m_nFullEvery = nFullEvery;
+}
+
+void CCheckpointScheduler::OnStep()
+{
+    ++m_nStepsSince;
+
+    unsigned int nSteps;
+    double dSeconds;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        nSteps = m_nIntervalSteps;
+        dSeconds = m_dIntervalSeconds;
+    }
+
+    bool bDue = nSteps != 0 && m_nStepsSince >= nSteps;
+    if (!bDue && dSeconds > 0.0)
+    {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_LastTime;
+        bDue = elapsed.count() >= dSeconds;
+    }
+
+    // a busy writer postpones the checkpoint to the next step
+    if (bDue)
+        Capture();
+}
+
+bool CCheckpointScheduler::Checkpoint()
+{
+    Flush();
+    Capture();
+    return Flush();
+}
+
+bool CCheckpointScheduler::Flush()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Signal.wait(lock, [this]() { return !m_bPending; });
+    return m_bLastResult;
+}
+
+unsigned long CCheckpointScheduler::GetLastSequence()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_nLastSeq;
+}
+
+bool CCheckpointScheduler::Capture()
+{
+    bool bChainNeeded;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_bPending)
+            return false;
+        bChainNeeded = m_bChainNeeded;
+    }
+
+    // the chain is formatted only when its parameters change
+    m_Chain.clear();
+    m_bHasChain = bChainNeeded || m_Session->GetChainRevision() != m_nHandedRevision;
+    m_nFrontRevision = m_Session->CaptureState(m_Front, m_bHasChain ? &m_Chain : nullptr);
+    if (!m_bHasChain && m_nFrontRevision != m_nHandedRevision)
+    {
+        // staged edits were applied by the capture itself
+        m_bHasChain = true;
+        m_nFrontRevision = m_Session->CaptureState(m_Front, &m_Chain);
+    }
+    if (m_bHasChain)
+        m_nHandedRevision = m_nFrontRevision;
+
+    m_nStepsSince = 0;
+    m_LastTime = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_bHasChain)
+            m_bChainNeeded = false;
+        m_bPending = true;
+    }
+    m_Signal.notify_all();
+    return true;
+}
+
+void CCheckpointScheduler::Work()
+{
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Signal.wait(lock, [this]() { return m_bPending || m_bStop; });
+            if (!m_bPending)
+                return;
+        }
+
+        bool bResult = false;
+        try
+        {
+            bResult = Write();
+        }
+        catch (const std::exception& e)
+        {
+            SIM_LOG_WARNING("Checkpoint of " << m_sBaseName << " not written: " << e.what());
+        }
+
+        // the next checkpoint starts a new base after a failure
+        if (!bResult)
+            m_bHaveBack = false;
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_bPending = false;
+            m_bLastResult = bResult;
+        }
+        m_Signal.notify_all();
+    }
+}
+
+bool CCheckpointScheduler::Write()
+{
+    unsigned int nFullEvery;
+    unsigned long nSeq;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        nFullEvery = m_nFullEvery;
+        nSeq = m_nLastSeq + 1;
+    }
+
+    if (m_bHasChain)
+    {
+        m_bBaseChain = false;
+        m_Base.SetChain(m_Chain);
+        m_Chain.clear();
+        m_bHasChain = false;
+        m_bBaseChain = true;
+        m_nBaseChainRevision = m_nFrontRevision;
+    }
+
+    bool bFull = !m_bHaveBack || m_nFrontRevision != m_nBackRevision ||
+                 m_Front.vState.size() != m_Back.vState.size() || m_nDeltas >= nFullEvery;
+    if (bFull && (!m_bBaseChain || m_nBaseChainRevision != m_nFrontRevision))
+    {
+        // the chain comes with the next capture
+        SIM_LOG_DEBUG("Checkpoint of " << m_sBaseName << " postponed, the chain is not captured");
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bChainNeeded = true;
+        return false;
+    }
+
+    bool bWritten;
+    std::string sFileName = FileName(m_sBaseName, nSeq, bFull);
+    if (bFull)
+    {
+        m_Base.SwapState(m_Front);
+        bWritten = m_Base.Save(sFileName);
+        m_Base.SwapState(m_Front);
+    }
+    else
+        bWritten = WriteDelta(sFileName, nSeq);
+
+    SFileEntry entry;
+    entry.nSeq = nSeq;
+    entry.nBase = bFull ? nSeq : m_vEntries.back().nBase;
+    if (!bWritten || !AddToManifest(entry))
+    {
+        SIM_LOG_WARNING("Checkpoint " << sFileName << " not written");
+        return false;
+    }
+
+    // the written state is the base of the next delta
+    std::swap(m_Front, m_Back);
+    m_nBackRevision = m_nFrontRevision;
+    m_bHaveBack = true;
+    m_nDeltas = bFull ? 0 : m_nDeltas + 1;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_nLastSeq = nSeq;
+    }
+
+    SIM_LOG_DEBUG("Checkpoint " << sFileName << " written");
+    return true;
+}
+
+bool CCheckpointScheduler::WriteDelta(const std::string& sFileName, unsigned long nSeq) const
+{
+    // changed blocks, close ones joined into ranges
+    const std::vector<unsigned char>& vNew = m_Front.vState;
+    const std::vector<unsigned char>& vOld = m_Back.vState;
+    std::vector<std::pair<uint64_t, uint64_t> > vRanges;
+    for (size_t nOffset = 0; nOffset < vNew.size(); nOffset += DELTA_BLOCK)
+    {
+        size_t nSize = std::min(DELTA_BLOCK, vNew.size() - nOffset);
+        if (std::memcmp(&vNew[nOffset], &vOld[nOffset], nSize) == 0)
+            continue;
+
+        if (!vRanges.empty() && vRanges.back().first + vRanges.back().second + DELTA_GAP >= nOffset)
+            vRanges.back().second = nOffset + nSize - vRanges.back().first;
+        else
+            vRanges.push_back(std::make_pair(nOffset, nSize));
+    }
+
+    SDeltaHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.sTag, DELTA_TAG, sizeof(DELTA_TAG));
+    header.nVersion = DELTA_VERSION;
+    header.nByteOrder = DELTA_BYTE_ORDER;
+    header.nFlags = m_Front.Loop.bPrepared ? DELTA_PREPARED : 0;
+    header.nSeq = nSeq;
+    header.nPrevSeq = nSeq - 1;
+    header.dLastSimVal = m_Front.Loop.dLastSimVal;
+    header.dRegInVal = m_Front.Loop.dRegInVal;
+    header.dRegOutVal = m_Front.Loop.dRegOutVal;
+    header.dObjInVal = m_Front.Loop.dObjInVal;
+    header.dObjOutVal = m_Front.Loop.dObjOutVal;
+    header.nStateSize = vNew.size();
+    header.nRanges = vRanges.size();
+    header.nIdentificationSize = m_Front.vIdentification.size();
+    header.nNomSize = m_Front.vNom.size();
+    header.nDenomSize = m_Front.vDenom.size();
+    header.nHash = HashState(vNew);
+
+    std::string sTempName = sFileName + ".tmp";
+    {
+        std::ofstream fs(sTempName, std::ios::binary | std::ios::trunc);
+        if (!fs)
+            return false;
+
+        fs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (size_t i = 0; i < vRanges.size(); ++i)
+        {
+            const uint64_t vRange[2] = { vRanges[i].first, vRanges[i].second };
+            fs.write(reinterpret_cast<const char*>(vRange), sizeof(vRange));
+            WriteSection(fs, &vNew[vRanges[i].first], vRanges[i].second);
+        }
+        WriteSection(fs, m_Front.vIdentification.data(), m_Front.vIdentification.size());
+        WriteSection(fs, m_Front.vNom.data(), m_Front.vNom.size()*sizeof(double));
+        WriteSection(fs, m_Front.vDenom.data(), m_Front.vDenom.size()*sizeof(double));
+        fs.flush();
+        if (!fs)
+        {
+            fs.close();
+            std::remove(sTempName.c_str());
+            return false;
+        }
+    }
+
+    return CAtomicFile::Replace(sTempName, sFileName);
+}
+
+bool CCheckpointScheduler::AddToManifest(const SFileEntry& Entry)
+{
+    unsigned int nRestorePoints;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        nRestorePoints = m_nRestorePoints;
+    }
+
+    // the latest restore points and the files they are built from are kept
+    std::vector<SFileEntry> vEntries(m_vEntries);
+    vEntries.push_back(Entry);
+    size_t nFirstKept = vEntries.size() - std::min<size_t>(nRestorePoints, vEntries.size());
+    unsigned long nFirstNeeded = Entry.nSeq;
+    for (size_t i = nFirstKept; i < vEntries.size(); ++i)
+        nFirstNeeded = std::min(nFirstNeeded, vEntries[i].nBase);
+
+    std::vector<SFileEntry> vDropped;
+    std::vector<SFileEntry>::iterator itFirst = vEntries.begin();
+    while (itFirst != vEntries.end() && itFirst->nSeq < nFirstNeeded)
+        ++itFirst;
+    vDropped.assign(vEntries.begin(), itFirst);
+    vEntries.erase(vEntries.begin(), itFirst);
+
+    std::string sFileName = m_sBaseName + ".ckpl";
+    std::string sTempName = sFileName + ".tmp";
+    {
+        std::ofstream fs(sTempName, std::ios::trunc);
+        if (!fs)
+            return false;
+
+        for (size_t i = 0; i < vEntries.size(); ++i)
+        {
+            if (vEntries[i].nSeq == vEntries[i].nBase)
+                fs << vEntries[i].nSeq << " full\n";
+            else
+                fs << vEntries[i].nSeq << " delta " << vEntries[i].nBase << "\n";
+        }
+        fs.flush();
+        if (!fs)
+        {
+            fs.close();
+            std::remove(sTempName.c_str());
+            return false;
+        }
+    }
+    if (!CAtomicFile::Replace(sTempName, sFileName))
+        return false;
+
+    // files are deleted only when the manifest does not list them any more
+    for (size_t i = 0; i < vDropped.size(); ++i)
+        std::remove(FileName(m_sBaseName, vDropped[i].nSeq, vDropped[i].nSeq == vDropped[i].nBase).c_str());
+    m_vEntries.swap(vEntries);
+    return true;
+}
+
+std::string CCheckpointScheduler::FileName(const std::string& sBaseName, unsigned long nSeq, bool bFull)
+{
+    return sBaseName + "." + std::to_string(nSeq) + (bFull ? ".ckpt" : ".ckpd");
+}
+
+void CCheckpointScheduler::ReadManifest(const std::string& sBaseName, std::vector<SFileEntry>& vEntries)
+{
+    vEntries.clear();
+    std::ifstream fs(sBaseName + ".ckpl");
+    std::string sLine;
+    while (std::getline(fs, sLine))
+    {
+        std::istringstream is(sLine);
+        SFileEntry entry;
+        std::string sKind;
+        if (!(is >> entry.nSeq >> sKind))
+            continue;
+
+        if (sKind == "full")
+            entry.nBase = entry.nSeq;
+        else if (sKind != "delta" || !(is >> entry.nBase) || entry.nBase >= entry.nSeq)
+        {
+            SIM_LOG_WARNING("Malformed line of manifest " << sBaseName << ".ckpl: " << sLine);
+            continue;
+        }
+
+        // files are listed in the order of writing
+        if (!vEntries.empty() && vEntries.back().nSeq >= entry.nSeq)
+        {
+            SIM_LOG_WARNING("Malformed line of manifest " << sBaseName << ".ckpl: " << sLine);
+            continue;
+        }
+        vEntries.push_back(entry);
+    }
+}
+
+bool CCheckpointScheduler::Restart(CSimSession& Session, const std::string& sBaseName)
+{
+    std::vector<SFileEntry> vEntries;
+    ReadManifest(sBaseName, vEntries);
+
+    // the latest restore point first
+    for (std::vector<SFileEntry>::reverse_iterator it = vEntries.rbegin(); it != vEntries.rend(); ++it)
+    {
+        CCheckpoint checkpoint;
+        if (!Rebuild(sBaseName, *it, checkpoint))
+        {
+            SIM_LOG_WARNING("Restore point " << it->nSeq << " of " << sBaseName << " is not consistent");
+            continue;
+        }
+
+        if (Session.RestoreCheckpoint(checkpoint))
+        {
+            SIM_LOG_INFO("Session restarted from restore point " << it->nSeq << " of " << sBaseName);
+            return true;
+        }
+    }
+
+    SIM_LOG_ERROR("No restore point of " << sBaseName << " can be restored");
+    return false;
+}
+
+bool CCheckpointScheduler::Rebuild(const std::string& sBaseName, const SFileEntry& Entry, CCheckpoint& Checkpoint)
+{
+    if (!Checkpoint.Open(FileName(sBaseName, Entry.nBase, true)))
+        return false;
+    if (Entry.nSeq == Entry.nBase)
+        return true;
+
+    // deltas follow the full checkpoint without gaps
+    CCheckpoint::SState state;
+    Checkpoint.GetState(state);
+    for (unsigned long nSeq = Entry.nBase + 1; nSeq <= Entry.nSeq; ++nSeq)
+        if (!ApplyDelta(FileName(sBaseName, nSeq, false), nSeq, state))
+            return false;
+
+    Checkpoint.SwapState(state);
+    return true;
+}
+
+bool CCheckpointScheduler::ApplyDelta(const std::string& sFileName, unsigned long nSeq, CCheckpoint::SState& State)
+{
+    std::ifstream fs(sFileName, std::ios::binary);
+    if (!fs)
+        return false;
+    std::vector<unsigned char> vFile((std::istreambuf_iterator<char>(fs)), std::istreambuf_iterator<char>());
+
+    SDeltaHeader header;
+    if (vFile.size() < sizeof(header))
+        return false;
+    std::memcpy(&header, vFile.data(), sizeof(header));
+    if (std::memcmp(header.sTag, DELTA_TAG, sizeof(DELTA_TAG)) != 0 ||
+        header.nVersion != DELTA_VERSION || header.nByteOrder != DELTA_BYTE_ORDER)
+        return false;
+    if (header.nSeq != nSeq || header.nPrevSeq != nSeq - 1 || header.nStateSize != State.vState.size())
+        return false;
+
+    // every range and section has to be in the file
+    const unsigned char* p = vFile.data() + sizeof(header);
+    const unsigned char* pEnd = vFile.data() + vFile.size();
+    for (uint64_t i = 0; i < header.nRanges; ++i)
+    {
+        uint64_t vRange[2];
+        if (static_cast<size_t>(pEnd - p) < sizeof(vRange))
+            return false;
+        std::memcpy(vRange, p, sizeof(vRange));
+        p += sizeof(vRange);
+
+        if (vRange[1] > header.nStateSize || vRange[0] > header.nStateSize - vRange[1] ||
+            Aligned(vRange[1]) > static_cast<uint64_t>(pEnd - p))
+            return false;
+        std::memcpy(&State.vState[vRange[0]], p, vRange[1]);
+        p += Aligned(vRange[1]);
+    }
+
+    if (Aligned(header.nIdentificationSize) > static_cast<uint64_t>(pEnd - p))
+        return false;
+    State.vIdentification.assign(p, p + header.nIdentificationSize);
+    p += Aligned(header.nIdentificationSize);
+
+    const uint64_t nDoubles = static_cast<uint64_t>(pEnd - p)/sizeof(double);
+    if (header.nNomSize > nDoubles || header.nDenomSize > nDoubles - header.nNomSize)
+        return false;
+    State.vNom.resize(header.nNomSize);
+    std::memcpy(State.vNom.data(), p, header.nNomSize*sizeof(double));
+    p += header.nNomSize*sizeof(double);
+    State.vDenom.resize(header.nDenomSize);
+    std::memcpy(State.vDenom.data(), p, header.nDenomSize*sizeof(double));
+
+    State.Loop.bPrepared = (header.nFlags & DELTA_PREPARED) != 0;
+    State.Loop.dLastSimVal = header.dLastSimVal;
+    State.Loop.dRegInVal = header.dRegInVal;
+    State.Loop.dRegOutVal = header.dRegOutVal;
+    State.Loop.dObjInVal = header.dObjInVal;
+    State.Loop.dObjOutVal = header.dObjOutVal;
+    return HashState(State.vState) == header.nHash;
+}
+
+CCheckpointScheduler::~CCheckpointScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bStop = true;
+    }
+    m_Signal.notify_all();
+    m_Thread.join();
+}
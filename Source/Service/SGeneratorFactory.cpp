@@ -17,6 +17,8 @@ IGenerator* SGeneratorFactory::CreateGenerator(GenType NewGenType)
 		return new CSquareGen;
 	case triangle:
 		return new CTriangleGen;
+	case expression:
+		return new CExpressionGen;
 	default:
         return nullptr; // invalid type
 	}
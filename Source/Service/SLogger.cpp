@@ -0,0 +1,113 @@
+#include "SLogger.h"
+#include <algorithm>
+#include <cstring>
+
+SLogger::SLogger() : m_nHead(0), m_nTail(0), m_Start(std::chrono::steady_clock::now())
+{
+    for (unsigned int i = 0; i < CAPACITY; ++i)
+    {
+        m_Slots[i].nSeq.store(0, std::memory_order_relaxed);
+        m_Slots[i].nLevel = SIM_LOG_LEVEL_DEBUG;
+        m_Slots[i].nTime = 0;
+        m_Slots[i].szSource = "";
+        m_Slots[i].nLength = 0;
+    }
+}
+
+void SLogger::Write(int nLevel, const char* szSource, const std::string& sText)
+{
+    unsigned long long nIndex = m_nHead.fetch_add(1, std::memory_order_relaxed);
+    SSlot& slot = m_Slots[nIndex & (CAPACITY - 1)];
+
+    // mark the slot as being written
+    slot.nSeq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.nLevel = nLevel;
+    slot.nTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_Start).count();
+    slot.szSource = szSource;
+    slot.nLength = static_cast<unsigned int>(std::min<size_t>(sText.size(), MAX_TEXT));
+    std::memcpy(slot.szText, sText.data(), slot.nLength);
+
+    slot.nSeq.store(nIndex + 1, std::memory_order_release);
+}
+
+unsigned long long SLogger::Read(std::vector<SEntry>& vEntries)
+{
+    unsigned long long nHead = m_nHead.load(std::memory_order_acquire);
+    unsigned long long nLost = 0;
+
+    // entries older than the buffer capacity are already overwritten
+    if (nHead - m_nTail > CAPACITY)
+    {
+        nLost = nHead - m_nTail - CAPACITY;
+        m_nTail = nHead - CAPACITY;
+    }
+
+    for (; m_nTail < nHead; ++m_nTail)
+    {
+        const SSlot& slot = m_Slots[m_nTail & (CAPACITY - 1)];
+
+        // entry not finished yet - it will be read next time
+        unsigned long long nSeq = slot.nSeq.load(std::memory_order_acquire);
+        if (nSeq == 0 || nSeq < m_nTail + 1)
+            break;
+
+        SEntry entry;
+        entry.nIndex = m_nTail;
+        entry.nLevel = slot.nLevel;
+        entry.nTime = slot.nTime;
+        entry.szSource = slot.szSource;
+        entry.sText.assign(slot.szText, std::min<unsigned int>(slot.nLength, MAX_TEXT));
+
+        // the copy is valid only if no writer reused the slot meanwhile
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.nSeq.load(std::memory_order_relaxed) != m_nTail + 1)
+        {
+            ++nLost;
+            continue;
+        }
+        vEntries.push_back(entry);
+    }
+
+    return nLost;
+}
+
+void SLogger::Dump(std::ostream& os)
+{
+    std::vector<SEntry> vEntries;
+    unsigned long long nLost = Read(vEntries);
+
+    if (nLost > 0)
+        os << "[" << nLost << " log entries lost]" << std::endl;
+
+    for (auto& entry : vEntries)
+        os << entry.nTime << " " << LevelName(entry.nLevel) << " " << entry.szSource << ": " << entry.sText << std::endl;
+}
+
+const char* SLogger::LevelName(int nLevel)
+{
+    switch (nLevel)
+    {
+    case SIM_LOG_LEVEL_DEBUG:
+        return "DEBUG";
+    case SIM_LOG_LEVEL_INFO:
+        return "INFO";
+    case SIM_LOG_LEVEL_WARNING:
+        return "WARNING";
+    case SIM_LOG_LEVEL_ERROR:
+        return "ERROR";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+SLogger::~SLogger()
+{
+}
+
+/// Static parameters initialization
+std::once_flag SLogger::m_OneCreation;
+std::shared_ptr<SLogger> SLogger::m_Instance = nullptr;
+const unsigned int SLogger::CAPACITY;
+const unsigned int SLogger::MAX_TEXT;
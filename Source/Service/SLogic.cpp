@@ -4,6 +4,84 @@
 #include <assert.h>
 #endif
 
+/** \class CGUITreeBuilder
+ * Collects objects of the loaded chain with the generators of regulators for the GUI tree.
+ * The tree is visited from the root, so every parent is listed before its children.
+ */
+class CGUITreeBuilder : public CNodeVisitor
+{
+public:
+    void Visit(CSimObject& Obj) override
+    {
+        // the root has no parent
+        AddElement(Obj.GetParent() ? Obj.GetParent()->GetName() : std::string(), Obj.GetName(), "Object");
+    }
+
+    void Visit(CRegulator& Reg) override
+    {
+        AddElement(Reg.GetParent()->GetName(), Reg.GetName(), "Regulator");
+
+        std::list<std::weak_ptr<IGenerator> > genList;
+        Reg.GetGeneratorList(genList);
+        for (auto it = genList.begin(); it != genList.end(); ++it)
+            AddElement(Reg.GetName(), it->lock()->GetName(), "Generator");
+    }
+
+    /// \brief Collects the objects of a lazily opened chain, created or not, with the generators of regulators.
+    /// \param[in] Index Index of the chain file.
+    /// \param[in] sRootName Name of the chain root, objects without a parent describe it.
+    void AddIndex(const CChainIndex& Index, const std::string& sRootName)
+    {
+        AddElement(std::string(), sRootName, "Object");
+
+        // objects whose parent is not found cannot be created, neither their children
+        std::vector<bool> vListed(Index.GetSize(), false);
+        for (size_t i = 0; i < Index.GetSize(); ++i)
+        {
+            const CChainIndex::SEntry& entry = Index.GetEntry(i);
+            if (entry.nParent == CChainIndex::ROOT)
+            {
+                vListed[i] = true;
+                continue;
+            }
+            if (entry.nParent == CChainIndex::NONE || !vListed[entry.nParent])
+                continue;
+
+            const CChainIndex::SEntry& parent = Index.GetEntry(entry.nParent);
+            const std::string& sParent = parent.nParent == CChainIndex::ROOT ? sRootName : parent.sName;
+            bool bRegulator = entry.nType >= regulator && entry.nType <= gpcregulator;
+            AddElement(sParent, entry.sName, bRegulator ? "Regulator" : "Object");
+            for (size_t j = 0; bRegulator && j < entry.vGenerators.size(); ++j)
+                AddElement(entry.sName, entry.vGenerators[j], "Generator");
+            vListed[i] = true;
+        }
+    }
+
+    /// \brief Replaces the GUI tree with the collected elements at once.
+    void Send(MainWindow* pGUI) const
+    {
+        QMetaObject::invokeMethod(pGUI, "SetTreeWidget",
+                                      Qt::QueuedConnection,
+                                      Q_ARG(QStringList, m_Parents),
+                                      Q_ARG(QStringList, m_Names),
+                                      Q_ARG(QStringList, m_Kinds),
+                                      Q_ARG(int, 0));
+    }
+
+private:
+    void AddElement(const std::string& sParent, const std::string& sName, const QString& sKind)
+    {
+        m_Parents.append(QString::fromStdString(sParent));
+        m_Names.append(QString::fromStdString(sName));
+        m_Kinds.append(sKind);
+    }
+
+    /// Collected elements
+    QStringList m_Parents;
+    QStringList m_Names;
+    QStringList m_Kinds;
+};
+
 void SLogic::Run()
 {
     // load stored data
@@ -15,9 +93,11 @@ void SLogic::Run()
     // add generator
 	try
 	{ 
-        // requires downcasting with dynamic_cast
-		ISISO* reg_obj = m_SimRoot->SearchObject("PRegulator");
-		CRegulator* reg = dynamic_cast<CRegulator*>(reg_obj);
+        // downcasting checked with the capability bits
+		CSessionScope scope(*m_Session);
+		m_Session->Materialize("PRegulator");
+		ISISO* reg_obj = m_Session->GetRoot()->SearchObject("PRegulator");
+		CRegulator* reg = AsRegulator(reg_obj);
 		reg->AddGenerator(std::shared_ptr<IGenerator>(gen));
 		IGenerator* gen2 = new CSineGen;
         reg->AddGenerator(std::shared_ptr<IGenerator>(gen2));
@@ -35,7 +115,7 @@ void SLogic::Run()
 	double next = 0;
 	for (int i = 0; i < 100; ++i)
 	{
-		next = m_SimRoot->Simulate(next);
+		next = m_Session->GetRoot()->Simulate(next);
 		std::cout << next << std::endl;
 	}
 
@@ -74,15 +154,7 @@ void SLogic::ToggleSimulation()
 
 bool SLogic::IsSimulatonChainReady()
 {
-    // very basic check - definitly not good enough to make this procedure reliable
-    std::list<std::weak_ptr<ISISO> > children;
-    simTreeMutex.lock();
-    m_SimRoot->GetChildren(children);
-    simTreeMutex.unlock();
-    int childCount = children.size();
-    if (childCount == 0)
-        return false;
-    return true;
+    return m_Session->IsReady();
 }
 
 bool SLogic::SaveSimChain(const std::string sFileName)
@@ -107,7 +179,7 @@ bool SLogic::SaveSimChain(const std::string sFileName)
 	xml_writer_settings<char> settings('\t', 1);
 
     // initializing chain-saving objects state into tree structure
-	m_SimRoot->SaveState(pt);
+	m_Session->SaveChain(pt);
 
     //after building the tree, save it as XML file
 	try
@@ -124,14 +196,18 @@ bool SLogic::SaveSimChain(const std::string sFileName)
 
 void SLogic::ObjectFocusChange(std::string& sObjName)
 {
+    // an object of a lazily opened chain is created when selected
+    m_Session->Materialize(sObjName);
+
     // fetch object data
-    simTreeMutex.lock();
-    ISISO* obj = m_SimRoot->SearchObject(sObjName);
-    if(obj == nullptr)
-        return;
-    m_SelectedObjectProperties.clear();
-    obj->SaveState(m_SelectedObjectProperties);
-    simTreeMutex.unlock();
+    {
+        std::lock_guard<std::mutex> lock(m_Session->GetTreeMutex());
+        ISISO* obj = m_Session->GetRoot()->SearchObject(sObjName);
+        if(obj == nullptr)
+            return;
+        m_SelectedObjectProperties.clear();
+        obj->SaveState(m_SelectedObjectProperties);
+    }
 
     // clear the property view
     QMetaObject::invokeMethod(m_GUIHandle, "ClearTreeWidget", Qt::QueuedConnection,
@@ -188,159 +264,65 @@ void SLogic::ExtractPropertySubtree(QString& qsParentName, const boost::property
     }
 }
 
-bool SLogic::LoadSimChain(const std::string sFileName)
+bool SLogic::LoadSimChain(const std::string sFileName, bool bLazy)
 {
-    // directives to make boost functionality more readable
-	using boost::property_tree::read_xml;
-	using boost::property_tree::ptree;
-	using boost::property_tree::xml_parser_error;
-	using boost::property_tree::ptree_bad_data;
+    // a lazily opened chain is only indexed, objects are created when simulated, selected or searched
+    bool bLoaded = bLazy ? m_Session->OpenChain(sFileName) : m_Session->LoadChain(sFileName);
+    if (!bLoaded)
+        SIM_LOG_ERROR("Chain " << sFileName << " not loaded: " << m_Session->GetLastError());
 
-    // output file stream
-	std::ifstream fs;
-	fs.open(sFileName);
-	if (!fs)
-	{
-        // TODO error handling
-		return false;
-	}
+    // the GUI gets the finished tree in one call, an empty one if loading failed
+    SendChainToGUI();
 
-    // initializing tree structure
-	ptree pt;
+	return bLoaded;
+}
 
-	try
-	{
-        // Running XML parser
-		read_xml(fs, pt);
-	}
-	catch (xml_parser_error& e)
-	{
-        // TODO error handling
-	}
+void SLogic::SendChainToGUI()
+{
+    CGUITreeBuilder builder;
+    {
+        std::lock_guard<std::mutex> lock(m_Session->GetTreeMutex());
+        if (const CChainIndex* pIndex = m_Session->GetIndex())
+            builder.AddIndex(*pIndex, m_Session->GetRoot()->GetName());
+        else
+            m_Session->GetRoot()->AcceptTree(builder);
+    }
+    builder.Send(m_GUIHandle);
+}
 
-    // deleting current simulation chain
-    m_SimRoot.reset();
-    m_SimRoot = std::shared_ptr<CSimObject>(new CSimObject(0, serial, "SimulationRoot"));
-    //m_GUIHandle->AddTreeWidgetRoot("SimulationRoot", "Object");
-    QMetaObject::invokeMethod(m_GUIHandle, "AddTreeWidgetRoot", Qt::QueuedConnection,
-                                  Q_ARG(QString, "SimulationRoot"),
-                                  Q_ARG(QString, "Object"),
-                                  Q_ARG(int, 0));
+void SLogic::EnableCheckpoints(const std::string& sBaseName, unsigned int nSteps, double dSeconds,
+                               unsigned int nRestorePoints)
+{
+    std::shared_ptr<CCheckpointScheduler> checkpoints = std::make_shared<CCheckpointScheduler>(m_Session, sBaseName);
+    checkpoints->SetInterval(nSteps, dSeconds);
+    checkpoints->SetRetention(nRestorePoints, 50);
 
-	try
-	{
-		BOOST_FOREACH(ptree::value_type const& v, pt.get_child("Object"))
-		{
-			if (v.first == "Name")
-			{
-#ifdef _DEBUG
-				std::cout << "\n\n-----------------------" << std::endl;
-				std::cout << "Object detected in file." << std::endl;
-				std::cout << "Name: " << v.second.get<std::string>("<xmlattr>.Name", "no_name") << std::endl;
-				std::cout << "ID: " << v.second.get<int>("ID") << std::endl;
-                std::cout << "Type: " << v.second.get<int>("Type") << std::endl;
-                std::cout << "Parent name: " << v.second.get<std::string>("Parent", "0") << std::endl;
-#endif
-				
-                // find the parent object
-				std::string sParentName;
-                sParentName = v.second.get<std::string>("Parent");
-				ISISO* ParentObject = m_SimRoot->SearchObject(sParentName);
-
-                // if parent name is invalid or null - discard data
-				if (sParentName == "0" || ParentObject == nullptr)
-					continue;
-
-                // create object of proper type
-				ObjType type = static_cast<ObjType>(v.second.get<int>("Type"));
-				ISISO* NewObject = SObjectFactory::GetInstance().CreateObject(type);
-
-                // checking if created object is valid
-				if (NewObject == nullptr)
-					continue;
-
-                // Set parent
-				NewObject->SetParent(ParentObject);
-
-                // Setting basic object data
-                std::string sName = v.second.get<std::string>("<xmlattr>.Name", "no_name");
-                NewObject->SetName(sName);
-                // TODO Think of better way of handling IDs
-				//SetID(v.second.get<int>("ID"));
-				NewObject->SetType(type);
-				
-                // Letting object set up its own data
-				NewObject->LoadState(v);
-
-                QString qsName = QString::fromStdString(sName);
-                QString qsParentName = QString::fromStdString(sParentName);
-                if(SObjectFactory::GetInstance().IsARegulator(type))
-                {
-                    QMetaObject::invokeMethod(m_GUIHandle, "AddTreeWidgetElement",
-                                                  Qt::QueuedConnection,
-                                                  Q_ARG(QString, qsParentName),
-                                                  Q_ARG(QString, qsName),
-                                                  Q_ARG(QString, "Regulator"),
-                                                  Q_ARG(int, 0));
-
-                    CRegulator* reg = nullptr;
-                    try
-                    {
-                        reg = dynamic_cast<CRegulator*>(NewObject);
-                    }
-                    catch (...)
-                    {
-                        //TODO error handling
-                        throw;
-                    }
-
-                    std::list<std::weak_ptr<IGenerator> > genList;
-                    reg->GetGeneratorList(genList);
-
-                    std::list<std::weak_ptr<IGenerator> >::iterator it = genList.begin();
-                    for(; it != genList.end(); ++it)
-                    {
-                        QString genName = QString::fromStdString(it->lock()->GetName());
-                        QMetaObject::invokeMethod(m_GUIHandle, "AddTreeWidgetElement",
-                                                      Qt::QueuedConnection,
-                                                      Q_ARG(QString, qsName),
-                                                      Q_ARG(QString, genName),
-                                                      Q_ARG(QString, "Generator"),
-                                                      Q_ARG(int, 0));
-                    }
-                }
-                else
-                {
-                    QMetaObject::invokeMethod(m_GUIHandle, "AddTreeWidgetElement",
-                                                  Qt::QueuedConnection,
-                                                  Q_ARG(QString, qsParentName),
-                                                  Q_ARG(QString, qsName),
-                                                  Q_ARG(QString, "Object"),
-                                                  Q_ARG(int, 0));
-                }
-			}
-		}
-	}
-	catch (ptree_bad_data& e)
-	{
-        // TODO error handling
-		std::cout << "ptree_bad_data" << std::endl;
-		throw;
-	}
-	catch (...)
-	{
-        // TODO erro handling
-		std::cout << "Error reading file data." << std::endl;
-	}
+    // a running simulation keeps its scheduler until it ends
+    std::atomic_store(&m_Checkpoints, checkpoints);
+}
 
-	return true;
+void SLogic::DisableCheckpoints()
+{
+    std::atomic_store(&m_Checkpoints, std::shared_ptr<CCheckpointScheduler>());
+}
+
+bool SLogic::RestartFromCheckpoint(const std::string& sBaseName)
+{
+    bool bRestored = CCheckpointScheduler::Restart(*m_Session, sBaseName);
+    if (!bRestored)
+        SIM_LOG_ERROR("Simulation not restarted from " << sBaseName);
+
+    // the GUI shows the restored chain, an empty one if restoring failed
+    SendChainToGUI();
+    return bRestored;
 }
 
 
 bool SLogic::SaveObjectOutputToFile(const std::string sObjName, std::string sFileName)
 {
-    // searching for chosen object
-	ISISO* obj = m_SimRoot->SearchObject(sObjName);
+    // searching for chosen object, created first if the chain is opened lazily
+	m_Session->Materialize(sObjName);
+	ISISO* obj = m_Session->GetRoot()->SearchObject(sObjName);
     // checking if found
 	if (obj == nullptr)
 		return false;
@@ -368,7 +350,7 @@ bool SLogic::SaveObjectOutputToFile(const std::string sObjName, std::string sFil
 bool SLogic::StopSavingObjectOutputToFile(const std::string sObjName)
 {
     // searching for chosen object
-	ISISO* obj = m_SimRoot->SearchObject(sObjName);
+	ISISO* obj = m_Session->GetRoot()->SearchObject(sObjName);
     // checking if found
 	if (obj == nullptr)
 		return false;
@@ -383,42 +365,15 @@ void SLogic::SelectedObjectEdited(const std::string& sObjName, const std::string
     boost::property_tree::ptree p = m_SelectedObjectProperties;
     if(m_SelectedObjectProperties.get_child_optional("Object"))
         p = m_SelectedObjectProperties.get_child("Object");
-    std::string sName = p.get<std::string>("Name.<xmlattr>.Name");
-
-    UpdateTreeValue(p, sObjName, sKey, sValue);
-    //std::cout << p.get_child("xmlattr.Name").data() << std::endl;
-
-    // directives to make boost functionality more readable
-    using boost::property_tree::write_xml;
-    using boost::property_tree::xml_writer_settings;
-    using boost::property_tree::ptree;
-    using boost::property_tree::xml_parser_error;
-    using boost::property_tree::ptree_bad_data;
-
-    std::ofstream fs;
-    fs.open("sFileName.xml");
-
-    // initializing tree structure and XML parser
-    xml_writer_settings<char> settings('\t', 1);
 
-    //after building the tree, save it as XML file
-    try
-    {
-        write_xml(fs, p, settings);
-    }
-    catch (xml_parser_error& e)
-    {
-        // TODO error handling
-    }
-
-
-    ISISO* obj = m_SimRoot->SearchObject(sName);
-    if(obj == nullptr)
+    // keep the properties shown in the GUI in line with the edit
+    if(!UpdateTreeValue(p, sObjName, sKey, sValue))
         return;
-    //p = p.front();
-
     m_SelectedObjectProperties = p;
-    obj->LoadState(p.front());
+
+    // the running simulation takes the value over at the next step
+    if(!m_Session->SetParameter(sObjName, sKey, sValue))
+        SIM_LOG_WARNING("Value " << sValue << " of " << sObjName << "." << sKey << " rejected");
 }
 
 bool SLogic::UpdateTreeValue(boost::property_tree::ptree& p, const std::string& sObjName, const std::string& sKey, const std::string& sNewValue)
@@ -431,7 +386,7 @@ bool SLogic::UpdateTreeValue(boost::property_tree::ptree& p, const std::string&
         sName = v.second.get<std::string>("<xmlattr>.Name","");
         if(sName == sObjName)
         {
-            std::cout << "Found value" << std::endl;
+            SIM_LOG_DEBUG("Found value " << sKey << " of " << sObjName);
             v.second.put(sKey, sNewValue);
             return true;
         }
@@ -445,71 +400,33 @@ bool SLogic::UpdateTreeValue(boost::property_tree::ptree& p, const std::string&
 
 void SLogic::m_RunSimulation(int nTime, int nPeriod)
 {
-    // variables to store the important values
-    std::shared_ptr<double> dInVal(new double);
-    std::shared_ptr<double> dOutVal(new double);
-    std::shared_ptr<double> dObjInVal(new double);
-    std::shared_ptr<double> dObjOutVal(new double);
-
-    // find regulator
-    simTreeMutex.lock();
-    CRegulator* reg = nullptr;
-    try
-    {
-        reg = dynamic_cast<CRegulator*>(m_SimRoot->FindFirstRegulator());
-    }
-    catch (...)
-    {
-        // if regulator not found - return
-        return;
-    }
-
-    // link it with variables
-    reg->SetVariableToStoreCurrentInput(dInVal);
-    reg->SetVariableToStoreCurrentOutput(dOutVal);
-
-    // find object
-    CSimObject* obj = nullptr;
-    try
-    {
-        obj = dynamic_cast<CSimObject*>(m_SimRoot->SearchObject("SimObject"));
-    }
-    catch (...)
-    {
+    // link the regulator and the identified object, return if not found
+    if (!m_Session->Prepare())
         return;
-    }
-    simTreeMutex.unlock();
 
-    obj->SetVariableToStoreCurrentInput(dObjInVal);
-    obj->SetVariableToStoreCurrentOutput(dObjOutVal);
+    // checkpoints enabled meanwhile are taken from the next run
+    std::shared_ptr<CCheckpointScheduler> checkpoints = std::atomic_load(&m_Checkpoints);
 
     // theta
-    std::string str = "";
+    std::vector<double> nom, denom;
 
     int nNumOfIter = nTime / nPeriod;
     for (int i = 0; i < nNumOfIter; ++i)
     {
-        // run simulation with negative feedback
-        simTreeMutex.lock();
-        m_dLastSimVal = m_SimRoot->Simulate(m_dLastSimVal);
-        simTreeMutex.unlock();
+        // run simulation with negative feedback and identification
+        double dOut = m_Session->Step();
+        if (checkpoints)
+            checkpoints->OnStep();
 
         // update plot output
-        QMetaObject::invokeMethod(m_GUIHandle, "AddPointToOutputSignal", Q_ARG(double, m_dLastSimVal));
-        QMetaObject::invokeMethod(m_GUIHandle, "AddPointToGeneratorSignal", Q_ARG(double, *dInVal));
-        QMetaObject::invokeMethod(m_GUIHandle, "AddPointToControlSignal", Q_ARG(double, *dOutVal));
-
-        // run identification
-        identifyMutex.lock();
-        m_ARXIdentAlg->AddInputElement(*dObjInVal);
-        m_ARXIdentAlg->AddOutputElement(*dObjOutVal);
-        m_ARXIdentAlg->Update();
+        QMetaObject::invokeMethod(m_GUIHandle, "AddPointToOutputSignal", Q_ARG(double, dOut));
+        QMetaObject::invokeMethod(m_GUIHandle, "AddPointToGeneratorSignal", Q_ARG(double, m_Session->GetLastGeneratorValue()));
+        QMetaObject::invokeMethod(m_GUIHandle, "AddPointToControlSignal", Q_ARG(double, m_Session->GetLastControlValue()));
 
         // display current theta
-        std::vector<double> nom = m_ARXIdentAlg->ReturnThetaNominator();
-        std::vector<double> denom =  m_ARXIdentAlg->ReturnThetaDenominator();
-        identifyMutex.unlock();
-        str = "N: " + v2str(nom) + "\nD: " + v2str(denom);
+        m_Session->GetLastIdentifiedNominator(nom);
+        m_Session->GetLastIdentifiedDenominator(denom);
+        std::string str = "N: " + v2str(nom) + "\nD: " + v2str(denom);
         QString s = QString::fromStdString(str);
         QMetaObject::invokeMethod(m_GUIHandle, "DisplayTheta", Q_ARG(QString, s));
 
@@ -518,16 +435,10 @@ void SLogic::m_RunSimulation(int nTime, int nPeriod)
     }
 }
 
-SLogic::SLogic() : m_nPeriod(10), m_nTime(1000), m_dLastSimVal(0)
+SLogic::SLogic() : m_nPeriod(10), m_nTime(1000), m_Session(new CSimSession)
 {
-    // creating a simualtion root
-	m_SimRoot = std::shared_ptr<CSimObject>(new CSimObject(1, serial, "SimulationRoot"));
-
-    // creating an identification object instance with default values
-    m_ARXIdentAlg.reset(new CARXIdentification(1, 2, 0,20, 0.99,100));
 }
 
-
 SLogic::~SLogic()
 {
 }
@@ -2,35 +2,52 @@
 
 ISISO* SObjectFactory::CreateObject(ObjType NewObjectType)
 {
+    return CreateObject(NewObjectType, GetArena());
+}
+
+ISISO* SObjectFactory::CreateObject(ObjType NewObjectType, const std::shared_ptr<CNodeArena>& arena)
+{
+    // without an arena the objects are allocated on the heap
+
 	/// Object creation based on selected type
 	switch (NewObjectType)
 	{
 	case parallel:
-		return new CSimObject(0, parallel, "ParallelObject");
+		return new (arena) CSimObject(0, parallel, "ParallelObject");
 		break;
 	case serial:
-		return new CSimObject(0, serial, "SerialObject");
+		return new (arena) CSimObject(0, serial, "SerialObject");
 		break;
 	case simobject:
-		return new CSimObject(0, simobject, "SimObject");
+		return new (arena) CSimObject(0, simobject, "SimObject");
 		break;
 	case regulator:
         return nullptr; /// regulator is an abstract class
 		break;
 	case pregulator:
-		return new CPRegulator;
+		return new (arena) CPRegulator;
     case pidregulator:
-        return new CPIDRegulator;
+        return new (arena) CPIDRegulator;
     case gpcregulator:
-        return new CGPC;
+        return new (arena) CGPC;
 	default:
 		return nullptr; /// invalid type
 	}
 }
 
+void SObjectFactory::SetArena(std::shared_ptr<CNodeArena> Arena)
+{
+    std::atomic_store(&m_Arena, Arena);
+}
+
+std::shared_ptr<CNodeArena> SObjectFactory::GetArena() const
+{
+    return std::atomic_load(&m_Arena);
+}
+
 bool SObjectFactory::IsARegulator(CSimNode* node)
 {
-    return IsARegulator(node->GetType());
+    return (node->GetKind() & kindRegulator) != 0;
 }
 
 bool SObjectFactory::IsARegulator(const ObjType& type)
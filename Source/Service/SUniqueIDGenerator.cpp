@@ -1,40 +1,139 @@
 #include "SUniqueIDGenerator.h"
+#include <algorithm>
 
+/// Number of generators a thread keeps its word of IDs for.
+static const unsigned int THREAD_GENERATORS = 4;
 
-SUniqueIDGenerator::SUniqueIDGenerator() : m_nCounter(0)
+/// Word of IDs a thread took from a generator.
+struct SThreadWord
 {
+    const SUniqueIDGenerator* pOwner;
+    unsigned int nWord;
+};
 
+/// \brief Returns position of the only set bit.
+static unsigned int BitPosition(uint64_t nBit)
+{
+    // de Bruijn sequence multiplication
+    static const unsigned char POSITIONS[64] = {
+         0,  1, 48,  2, 57, 49, 28,  3, 61, 58, 50, 42, 38, 29, 17,  4,
+        62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12,  5,
+        63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+        46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19,  9, 13,  8,  7,  6 };
+    return POSITIONS[(nBit * 0x03F79D71B4CB0A89ull) >> 58];
+}
+
+SUniqueIDGenerator::SUniqueIDGenerator() : m_nNextWord(0), m_nScan(0)
+{
+    for (unsigned int i = 0; i < WORDS; ++i)
+        m_Used[i].store(0, std::memory_order_relaxed);
+
+    // ID 0 means no ID, IDs above MAX_ID in the last word are never handed out
+    m_Used[0].fetch_or(1);
+    for (unsigned int nID = MAX_ID + 1; nID < WORDS*BLOCK; ++nID)
+        m_Used[nID / BLOCK].fetch_or(uint64_t(1) << (nID % BLOCK));
+}
+
+unsigned int SUniqueIDGenerator::ClaimInWord(unsigned int nWord)
+{
+    uint64_t nUsed = m_Used[nWord].load(std::memory_order_relaxed);
+    while (nUsed != ~uint64_t(0))
+    {
+        // lowest free bit
+        uint64_t nBit = ~nUsed & (nUsed + 1);
+        if (m_Used[nWord].compare_exchange_weak(nUsed, nUsed | nBit, std::memory_order_acq_rel))
+            return nWord*BLOCK + BitPosition(nBit);
+    }
+
+    return 0;
 }
 
 /// Retrives next unique ID
-/// Returns 0 if no unique IDs left. This usually means that there are large 
-/// ranges of IDs not used because of toxic reservations.
+/// Returns 0 if no unique IDs left.
 unsigned int SUniqueIDGenerator::GetNextID()
 {
-	m_mutCounter.lock();
-	if (m_nCounter++ >= MAX_ID)
-	{
-		m_mutCounter.unlock();
-		return 0;
-	}
-	m_mutCounter.unlock();
+    // words of IDs owned by the calling thread, one for each of the generators it used last
+    thread_local SThreadWord vWords[THREAD_GENERATORS] = {};
+    thread_local unsigned int nNextWord = 0;
+    SThreadWord* pWord = std::find_if(vWords, vWords + THREAD_GENERATORS,
+                                      [this](const SThreadWord& word) { return word.pOwner == this; });
+    if (pWord == vWords + THREAD_GENERATORS)
+    {
+        pWord = &vWords[nNextWord++ % THREAD_GENERATORS];
+        pWord->pOwner = this;
+        pWord->nWord = WORDS;
+    }
+    unsigned int& nWord = pWord->nWord;
+
+    if (nWord < WORDS)
+    {
+        unsigned int nID = ClaimInWord(nWord);
+        if (nID)
+            return nID;
+    }
+
+    // take a new word nobody used yet
+    while (m_nNextWord.load(std::memory_order_relaxed) < WORDS)
+    {
+        nWord = m_nNextWord.fetch_add(1, std::memory_order_relaxed);
+        if (nWord >= WORDS)
+            break;
+
+        unsigned int nID = ClaimInWord(nWord);
+        if (nID)
+            return nID;
+    }
+
+    // all words were given out - search for released IDs
+    for (unsigned int i = 0; i < WORDS; ++i)
+    {
+        nWord = m_nScan.fetch_add(1, std::memory_order_relaxed) % WORDS;
+        unsigned int nID = ClaimInWord(nWord);
+        if (nID)
+            return nID;
+    }
 
-	return m_nCounter;
+    nWord = WORDS;
+    return 0;
 }
 
-/// Reserves an ID. Returns false if reservation failed (usually because chosen ID is reserved).
-/// TODO handle bad reservations which disable huge ranges of available IDs
+/// Reserves an ID. Returns false if reservation failed (chosen ID is reserved or out of range).
 bool SUniqueIDGenerator::ReserveID(int nID)
 {
-	m_mutCounter.lock();
-	if (m_nCounter < nID && nID <= MAX_ID)
-	{
-		m_nCounter = nID;
-		m_mutCounter.unlock();
-		return true;
-	}
-	m_mutCounter.unlock();
-	return false;
+    if (nID <= 0 || nID > MAX_ID)
+        return false;
+
+    uint64_t nBit = uint64_t(1) << (nID % BLOCK);
+    return !(m_Used[nID / BLOCK].fetch_or(nBit, std::memory_order_acq_rel) & nBit);
+}
+
+unsigned int SUniqueIDGenerator::ReserveIDs(const std::vector<int>& vIDs, std::vector<bool>& vReserved)
+{
+    unsigned int nReserved = 0;
+    vReserved.resize(vIDs.size());
+    for (size_t i = 0; i < vIDs.size(); ++i)
+    {
+        vReserved[i] = ReserveID(vIDs[i]);
+        nReserved += vReserved[i];
+    }
+
+    return nReserved;
+}
+
+void SUniqueIDGenerator::ReleaseID(int nID)
+{
+    if (nID <= 0 || nID > MAX_ID)
+        return;
+
+    m_Used[nID / BLOCK].fetch_and(~(uint64_t(1) << (nID % BLOCK)), std::memory_order_acq_rel);
+}
+
+bool SUniqueIDGenerator::IsReserved(int nID) const
+{
+    if (nID <= 0 || nID > MAX_ID)
+        return false;
+
+    return (m_Used[nID / BLOCK].load(std::memory_order_acquire) >> (nID % BLOCK)) & 1;
 }
 
 SUniqueIDGenerator::~SUniqueIDGenerator()
@@ -44,3 +143,4 @@ SUniqueIDGenerator::~SUniqueIDGenerator()
 /// Static parameters initialization
 std::once_flag SUniqueIDGenerator::m_OneCreation;
 std::shared_ptr<SUniqueIDGenerator> SUniqueIDGenerator::m_Instance = nullptr;
+thread_local SUniqueIDGenerator* SUniqueIDGenerator::m_pCurrent = nullptr;
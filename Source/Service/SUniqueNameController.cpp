@@ -1,47 +1,58 @@
 #include "SUniqueNameController.h"
 
-#ifdef _DEBUG
-#include <iostream>
-#endif
+#include "SLogger.h"
 
 SUniqueNameController::SUniqueNameController()
 {
 }
 
-std::string& SUniqueNameController::RegisterName(std::string& sName)
+bool SUniqueNameController::TryRegister(const std::string& sName)
 {
-	std::pair<std::set<std::string>::iterator, bool> result = m_SavedNames.insert(sName);
+    SShard& shard = GetShard(sName);
+    std::lock_guard<std::mutex> lock(shard.Mutex);
+    return shard.Names.insert(sName).second;
+}
 
-    // the second value = true if insertion took place without any problems
-	if (result.second)
+std::string& SUniqueNameController::RegisterName(std::string& sName)
+{
+    // the name is free
+	if (TryRegister(sName))
 		return sName;
 
-    // increment a number of the name until it is unique
-	int i = 0;
-	while (!result.second)
+    // take next postfixes of the base name until the name is unique, only one lock is held at a time
+	SShard& shard = GetShard(sName);
+	std::string sCandidate;
+	do
 	{
-		++i;
-		result = m_SavedNames.insert(sName + std::to_string(i));
+		unsigned int nPostfix;
+		{
+			std::lock_guard<std::mutex> lock(shard.Mutex);
+			unsigned int& nNext = shard.NextPostfix[sName];
+			nPostfix = ++nNext;
+		}
+		sCandidate = sName + std::to_string(nPostfix);
 	}
+	while (!TryRegister(sCandidate));
 
-	sName += std::to_string(i);
+	sName = sCandidate;
 	return sName;
 }
 
 void SUniqueNameController::UnRegisterName(std::string& sName)
 {
-	m_SavedNames.erase(sName);
+	SShard& shard = GetShard(sName);
+	std::lock_guard<std::mutex> lock(shard.Mutex);
+	shard.Names.erase(sName);
 }
 
 
 SUniqueNameController::~SUniqueNameController()
 {
-#ifdef _DEBUG
-	std::cout << "SUniqueNameController destroyed." << std::endl;
-#endif
+	SIM_LOG_DEBUG("SUniqueNameController destroyed.");
 }
 
 
 /// Static members definitions
 std::shared_ptr<SUniqueNameController> SUniqueNameController::m_Instance = nullptr;
 std::once_flag SUniqueNameController::m_OneCreation;
+thread_local SUniqueNameController* SUniqueNameController::m_pCurrent = nullptr;
@@ -0,0 +1,60 @@
+#include "SessionPool.h"
+#include <algorithm>
+
+CSessionPool::CSessionPool(unsigned int nThreads) : m_bStop(false)
+{
+    if (nThreads == 0)
+        nThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned int i = 0; i < nThreads; ++i)
+        m_vThreads.emplace_back(&CSessionPool::Work, this);
+}
+
+std::future<double> CSessionPool::Run(std::shared_ptr<CSimSession> Session, int nSteps)
+{
+    // packaged task is not copyable, the queue holds it by a shared pointer
+    auto task = std::make_shared<std::packaged_task<double()> >([Session, nSteps]()
+    {
+        return Session->Run(nSteps);
+    });
+    std::future<double> result = task->get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Tasks.push_back([task]() { (*task)(); });
+    }
+    m_Signal.notify_one();
+
+    return result;
+}
+
+void CSessionPool::Work()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Signal.wait(lock, [this]() { return m_bStop || !m_Tasks.empty(); });
+            if (m_Tasks.empty())
+                return;
+
+            task = std::move(m_Tasks.front());
+            m_Tasks.pop_front();
+        }
+
+        task();
+    }
+}
+
+CSessionPool::~CSessionPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bStop = true;
+    }
+    m_Signal.notify_all();
+
+    for (auto& thread : m_vThreads)
+        thread.join();
+}
@@ -0,0 +1,964 @@
+#include "SimSession.h"
+#include "SLogger.h"
+#include "ValueCodec.h"
+#include "boost\foreach.hpp"
+#include "XmlReader.h"
+#include "boost\property_tree\xml_parser.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+CSimSession::CSimSession() : m_IDs(new SUniqueIDGenerator), m_Names(new SUniqueNameController),
+    m_nChainRevision(0), m_nCapturedRevision(0), m_nSeed(0), m_bPrepared(false), m_dLastSimVal(0), m_dRegInVal(new double(0)), m_dRegOutVal(new double(0)),
+    m_dObjInVal(new double(0)), m_dObjOutVal(new double(0))
+{
+    CSessionScope scope(*this);
+
+    // creating a simualtion root
+    m_SimRoot = std::shared_ptr<CSimObject>(new CSimObject(1, serial, "SimulationRoot"));
+
+    // creating an identification object instance with default values
+    m_ARXIdentAlg.reset(new CARXIdentification(1, 2, 0, 20, 0.99, 100));
+
+    // creating a channel to pass identified models to regulators
+    m_ModelChannel.reset(new CModelChannel());
+}
+
+bool CSimSession::LoadChain(const boost::property_tree::ptree& pt)
+{
+    // directives to make boost functionality more readable
+    using boost::property_tree::ptree;
+
+    CSessionScope scope(*this);
+    std::lock_guard<std::mutex> lock(m_TreeMutex);
+
+    // deleting current simulation chain, the nodes of the new one are placed in one arena
+    // in the order of the file
+    ClearChain();
+    m_sLastError.clear();
+
+    ObjectMap Objects;
+    Objects[m_SimRoot->GetName()] = m_SimRoot.get();
+
+    std::string sObject;
+    try
+    {
+        BOOST_FOREACH(ptree::value_type const& v, pt.get_child("Object"))
+        {
+            if (v.first != "Name")
+                continue;
+
+            sObject = v.second.get<std::string>("<xmlattr>.Name", "no_name");
+            AddObject(v, Objects, 0);
+        }
+    }
+    catch (std::exception& e)
+    {
+        m_sLastError = sObject.empty() ? std::string(e.what()) : "Object " + sObject + ": " + e.what();
+    }
+    catch (std::string& e)
+    {
+        m_sLastError = "Object " + sObject + ": " + e;
+    }
+
+    if (m_sLastError.empty())
+        return true;
+
+    // a chain loaded partially is not simulated
+    SIM_LOG_ERROR("Error loading chain. " << m_sLastError);
+    ClearChain();
+    return false;
+}
+
+bool CSimSession::LoadChain(std::istream& is)
+{
+    // directives to make boost functionality more readable
+    using boost::property_tree::ptree;
+
+    CSessionScope scope(*this);
+    std::lock_guard<std::mutex> lock(m_TreeMutex);
+
+    ClearChain();
+    m_sLastError.clear();
+
+    ObjectMap Objects;
+    Objects[m_SimRoot->GetName()] = m_SimRoot.get();
+
+    CXmlReader reader(is);
+    int nObjectLine = 0;
+    std::string sObject;
+    try
+    {
+        for (CXmlReader::EEvent ev = reader.Next(); ev != CXmlReader::evEndOfDocument; ev = reader.Next())
+        {
+            if (ev != CXmlReader::evStart)
+                continue;
+
+            if (reader.GetDepth() == 1)
+            {
+                if (reader.GetName() != "Object")
+                    throw "Line " + std::to_string(reader.GetLine()) + ": Object list expected, found " +
+                          reader.GetName();
+                continue;
+            }
+
+            // only objects are read from the list, the object is created at once and its element dropped
+            nObjectLine = reader.GetLine();
+            ptree::value_type object(reader.GetName(), ptree());
+            reader.ReadTree(object.second);
+            if (object.first != "Name")
+                continue;
+
+            sObject = object.second.get<std::string>("<xmlattr>.Name", "no_name");
+            AddObject(object, Objects, nObjectLine);
+            sObject.clear();
+        }
+    }
+    catch (std::exception& e)
+    {
+        m_sLastError = sObject.empty() ? std::string(e.what()) :
+                       "Line " + std::to_string(nObjectLine) + ", object " + sObject + ": " + e.what();
+    }
+    catch (std::string& e)
+    {
+        m_sLastError = sObject.empty() ? e : "Line " + std::to_string(nObjectLine) + ", object " + sObject + ": " + e;
+    }
+
+    if (m_sLastError.empty())
+        return true;
+
+    // a chain loaded partially is not simulated
+    SIM_LOG_ERROR("Error loading chain. " << m_sLastError);
+    ClearChain();
+    return false;
+}
+
+bool CSimSession::LoadChain(const std::string& sFileName)
+{
+    std::ifstream fs;
+    fs.open(sFileName);
+    if (!fs)
+    {
+        m_sLastError = "Cannot open chain file " + sFileName;
+        SIM_LOG_ERROR(m_sLastError);
+        return false;
+    }
+
+    return LoadChain(static_cast<std::istream&>(fs));
+}
+
+bool CSimSession::OpenChain(const std::string& sFileName)
+{
+    CSessionScope scope(*this);
+    std::lock_guard<std::mutex> lock(m_TreeMutex);
+
+    ClearChain();
+    m_sLastError.clear();
+
+    std::unique_ptr<CChainIndex> index(new CChainIndex);
+    try
+    {
+        index->Open(sFileName);
+
+        // only the seed is read from the root, like by a complete load
+        std::ifstream fs(sFileName, std::ios::binary);
+        for (size_t i = 0; i < index->GetSize(); ++i)
+        {
+            const CChainIndex::SEntry& entry = index->GetEntry(i);
+            if (entry.nParent != CChainIndex::ROOT)
+                continue;
+
+            std::string sElement;
+            if (!index->ReadElement(fs, i, sElement))
+                throw "Line " + std::to_string(entry.nLine) + ": element of " + entry.sName + " cannot be read";
+
+            std::istringstream element(sElement);
+            CXmlReader reader(element, entry.nLine);
+            boost::property_tree::ptree root;
+            if (reader.Next() != CXmlReader::evStart)
+                throw "Line " + std::to_string(entry.nLine) + ": element of " + entry.sName + " expected";
+            reader.ReadTree(root);
+            m_nSeed = root.get<uint64_t>("Seed", m_nSeed);
+        }
+    }
+    catch (std::exception& e)
+    {
+        m_sLastError = e.what();
+    }
+    catch (std::string& e)
+    {
+        m_sLastError = e;
+    }
+
+    if (!m_sLastError.empty())
+    {
+        SIM_LOG_ERROR("Error opening chain. " << m_sLastError);
+        return false;
+    }
+    m_SimRoot->SetRandomKey(m_nSeed);
+
+    // objects without a parent describe the root, it exists already
+    m_vIndexed.assign(index->GetSize(), nullptr);
+    for (size_t i = 0; i < index->GetSize(); ++i)
+        if (index->GetEntry(i).nParent == CChainIndex::ROOT)
+        {
+            m_vIndexed[i] = m_SimRoot.get();
+            const std::vector<size_t>& vChildren = index->GetChildren(i);
+            m_vRootChildren.insert(m_vRootChildren.end(), vChildren.begin(), vChildren.end());
+        }
+    std::sort(m_vRootChildren.begin(), m_vRootChildren.end());
+
+    m_Index = std::move(index);
+    SIM_LOG_INFO("Chain " << sFileName << " opened, " << m_Index->GetSize() << " objects indexed");
+    return true;
+}
+
+bool CSimSession::Materialize(const std::string& sName)
+{
+    std::lock_guard<std::mutex> lock(m_TreeMutex);
+
+    size_t nEntry = m_Index ? m_Index->Find(sName) : CChainIndex::NONE;
+    if (nEntry != CChainIndex::NONE)
+        return MaterializeEntry(nEntry) != nullptr;
+
+    // loaded completely, or an object created other way
+    return m_SimRoot->SearchObject(sName) != nullptr;
+}
+
+ISISO* CSimSession::MaterializeEntry(size_t nEntry)
+{
+    if (m_vIndexed[nEntry])
+        return m_vIndexed[nEntry];
+
+    // ancestors not created yet, from the object up
+    std::vector<size_t> vPath;
+    for (size_t n = nEntry; !m_vIndexed[n]; n = m_Index->GetEntry(n).nParent)
+    {
+        const CChainIndex::SEntry& entry = m_Index->GetEntry(n);
+        if (entry.nParent == CChainIndex::NONE)
+        {
+            SIM_LOG_WARNING("Line " << entry.nLine << ": parent of " << entry.sName << " not found, object skipped");
+            return nullptr;
+        }
+        vPath.push_back(n);
+    }
+
+    // offsets of the index are valid only for the indexed file
+    if (!m_Index->IsCurrent())
+    {
+        SIM_LOG_ERROR("Chain file " << m_Index->GetFileName() << " changed since opened, objects cannot be created");
+        return nullptr;
+    }
+    std::ifstream fs(m_Index->GetFileName(), std::ios::binary);
+    if (!fs)
+    {
+        SIM_LOG_ERROR("Cannot open chain file " << m_Index->GetFileName());
+        return nullptr;
+    }
+
+    CSessionScope scope(*this);
+    ++m_nChainRevision;
+    for (auto it = vPath.rbegin(); it != vPath.rend(); ++it)
+        if (!LoadEntry(fs, *it))
+            return nullptr;
+
+    // the branch is created in the order of the file, like by a complete load
+    std::vector<size_t> vBranch;
+    std::vector<size_t> vStack(1, nEntry);
+    while (!vStack.empty())
+    {
+        size_t n = vStack.back();
+        vStack.pop_back();
+        vBranch.push_back(n);
+        const std::vector<size_t>& vChildren = m_Index->GetChildren(n);
+        vStack.insert(vStack.end(), vChildren.begin(), vChildren.end());
+    }
+    std::sort(vBranch.begin(), vBranch.end());
+
+    // children of skipped objects are skipped too
+    BOOST_FOREACH(size_t n, vBranch)
+        if (!m_vIndexed[n] && m_vIndexed[m_Index->GetEntry(n).nParent])
+            LoadEntry(fs, n);
+
+    return m_vIndexed[nEntry];
+}
+
+bool CSimSession::LoadEntry(std::istream& is, size_t nEntry)
+{
+    // directives to make boost functionality more readable
+    using boost::property_tree::ptree;
+
+    const CChainIndex::SEntry& entry = m_Index->GetEntry(nEntry);
+    size_t nParent = entry.nParent;
+    std::string sElement;
+    if (!m_Index->ReadElement(is, nEntry, sElement))
+    {
+        SIM_LOG_ERROR("Line " << entry.nLine << ": element of " << entry.sName << " cannot be read");
+        return false;
+    }
+
+    // the parent is the only object the element refers to
+    ObjectMap Objects;
+    Objects[m_Index->GetEntry(nParent).sName] = m_vIndexed[nParent];
+
+    std::istringstream element(sElement);
+    CXmlReader reader(element, entry.nLine);
+    ptree::value_type object("Name", ptree());
+    try
+    {
+        if (reader.Next() != CXmlReader::evStart)
+            throw std::string("element of the object expected");
+        reader.ReadTree(object.second);
+        m_vIndexed[nEntry] = AddObject(object, Objects, entry.nLine);
+    }
+    catch (std::exception& e)
+    {
+        SIM_LOG_ERROR("Line " << entry.nLine << ", object " << entry.sName << ": " << e.what());
+    }
+    catch (std::string& e)
+    {
+        SIM_LOG_ERROR("Line " << entry.nLine << ", object " << entry.sName << ": " << e);
+    }
+
+    ISISO* pObject = m_vIndexed[nEntry];
+    if (pObject == nullptr)
+        return false;
+
+    // siblings created before are run in the order of the file, the new object is appended to them
+    const std::vector<size_t>& vSiblings = m_Index->GetEntry(nParent).nParent == CChainIndex::ROOT ?
+                                           m_vRootChildren : m_Index->GetChildren(nParent);
+    auto later = std::upper_bound(vSiblings.begin(), vSiblings.end(), nEntry);
+    if (std::none_of(later, vSiblings.end(), [this](size_t n) { return m_vIndexed[n] != nullptr; }))
+        return true;
+
+    for (auto it = vSiblings.rbegin(); it != vSiblings.rend(); ++it)
+        if (m_vIndexed[*it])
+            m_vIndexed[nParent]->MoveObjectToFront(m_vIndexed[*it]);
+    return true;
+}
+
+void CSimSession::ClearChain()
+{
+    ++m_nChainRevision;
+    m_bPrepared = false;
+    m_SimRoot.reset();
+    m_Arena = std::make_shared<CNodeArena>();
+    m_SimRoot = std::shared_ptr<CSimObject>(new (m_Arena) CSimObject(0, serial, "SimulationRoot"));
+    m_SimRoot->SetRandomKey(m_nSeed);
+    m_Index.reset();
+    m_vIndexed.clear();
+    m_vRootChildren.clear();
+    m_CapturedChain.reset();
+}
+
+ISISO* CSimSession::AddObject(boost::property_tree::ptree::value_type const& v, ObjectMap& Objects, int nLine)
+{
+    std::string sName = v.second.get<std::string>("<xmlattr>.Name", "no_name");
+    // parent is written as the text of the element, or in its "name" element by simulated objects
+    std::string sParentName = v.second.get<std::string>("Parent", "");
+    if (sParentName.empty())
+        sParentName = v.second.get<std::string>("Parent.name", "");
+
+    SIM_LOG_DEBUG("Object detected in file. Name: " << sName << " ID: " << v.second.get<int>("ID", 0)
+                  << " Type: " << v.second.get<int>("Type", 0) << " Parent name: " << sParentName);
+
+    // object without a parent describes the root
+    if (sParentName.empty() || sParentName == "0")
+    {
+        // the same seed gives the same noise as when the chain was saved
+        m_nSeed = v.second.get<uint64_t>("Seed", m_nSeed);
+        m_SimRoot->SetRandomKey(m_nSeed);
+        Objects[sName] = m_SimRoot.get();
+        return m_SimRoot.get();
+    }
+
+    // find the parent object among the objects loaded so far
+    auto parent = Objects.find(sParentName);
+    if (parent == Objects.end())
+    {
+        SIM_LOG_WARNING("Line " << nLine << ": parent " << sParentName << " of " << sName << " not found, object skipped");
+        return nullptr;
+    }
+
+    // create object of proper type
+    ObjType type = static_cast<ObjType>(CValueCodec::Get<int>(v.second, "Type"));
+    ISISO* NewObject = SObjectFactory::GetInstance().CreateObject(type, m_Arena);
+    if (NewObject == nullptr)
+    {
+        SIM_LOG_WARNING("Line " << nLine << ": unknown type " << type << " of " << sName << ", object skipped");
+        return nullptr;
+    }
+
+    // the parent takes the ownership, the new object is not on its list for sure
+    parent->second->AddChild(std::shared_ptr<ISISO>(NewObject));
+
+    // Setting basic object data
+    std::string sNewName = sName;
+    NewObject->SetName(sNewName);
+    // keep the stored ID if it is free, the generated one is used otherwise
+    int nID = CValueCodec::Get<int>(v.second, "ID", 0);
+    try
+    {
+        NewObject->SetID(nID);
+    }
+    catch (std::string& e)
+    {
+        SIM_LOG_WARNING("ID " << nID << " of " << sName << " is taken, " << NewObject->GetID() << " used instead");
+    }
+    NewObject->SetType(type);
+
+    // Letting object set up its own data
+    NewObject->LoadState(v);
+
+    // children refer to the name from the file
+    if (!Objects.insert(std::make_pair(sName, NewObject)).second)
+        SIM_LOG_WARNING("Line " << nLine << ": name " << sName << " is not unique, children refer to the first object");
+    return NewObject;
+}
+
+void CSimSession::SaveChain(boost::property_tree::ptree& pt)
+{
+    std::lock_guard<std::mutex> lock(m_TreeMutex);
+
+    // staged edits belong to the saved parameters, objects not created yet to the saved chain
+    ApplyParameters();
+    m_SimRoot->SaveState(pt);
+    if (m_Index)
+        SaveIndexed(pt);
+}
+
+void CSimSession::SaveIndexed(boost::property_tree::ptree& pt)
+{
+    // directives to make boost functionality more readable
+    using boost::property_tree::ptree;
+
+    // objects are sorted by the position in the file of their own element or of the element
+    // saved before them, objects added since stay behind it; a child always follows its parent
+    struct SKey
+    {
+        size_t nEntry;
+        size_t nOrder;
+        bool operator<(const SKey& other) const
+        {
+            return nEntry < other.nEntry || (nEntry == other.nEntry && nOrder < other.nOrder);
+        }
+    };
+    struct SElement
+    {
+        SKey key;
+        ptree::value_type* pElement;
+    };
+
+    std::unordered_map<std::string, size_t> Created;
+    for (size_t i = 0; i < m_vIndexed.size(); ++i)
+        if (m_vIndexed[i] && m_vIndexed[i] != m_SimRoot.get())
+            Created[m_vIndexed[i]->GetName()] = i;
+
+    ptree& objects = pt.get_child("Object");
+    std::vector<SElement> vElements;
+    std::unordered_map<std::string, SKey> Keys;
+    SKey last = { 0, 0 };
+    for (ptree::value_type& v : objects)
+    {
+        std::string sParentName = v.second.get<std::string>("Parent", "");
+        if (sParentName.empty())
+            sParentName = v.second.get<std::string>("Parent.name", "");
+
+        auto entry = Created.find(v.second.get<std::string>("<xmlattr>.Name", ""));
+        SKey key = { entry != Created.end() ? entry->second : last.nEntry, vElements.size() + 1 };
+        auto parent = Keys.find(sParentName);
+        if (parent != Keys.end() && !(parent->second < key))
+            key.nEntry = parent->second.nEntry;
+
+        last = key;
+        Keys[v.second.get<std::string>("<xmlattr>.Name", "")] = key;
+        SElement element = { key, &v };
+        vElements.push_back(element);
+    }
+
+    // offsets of the index are valid only for the indexed file
+    std::ifstream fs(m_Index->GetFileName(), std::ios::binary);
+    if (!m_Index->IsCurrent() || !fs)
+    {
+        SIM_LOG_ERROR("Chain file " << m_Index->GetFileName() << " changed or missing, objects not created are not saved");
+        return;
+    }
+
+    // objects not created yet are copied, children of skipped objects are skipped like by a complete load
+    std::vector<ptree::value_type> vCopied;
+    vCopied.reserve(m_Index->GetSize());
+    std::vector<SKey> vCopiedKeys(m_Index->GetSize());
+    std::vector<bool> vIncluded(m_Index->GetSize(), false);
+    for (size_t i = 0; i < m_Index->GetSize(); ++i)
+    {
+        const CChainIndex::SEntry& entry = m_Index->GetEntry(i);
+        if (m_vIndexed[i] || entry.nParent == CChainIndex::NONE || entry.nParent == CChainIndex::ROOT)
+            continue;
+
+        SKey parentKey = { 0, 0 };
+        std::string sParentName;
+        if (ISISO* pParent = m_vIndexed[entry.nParent])
+        {
+            sParentName = pParent->GetName();
+            parentKey = Keys[sParentName];
+        }
+        else if (vIncluded[entry.nParent])
+            parentKey = vCopiedKeys[entry.nParent];
+        else
+            continue;
+
+        std::string sElement;
+        ptree::value_type object("Name", ptree());
+        try
+        {
+            if (!m_Index->ReadElement(fs, i, sElement))
+                throw std::string("element cannot be read");
+            std::istringstream element(sElement);
+            CXmlReader reader(element, entry.nLine);
+            if (reader.Next() != CXmlReader::evStart)
+                throw std::string("element of the object expected");
+            reader.ReadTree(object.second);
+        }
+        catch (std::exception& e)
+        {
+            SIM_LOG_ERROR("Line " << entry.nLine << ", object " << entry.sName << " not saved: " << e.what());
+            continue;
+        }
+        catch (std::string& e)
+        {
+            SIM_LOG_ERROR("Line " << entry.nLine << ", object " << entry.sName << " not saved: " << e);
+            continue;
+        }
+
+        // a created parent is referred to by its current name
+        if (!sParentName.empty())
+        {
+            if (object.second.get_child_optional("Parent.name"))
+                object.second.put("Parent.name", sParentName);
+            else
+                object.second.put("Parent", sParentName);
+        }
+
+        SKey key = { i, 0 };
+        if (!(parentKey < key))
+            key = { parentKey.nEntry, parentKey.nOrder + 1 };
+        vIncluded[i] = true;
+        vCopiedKeys[i] = key;
+        vCopied.push_back(std::move(object));
+        SElement copied = { key, &vCopied.back() };
+        vElements.push_back(copied);
+    }
+
+    std::stable_sort(vElements.begin(), vElements.end(),
+                     [](const SElement& a, const SElement& b) { return a.key < b.key; });
+    ptree sorted;
+    for (SElement& element : vElements)
+        sorted.push_back(ptree::value_type(element.pElement->first, ptree()))->second.swap(element.pElement->second);
+    objects.swap(sorted);
+}
+
+bool CSimSession::IsReady()
+{
+    // very basic check - definitly not good enough to make this procedure reliable
+    std::list<std::weak_ptr<ISISO> > children;
+    std::lock_guard<std::mutex> lock(m_TreeMutex);
+    m_SimRoot->GetChildren(children);
+    if (!children.empty())
+        return true;
+
+    // a lazily opened chain is ready before anything is created
+    return !m_vRootChildren.empty();
+}
+
+bool CSimSession::Prepare()
+{
+    std::lock_guard<std::mutex> lock(m_TreeMutex);
+    m_bPrepared = false;
+
+    // of a lazily opened chain only the branches of the first regulator of the file and of
+    // the object are created, the created branches are simulated
+    if (m_Index)
+    {
+        for (size_t i = 0; i < m_Index->GetSize(); ++i)
+            if (SObjectFactory::GetInstance().IsARegulator(static_cast<ObjType>(m_Index->GetEntry(i).nType)) &&
+                MaterializeEntry(i))
+                break;
+
+        size_t nObject = m_Index->Find("SimObject");
+        if (nObject != CChainIndex::NONE)
+            MaterializeEntry(nObject);
+    }
+
+    // find regulator and object
+    CRegulator* reg = AsRegulator(m_SimRoot->FindFirstRegulator());
+    CSimObject* obj = AsSimObject(m_SimRoot->SearchObject("SimObject"));
+    if (reg == nullptr || obj == nullptr)
+        return false;
+
+    // link them with variables
+    reg->SetVariableToStoreCurrentInput(m_dRegInVal);
+    reg->SetVariableToStoreCurrentOutput(m_dRegOutVal);
+    obj->SetVariableToStoreCurrentInput(m_dObjInVal);
+    obj->SetVariableToStoreCurrentOutput(m_dObjOutVal);
+
+    // let predictive regulators follow the identified model
+    if (CGPC* gpc = AsGPC(reg))
+        gpc->SetModelChannel(m_ModelChannel);
+
+    m_bPrepared = true;
+    return true;
+}
+
+double CSimSession::Step()
+{
+    std::lock_guard<std::mutex> run(m_RunMutex);
+    return DoStep();
+}
+
+double CSimSession::DoStep()
+{
+    CSessionScope scope(*this);
+
+    // run simulation with negative feedback
+    double dOut;
+    {
+        std::lock_guard<std::mutex> lock(m_TreeMutex);
+        ApplyParameters();
+        m_dLastSimVal = dOut = m_SimRoot->Simulate(m_dLastSimVal);
+        if (!m_bPrepared)
+            return dOut;
+    }
+
+    // run identification and publish the model
+    std::vector<double> vNom, vDenom;
+    {
+        std::lock_guard<std::mutex> guard(m_IdentifyMutex);
+        m_ARXIdentAlg->AddInputElement(*m_dObjInVal);
+        m_ARXIdentAlg->AddOutputElement(*m_dObjOutVal);
+        m_ARXIdentAlg->Update();
+        vNom = m_ARXIdentAlg->ReturnThetaNominator();
+        vDenom = m_ARXIdentAlg->ReturnThetaDenominator();
+    }
+    m_ModelChannel->Publish(vNom, vDenom);
+
+    return dOut;
+}
+
+double CSimSession::Run(int nSteps)
+{
+    // steps of another run do not interleave with these
+    std::lock_guard<std::mutex> run(m_RunMutex);
+    double dOut = m_dLastSimVal;
+    for (int i = 0; i < nSteps; ++i)
+        dOut = DoStep();
+
+    return dOut;
+}
+
+bool CSimSession::SetParameter(const std::string& sTarget, const std::string& sKey, const std::string& sValue)
+{
+    if (!m_Params.Stage(sTarget, sKey, sValue))
+    {
+        SIM_LOG_WARNING("Invalid value " << sValue << " of " << sTarget << "." << sKey);
+        return false;
+    }
+
+    // apply at once if no step is running, waiting only for short calls holding the chain,
+    // a running step or run picks the change up at the next step otherwise
+    std::unique_lock<std::mutex> run(m_RunMutex, std::try_to_lock);
+    if (run.owns_lock())
+    {
+        std::lock_guard<std::mutex> lock(m_TreeMutex);
+        ApplyParameters();
+    }
+
+    return true;
+}
+
+void CSimSession::ApplyParameters()
+{
+    std::unique_ptr<CParamChannel::Block> block = m_Params.Take();
+    if (!block)
+        return;
+
+    // checkpoints store the parameters again
+    ++m_nChainRevision;
+
+    CNodeIndex* pIndex = m_SimRoot->GetIndex();
+    BOOST_FOREACH(const SParamUpdate& update, *block)
+    {
+        // a target of a lazily opened chain is created first
+        size_t nEntry = m_Index ? m_Index->Find(update.sTarget) : CChainIndex::NONE;
+        if (nEntry != CChainIndex::NONE)
+            MaterializeEntry(nEntry);
+
+        // generators first, searching objects by a generator name gives its regulator
+        bool bApplied = false;
+        if (IGenerator* gen = pIndex ? pIndex->FindGenerator(update.sTarget) : nullptr)
+            bApplied = gen->SetParameter(update.sKey, update.vValue);
+        else if (ISISO* obj = m_SimRoot->SearchObject(update.sTarget))
+            bApplied = obj->SetParameter(update.sKey, update.vValue);
+
+        if (!bApplied)
+            SIM_LOG_WARNING("Parameter " << update.sKey << " of " << update.sTarget << " cannot be set");
+        else
+            SIM_LOG_DEBUG("Parameter " << update.sKey << " of " << update.sTarget << " set");
+    }
+}
+
+void CSimSession::SetSeed(uint64_t nSeed)
+{
+    std::lock_guard<std::mutex> lock(m_TreeMutex);
+
+    // objects created later take the key from their parents
+    m_nSeed = nSeed;
+    m_SimRoot->SetRandomKey(nSeed);
+    ++m_nChainRevision;
+}
+
+void CSimSession::Reset()
+{
+    std::lock_guard<std::mutex> lock(m_TreeMutex);
+
+    // delete memory of every simulation object
+    m_SimRoot->ResetMemory();
+
+    // remove last stored value
+    m_dLastSimVal = 0;
+}
+
+std::shared_ptr<CSimSession> CSimSession::Fork()
+{
+    std::shared_ptr<CSimSession> fork(new CSimSession);
+    CSessionScope scope(*fork);
+
+    {
+        std::lock_guard<std::mutex> lock(m_TreeMutex);
+
+        // edits staged for this chain are part of the forked state
+        ApplyParameters();
+
+        // the copy is placed in its own arena, model vectors are shared until changed
+        fork->m_SimRoot.reset();
+        fork->m_Arena = std::make_shared<CNodeArena>();
+        fork->m_SimRoot.reset(AsSimObject(m_SimRoot->Clone(fork->m_Arena)));
+
+        // the fork of a lazily opened chain shares the index, its objects keep the IDs
+        if (m_Index)
+        {
+            fork->m_Index = m_Index;
+            fork->m_vRootChildren = m_vRootChildren;
+            fork->m_vIndexed.assign(m_vIndexed.size(), nullptr);
+            for (size_t i = 0; i < m_vIndexed.size(); ++i)
+                if (m_vIndexed[i])
+                    fork->m_vIndexed[i] = m_vIndexed[i] == m_SimRoot.get() ? fork->m_SimRoot.get() :
+                                          fork->m_SimRoot->FindObject(m_vIndexed[i]->GetID());
+        }
+
+        fork->m_nSeed = m_nSeed.load();
+        fork->m_dLastSimVal = m_dLastSimVal.load();
+        *fork->m_dRegInVal = *m_dRegInVal;
+        *fork->m_dRegOutVal = *m_dRegOutVal;
+        *fork->m_dObjInVal = *m_dObjInVal;
+        *fork->m_dObjOutVal = *m_dObjOutVal;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(m_IdentifyMutex);
+        fork->m_ARXIdentAlg = std::make_shared<CARXIdentification>(*m_ARXIdentAlg);
+    }
+
+    // the last identified model is handed over, the regulators of the fork read it on the next step
+    if (m_ModelChannel->GetVersion())
+    {
+        std::vector<double> vNom, vDenom;
+        m_ModelChannel->Read(vNom, vDenom);
+        fork->m_ModelChannel->Publish(vNom, vDenom);
+    }
+
+    if (m_bPrepared)
+        fork->Prepare();
+
+    return fork;
+}
+
+unsigned long CSimSession::CaptureState(CCheckpoint::SState& State, boost::property_tree::ptree* pChain)
+{
+    unsigned long nRevision;
+    std::shared_ptr<const boost::property_tree::ptree> chain;
+    {
+        std::lock_guard<std::mutex> lock(m_TreeMutex);
+
+        // staged edits belong to the parameters of the checkpoint, its chain holds the created objects
+        ApplyParameters();
+        nRevision = m_nChainRevision;
+
+        // the chain is stored only when it or its parameters changed, it is copied outside of the lock
+        if (pChain)
+        {
+            if (!m_CapturedChain || m_nCapturedRevision != nRevision)
+            {
+                std::shared_ptr<boost::property_tree::ptree> captured = std::make_shared<boost::property_tree::ptree>();
+                m_SimRoot->SaveState(*captured);
+                m_CapturedChain = captured;
+                m_nCapturedRevision = nRevision;
+            }
+            chain = m_CapturedChain;
+        }
+        State.vState.resize(m_SimRoot->GetSnapshotSize());
+        m_SimRoot->SaveSnapshot(State.vState.data());
+
+        State.Loop.bPrepared = m_bPrepared;
+        State.Loop.dLastSimVal = m_dLastSimVal;
+        State.Loop.dRegInVal = *m_dRegInVal;
+        State.Loop.dRegOutVal = *m_dRegOutVal;
+        State.Loop.dObjInVal = *m_dObjInVal;
+        State.Loop.dObjOutVal = *m_dObjOutVal;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(m_IdentifyMutex);
+        State.vIdentification.resize(m_ARXIdentAlg->GetSnapshotSize());
+        m_ARXIdentAlg->SaveSnapshot(State.vIdentification.data());
+    }
+
+    State.vNom.clear();
+    State.vDenom.clear();
+    if (m_ModelChannel->GetVersion())
+        m_ModelChannel->Read(State.vNom, State.vDenom);
+
+    if (chain)
+        *pChain = *chain;
+
+    return nRevision;
+}
+
+std::shared_ptr<CCheckpoint> CSimSession::TakeCheckpoint()
+{
+    boost::property_tree::ptree chain;
+    CCheckpoint::SState state;
+    CaptureState(state, &chain);
+
+    std::shared_ptr<CCheckpoint> checkpoint = std::make_shared<CCheckpoint>();
+    checkpoint->SwapState(state);
+    checkpoint->SetChain(chain);
+    return checkpoint;
+}
+
+std::future<bool> CSimSession::SaveCheckpoint(const std::string& sFileName)
+{
+    // the chain file is formatted by the writing thread
+    std::shared_ptr<boost::property_tree::ptree> chain = std::make_shared<boost::property_tree::ptree>();
+    CCheckpoint::SState state;
+    CaptureState(state, chain.get());
+
+    std::shared_ptr<CCheckpoint> checkpoint = std::make_shared<CCheckpoint>();
+    checkpoint->SwapState(state);
+    return CCheckpoint::SaveAsync(checkpoint, sFileName, chain);
+}
+
+bool CSimSession::RestoreCheckpoint(const CCheckpoint& Checkpoint)
+{
+    // parameters and structure come from the chain file
+    std::istringstream is(Checkpoint.GetChain());
+    if (!LoadChain(is))
+        return false;
+
+    // the model channel starts with the model of the checkpoint
+    std::vector<double> vNom, vDenom;
+    Checkpoint.GetModel(vNom, vDenom);
+    m_ModelChannel.reset(new CModelChannel());
+    if (!vNom.empty() || !vDenom.empty())
+        m_ModelChannel->Publish(vNom, vDenom);
+
+    const CCheckpoint::SLoopState& loop = Checkpoint.GetLoopState();
+    if (loop.bPrepared && !Prepare())
+        SIM_LOG_WARNING("Identification of the checkpoint could not be linked with the chain");
+
+    try
+    {
+        // the degrees and settings are replaced by the ones of the snapshot
+        std::shared_ptr<CARXIdentification> identification = std::make_shared<CARXIdentification>(1, 2, 0, 20, 0.99, 100);
+        const unsigned char* pEnd = Checkpoint.GetIdentification() + Checkpoint.GetIdentificationSize();
+        if (identification->LoadSnapshot(Checkpoint.GetIdentification(), pEnd) != pEnd)
+            throw std::string("Identification snapshot does not match its size.");
+
+        std::lock_guard<std::mutex> lock(m_TreeMutex);
+        // the structure of the loaded chain has to be the one the state was taken from
+        if (m_SimRoot->GetSnapshotSize() != Checkpoint.GetStateSize())
+            throw std::string("Chain state does not match the chain of the checkpoint.");
+        m_SimRoot->LoadSnapshot(Checkpoint.GetState());
+
+        m_dLastSimVal = loop.dLastSimVal;
+        *m_dRegInVal = loop.dRegInVal;
+        *m_dRegOutVal = loop.dRegOutVal;
+        *m_dObjInVal = loop.dObjInVal;
+        *m_dObjOutVal = loop.dObjOutVal;
+
+        std::lock_guard<std::mutex> guard(m_IdentifyMutex);
+        m_ARXIdentAlg = identification;
+    }
+    catch (std::string& e)
+    {
+        m_sLastError = e;
+        SIM_LOG_ERROR("Checkpoint not restored: " << e);
+
+        CSessionScope scope(*this);
+        std::lock_guard<std::mutex> lock(m_TreeMutex);
+        ClearChain();
+        return false;
+    }
+
+    return true;
+}
+
+bool CSimSession::LoadCheckpoint(const std::string& sFileName)
+{
+    CCheckpoint checkpoint;
+    if (!checkpoint.Open(sFileName))
+    {
+        m_sLastError = "Checkpoint file " + sFileName + " cannot be opened or is not valid";
+        SIM_LOG_ERROR(m_sLastError);
+        return false;
+    }
+
+    return RestoreCheckpoint(checkpoint);
+}
+
+void CSimSession::SetIdentificationParams(int nNomDegree, int nDenomDegree, int nDelay, int nTreshold,
+                                          double dForgettingFactor)
+{
+    std::lock_guard<std::mutex> guard(m_IdentifyMutex);
+    m_ARXIdentAlg.reset(new CARXIdentification(nNomDegree, nDenomDegree, nDelay, 10, dForgettingFactor, nTreshold));
+    m_ARXIdentAlg->ResetWholeHistory();
+}
+
+void CSimSession::GetLastIdentifiedNominator(std::vector<double>& vNom)
+{
+    std::lock_guard<std::mutex> guard(m_IdentifyMutex);
+    vNom = m_ARXIdentAlg->ReturnThetaNominator();
+}
+
+void CSimSession::GetLastIdentifiedDenominator(std::vector<double>& vDenom)
+{
+    std::lock_guard<std::mutex> guard(m_IdentifyMutex);
+    vDenom = m_ARXIdentAlg->ReturnThetaDenominator();
+}
+
+CSimSession::~CSimSession()
+{
+    // the chain goes first, its objects release their names and IDs
+    m_SimRoot.reset();
+}
+
+CSessionScope::CSessionScope(CSimSession& Session)
+    : m_pOldIDs(SUniqueIDGenerator::SetCurrent(&Session.GetIDs())),
+      m_pOldNames(SUniqueNameController::SetCurrent(&Session.GetNames()))
+{
+}
+
+CSessionScope::~CSessionScope()
+{
+    SUniqueIDGenerator::SetCurrent(m_pOldIDs);
+    SUniqueNameController::SetCurrent(m_pOldNames);
+}
@@ -1,5 +1,6 @@
 #include "mainwindow.h"
 #include "SLogic.h"
+#include <QHash>
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
@@ -209,6 +210,14 @@ void MainWindow::on_actionLoad_Parameters_triggered()
     on_resetButton_clicked();
 }
 
+void MainWindow::on_actionOpen_Library_triggered()
+{
+    // a large file is only indexed, objects are created when simulated or selected
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Open Library"),"....//SimplePlot","All Files (*.*);;Text files (*.txt)");
+    SLogic::GetInstance().LoadSimChain(fileName.toStdString(), true);
+    on_resetButton_clicked();
+}
+
 void MainWindow::on_actionSave_Parameters_triggered()
 {
     QString fileName = QFileDialog::getSaveFileName(this, tr("Open File"),"C://","All Files (*.*);;Text files (*.txt)");
@@ -245,6 +254,43 @@ void MainWindow::AddTreeWidgetRoot(const QString& sName, const QString& sType, c
     }
 }
 
+void MainWindow::SetTreeWidget(const QStringList &parents, const QStringList &names, const QStringList &types, const int treeNumber)
+{
+    QTreeWidget* tree = (treeNumber == 0) ? ui->simulationTree : ui->propertyTree;
+    m_bSootheChangeSignal = true;
+    tree->clear();
+
+    // parents are found by name in a hash instead of searching the widget
+    QHash<QString, QTreeWidgetItem*> items;
+    QList<QTreeWidgetItem*> topLevelItems;
+    for (int i = 0; i < names.count(); ++i)
+    {
+        QTreeWidgetItem* item;
+        if (parents[i].isEmpty())
+        {
+            item = new QTreeWidgetItem();
+            topLevelItems.append(item);
+        }
+        else
+        {
+            QTreeWidgetItem* parent = items.value(parents[i], nullptr);
+            if (!parent)
+                continue;
+            item = new QTreeWidgetItem(parent);
+        }
+
+        item->setText(0, names[i]);
+        item->setText(1, types[i]);
+        if (treeNumber != 0)
+            item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsUserCheckable | Qt::ItemIsEnabled | Qt::ItemIsDragEnabled | Qt::ItemIsEditable);
+        items.insert(names[i], item);
+    }
+
+    tree->addTopLevelItems(topLevelItems);
+    tree->expandAll();
+    m_bSootheChangeSignal = false;
+}
+
 void MainWindow::AddTreeWidgetElement(const QString &sParent, const QString &sName, const QString &sType, const int treeNumber)
 {
     QList<QTreeWidgetItem*> parentNode;
@@ -0,0 +1,146 @@
+/** \file
+ * Benchmark of the GPC gain calculation for online-adaptive control, see CGPCGainSolver.
+ *
+ * Usage:
+ * GainSolverBench [--maxh <H>] [--l <L>] [--ro <RO>] [--steps <n>]
+ *
+ * For every prediction horizon from 1 to --maxh (50 by default) the model changes
+ * every step, so the gains are calculated every step, as by an adaptive CGPC.
+ * The cost per step of CGPCGainSolver is compared with the explicit inverse
+ * (G'G + roI)^-1 G' calculated before, together with the largest difference of the
+ * gains. The control horizon is --l, limited by H, or H if not given.
+ */
+
+#include "GPCGainSolver.h"
+#include "GainTable.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+/// Keeps results of the timed loops.
+static volatile double g_dSink;
+
+static void PrintUsage()
+{
+    std::cerr << "Usage: GainSolverBench [--maxh <H>] [--l <L>] [--ro <RO>] [--steps <n>]" << std::endl;
+}
+
+/// \brief Second order model slowly changing with the step, stable for every step.
+static void StepModel(int nStep, std::vector<double>& vA, std::vector<double>& vB)
+{
+    vA.assign(2, 0.0);
+    vB.assign(2, 0.0);
+    vA[0] = -1.5 + 0.1*std::sin(0.01*nStep);
+    vA[1] = 0.7;
+    vB[0] = 0.1 + 0.02*std::cos(0.013*nStep);
+    vB[1] = 0.05;
+}
+
+/// \brief Gains calculated the way CGPC did before the solver, with an explicit inverse.
+static void InverseGains(const double* pStep, int nH, int nL, double dRO, Eigen::VectorXd& vQ)
+{
+    Eigen::MatrixXd mG = Eigen::MatrixXd::Zero(nH, nL);
+    for (int c = 0; c < nL; ++c)
+        for (int r = c; r < nH; ++r)
+            mG(r, c) = pStep[r - c];
+
+    Eigen::MatrixXd mM = mG.transpose()*mG;
+    mM += dRO*Eigen::MatrixXd::Identity(nL, nL);
+    Eigen::MatrixXd mQ = mM.inverse()*mG.transpose();
+    vQ = mQ.row(0).transpose();
+}
+
+int main(int argc, char* argv[])
+{
+    int nMaxH = 50;
+    int nFixedL = 0;
+    double dRO = 0.1;
+    int nSteps = 20000;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (i + 1 >= argc)
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        const char* szOption = argv[i];
+        const char* szValue = argv[++i];
+        if (std::strcmp(szOption, "--maxh") == 0)
+            nMaxH = std::atoi(szValue);
+        else if (std::strcmp(szOption, "--l") == 0)
+            nFixedL = std::atoi(szValue);
+        else if (std::strcmp(szOption, "--ro") == 0)
+            dRO = std::atof(szValue);
+        else if (std::strcmp(szOption, "--steps") == 0)
+            nSteps = std::atoi(szValue);
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (nMaxH < 1 || nSteps < 1 || nFixedL < 0)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    // step responses of all the steps are calculated first, only the gains are timed
+    std::vector<double> vA, vB;
+    std::vector<double> vSteps(static_cast<size_t>(nSteps)*nMaxH);
+    for (int k = 0; k < nSteps; ++k)
+    {
+        StepModel(k, vA, vB);
+        CGainTable::StepResponse(vA, vB, nMaxH, &vSteps[static_cast<size_t>(k)*nMaxH]);
+    }
+
+    std::cout << std::setw(4) << "H" << std::setw(4) << "L" << std::setw(14) << "inverse ns" << std::setw(14)
+              << "solver ns" << std::setw(10) << "speedup" << std::setw(14) << "max |dq|" << std::endl;
+
+    CGPCGainSolver solver;
+    Eigen::VectorXd vQ, vRef;
+    for (int nH = 1; nH <= nMaxH; ++nH)
+    {
+        int nL = nFixedL ? std::min(nFixedL, nH) : nH;
+
+        // the results are summed into g_dSink, so the calculation cannot be left out
+        double dSum = 0.0;
+        auto start = std::chrono::steady_clock::now();
+        for (int k = 0; k < nSteps; ++k)
+        {
+            InverseGains(&vSteps[static_cast<size_t>(k)*nMaxH], nH, nL, dRO, vRef);
+            dSum += vRef(0);
+        }
+        auto middle = std::chrono::steady_clock::now();
+        for (int k = 0; k < nSteps; ++k)
+        {
+            solver.Solve(&vSteps[static_cast<size_t>(k)*nMaxH], nH, nL, dRO, vQ);
+            dSum -= vQ(0);
+        }
+        auto stop = std::chrono::steady_clock::now();
+
+        double dMaxDiff = 0.0;
+        for (int k = 0; k < nSteps; k += std::max(1, nSteps/100))
+        {
+            InverseGains(&vSteps[static_cast<size_t>(k)*nMaxH], nH, nL, dRO, vRef);
+            solver.Solve(&vSteps[static_cast<size_t>(k)*nMaxH], nH, nL, dRO, vQ);
+            dMaxDiff = std::max(dMaxDiff, (vQ - vRef).lpNorm<Eigen::Infinity>());
+        }
+
+        double dInverse = std::chrono::duration<double, std::nano>(middle - start).count()/nSteps;
+        double dSolver = std::chrono::duration<double, std::nano>(stop - middle).count()/nSteps;
+        std::cout << std::setw(4) << nH << std::setw(4) << nL << std::fixed << std::setprecision(1)
+                  << std::setw(14) << dInverse << std::setw(14) << dSolver << std::setw(10) << dInverse/dSolver
+                  << std::scientific << std::setprecision(2) << std::setw(14) << dMaxDiff << std::endl;
+        g_dSink = dSum;
+    }
+    return 0;
+}
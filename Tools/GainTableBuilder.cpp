@@ -0,0 +1,108 @@
+/** \file
+ * Offline tool precomputing GPC gain tables, see CGainTable.
+ *
+ * Usage:
+ * GainTableBuilder <output file> --a <min>:<max>:<points> ... --b <min>:<max>:<points> ...
+ *                  --setting <L>,<H>,<RO> ... [--threads <n>]
+ *
+ * Every --a and --b option adds an axis of the next denominator or nominator
+ * coefficient, every --setting option adds one GPC setting.
+ */
+
+#include "GainTable.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+static void PrintUsage()
+{
+    std::cerr << "Usage: GainTableBuilder <output file> --a <min>:<max>:<points> ... "
+                 "--b <min>:<max>:<points> ... --setting <L>,<H>,<RO> ... [--threads <n>]" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    std::vector<CGainTable::SAxis> vAAxes, vBAxes;
+    std::vector<CGainTable::SSetting> vSettings;
+    unsigned int nThreads = 0;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        if (i + 1 >= argc)
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        const char* szOption = argv[i];
+        const char* szValue = argv[++i];
+        if (std::strcmp(szOption, "--a") == 0 || std::strcmp(szOption, "--b") == 0)
+        {
+            CGainTable::SAxis axis;
+            if (std::sscanf(szValue, "%lf:%lf:%u", &axis.dMin, &axis.dMax, &axis.nPoints) != 3 || axis.nPoints == 0)
+            {
+                std::cerr << "Invalid axis: " << szValue << std::endl;
+                return 1;
+            }
+            (szOption[2] == 'a' ? vAAxes : vBAxes).push_back(axis);
+        }
+        else if (std::strcmp(szOption, "--setting") == 0)
+        {
+            CGainTable::SSetting setting;
+            if (std::sscanf(szValue, "%d,%d,%lf", &setting.nL, &setting.nH, &setting.dRO) != 3)
+            {
+                std::cerr << "Invalid setting: " << szValue << std::endl;
+                return 1;
+            }
+            vSettings.push_back(setting);
+        }
+        else if (std::strcmp(szOption, "--threads") == 0)
+            nThreads = std::atoi(szValue);
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (vAAxes.empty() || vBAxes.empty() || vSettings.empty())
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    CGainTable table;
+    try
+    {
+        table.SetGrid(vAAxes, vBAxes);
+    }
+    catch (std::string& e)
+    {
+        std::cerr << e << std::endl;
+        return 1;
+    }
+    for (auto& setting : vSettings)
+        table.AddSetting(setting.nL, setting.nH, setting.dRO);
+
+    auto start = std::chrono::steady_clock::now();
+    table.Build(nThreads);
+    auto stop = std::chrono::steady_clock::now();
+
+    if (!table.Save(argv[1]))
+    {
+        std::cerr << "Cannot write " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::cout << table.GetNumOfPoints() << " grid points, " << vSettings.size() << " settings, "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count() << " ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,169 @@
+/** \file
+ * Benchmark of the node lookups dispatched on capability bits, see ISISO::GetKind().
+ *
+ * Usage:
+ * NodeLookupBench [--nodes <n>] [--queries <n>]
+ *
+ * A tree of about --nodes nodes (10^4 by default) is built from groups of 100 objects
+ * under the root, with a single PID regulator as the last node, so every search walks
+ * the whole tree. FindFirstRegulator() is compared with the walk asking the factory
+ * about the type of every node, as it did before, AsRegulator() with dynamic_cast over
+ * all the nodes, and a pre-order AcceptTree() walk is timed. Times are given per query.
+ * The exit code is 2 if the methods do not find the same regulator.
+ */
+
+#include "SimObject.h"
+#include "PIDRegulator.h"
+#include "NodeVisitor.h"
+#include "SObjectFactory.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <vector>
+
+/// Keeps results of the timed loops.
+static volatile long g_nSink;
+
+static void PrintUsage()
+{
+    std::cerr << "Usage: NodeLookupBench [--nodes <n>] [--queries <n>]" << std::endl;
+}
+
+/// \brief Prints one line of the results.
+static void PrintResult(const char* szCase, double dMicroseconds)
+{
+    std::cout << std::left << std::setw(36) << szCase << std::right << std::fixed << std::setprecision(1)
+              << std::setw(12) << dMicroseconds << std::endl;
+}
+
+/// \brief Finds the first regulator the way FindFirstRegulator() did before, asking the factory for every node.
+static ISISO* FactoryFind(ISISO* pNode)
+{
+    if (SObjectFactory::GetInstance().IsARegulator(pNode->GetType()))
+        return pNode;
+
+    std::list<std::weak_ptr<ISISO> > children;
+    pNode->GetChildren(children);
+    for (auto it = children.begin(); it != children.end(); ++it)
+        if (ISISO* pFound = FactoryFind(it->lock().get()))
+            return pFound;
+    return nullptr;
+}
+
+/// Counts the regulators of the visited tree.
+class CRegulatorCounter : public CNodeVisitor
+{
+public:
+    CRegulatorCounter() : m_nCount(0) {}
+
+    void Visit(CRegulator&) override
+    {
+        ++m_nCount;
+    }
+
+    long m_nCount;
+};
+
+/// \brief Times nQueries calls of the query.
+/// \return Microseconds per query.
+template <class Query>
+static double Time(int nQueries, Query query)
+{
+    long nSum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < nQueries; ++i)
+        nSum += query();
+    auto stop = std::chrono::steady_clock::now();
+    g_nSink = nSum;
+    return std::chrono::duration<double, std::micro>(stop - start).count()/nQueries;
+}
+
+int main(int argc, char* argv[])
+{
+    int nNodes = 10000;
+    int nQueries = 200;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (i + 1 >= argc)
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        const char* szOption = argv[i];
+        const char* szValue = argv[++i];
+        if (std::strcmp(szOption, "--nodes") == 0)
+            nNodes = std::atoi(szValue);
+        else if (std::strcmp(szOption, "--queries") == 0)
+            nQueries = std::atoi(szValue);
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (nNodes < 100 || nQueries < 1)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    // groups of 100 objects, the regulator is added to the last group
+    std::shared_ptr<CSimObject> root(new CSimObject(0, serial, "root"));
+    std::vector<ISISO*> vNodes(1, root.get());
+    for (int nGroup = 0; nGroup < nNodes/100; ++nGroup)
+    {
+        std::shared_ptr<ISISO> group(new CSimObject(0, parallel, "group"));
+        root->AddChild(group);
+        vNodes.push_back(group.get());
+        for (int j = 0; j < 99 && static_cast<int>(vNodes.size()) < nNodes - 1; ++j)
+        {
+            std::shared_ptr<ISISO> object(new CSimObject());
+            group->AddChild(object);
+            vNodes.push_back(object.get());
+        }
+    }
+    std::shared_ptr<ISISO> regulator(new CPIDRegulator());
+    vNodes.back()->GetParent()->AddChild(regulator);
+    vNodes.push_back(regulator.get());
+
+    std::cout << "nodes " << vNodes.size() << std::endl;
+    std::cout << std::left << std::setw(36) << "case" << std::right << std::setw(12) << "us/query" << std::endl;
+
+    PrintResult("FindFirstRegulator (kind bits)", Time(nQueries, [&]() {
+        return static_cast<long>(root->FindFirstRegulator() != nullptr);
+    }));
+    PrintResult("walk asking the factory", Time(nQueries, [&]() {
+        return static_cast<long>(FactoryFind(root.get()) != nullptr);
+    }));
+    PrintResult("dynamic_cast<CRegulator*> all", Time(nQueries, [&]() {
+        long nCount = 0;
+        for (size_t i = 0; i < vNodes.size(); ++i)
+            nCount += dynamic_cast<CRegulator*>(vNodes[i]) != nullptr;
+        return nCount;
+    }));
+    PrintResult("AsRegulator all", Time(nQueries, [&]() {
+        long nCount = 0;
+        for (size_t i = 0; i < vNodes.size(); ++i)
+            nCount += AsRegulator(vNodes[i]) != nullptr;
+        return nCount;
+    }));
+    PrintResult("AcceptTree counting regulators", Time(nQueries, [&]() {
+        CRegulatorCounter counter;
+        root->AcceptTree(counter);
+        return counter.m_nCount;
+    }));
+
+    // every method has to find the single regulator
+    CRegulatorCounter counter;
+    root->AcceptTree(counter);
+    bool bSame = root->FindFirstRegulator() == regulator.get() && FactoryFind(root.get()) == regulator.get() &&
+                 AsRegulator(regulator.get()) == dynamic_cast<CRegulator*>(regulator.get()) && counter.m_nCount == 1;
+    return bSame ? 0 : 2;
+}
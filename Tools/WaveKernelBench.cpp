@@ -0,0 +1,142 @@
+/** \file
+ * Accuracy and throughput benchmark of the block wave kernels, see CWaveKernels.
+ *
+ * Usage:
+ * WaveKernelBench [--samples <n>] [--period <T>]
+ *
+ * The polynomial sine is compared with std::sin, which the sine generator called for
+ * every sample before. The block Fill() of the sine, square and triangle generators
+ * is compared with their scalar GenerateNext() called sample by sample. Times are
+ * given per sample, errors as the largest absolute difference. The exit code is 2
+ * if the sine error exceeds CWaveKernels::SIN_MAX_ERROR or Fill() differs from GenerateNext().
+ */
+
+#include "WaveKernels.h"
+#include "SinGen.h"
+#include "SquareGen.h"
+#include "TriangleGen.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+/// Keeps results of the timed loops.
+static volatile double g_dSink;
+
+static void PrintUsage()
+{
+    std::cerr << "Usage: WaveKernelBench [--samples <n>] [--period <T>]" << std::endl;
+}
+
+/// \brief Prints one line of the results.
+static void PrintResult(const char* szCase, double dScalar, double dBlock, double dMaxError)
+{
+    std::cout << std::left << std::setw(22) << szCase << std::right << std::fixed << std::setprecision(2)
+              << std::setw(12) << dScalar << std::setw(12) << dBlock << std::setw(10) << dScalar/dBlock
+              << std::scientific << std::setprecision(2) << std::setw(12) << dMaxError << std::endl;
+}
+
+/// \brief Times GenerateNext() against Fill() of the generator over nSamples samples.
+/// \return True if both give the same samples.
+static bool CompareGenerator(const char* szCase, IGenerator& Gen, std::vector<double>& vScalar,
+                             std::vector<double>& vBlock)
+{
+    // both paths start from the same state, Reset() does not restore the wave sign
+    std::unique_ptr<IGenerator> block(Gen.Clone());
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < vScalar.size(); ++i)
+        vScalar[i] = Gen.GenerateNext();
+    auto middle = std::chrono::steady_clock::now();
+    block->Fill(vBlock.data(), vBlock.size(), 0);
+    auto stop = std::chrono::steady_clock::now();
+
+    double dMaxError = 0.0;
+    for (size_t i = 0; i < vScalar.size(); ++i)
+        dMaxError = std::max(dMaxError, std::fabs(vScalar[i] - vBlock[i]));
+    g_dSink = vScalar.back() + vBlock.back();
+
+    double n = static_cast<double>(vScalar.size());
+    PrintResult(szCase, std::chrono::duration<double, std::nano>(middle - start).count()/n,
+                std::chrono::duration<double, std::nano>(stop - middle).count()/n, dMaxError);
+    return dMaxError == 0.0;
+}
+
+int main(int argc, char* argv[])
+{
+    long nSamples = 1000000;
+    int nPeriod = 1000;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (i + 1 >= argc)
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        const char* szOption = argv[i];
+        const char* szValue = argv[++i];
+        if (std::strcmp(szOption, "--samples") == 0)
+            nSamples = std::atol(szValue);
+        else if (std::strcmp(szOption, "--period") == 0)
+            nPeriod = std::atoi(szValue);
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (nSamples < 1 || nPeriod < 2)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    std::cout << std::left << std::setw(22) << "case" << std::right << std::setw(12) << "scalar ns"
+              << std::setw(12) << "block ns" << std::setw(10) << "speedup" << std::setw(12) << "max error" << std::endl;
+
+    // polynomial against the library sine, over arguments up to the documented limit
+    std::vector<double> vScalar(nSamples), vBlock(nSamples);
+    const double dFullAngle = 2*3.14159265358979323846;
+    const double dT = nPeriod;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < nSamples; ++i)
+        vScalar[i] = std::sin(dFullAngle*i/dT);
+    auto middle = std::chrono::steady_clock::now();
+    CWaveKernels::Sine(vBlock.data(), nSamples, 0, dFullAngle, dT, 1.0);
+    auto stop = std::chrono::steady_clock::now();
+
+    double dMaxError = 0.0;
+    for (long i = 0; i < nSamples; ++i)
+        dMaxError = std::max(dMaxError, std::fabs(vScalar[i] - vBlock[i]));
+    for (double dX = -1e6; dX <= 1e6; dX += 0.37)
+        dMaxError = std::max(dMaxError, std::fabs(std::sin(dX) - CWaveKernels::Sin(dX)));
+    g_dSink = vScalar.back() + vBlock.back();
+    PrintResult("std::sin / Sine", std::chrono::duration<double, std::nano>(middle - start).count()/nSamples,
+                std::chrono::duration<double, std::nano>(stop - middle).count()/nSamples, dMaxError);
+
+    // generators, GenerateNext() against Fill()
+    bool bExact = true;
+    CSineGen sine;
+    sine.SetPeriod(nPeriod);
+    bExact &= CompareGenerator("CSineGen", sine, vScalar, vBlock);
+
+    CSquareGen square;
+    square.SetPeriod(nPeriod);
+    square.SetDelay(nPeriod/3);
+    bExact &= CompareGenerator("CSquareGen", square, vScalar, vBlock);
+
+    CTriangleGen triangle;
+    triangle.SetPeriod(nPeriod);
+    triangle.SetDelay(nPeriod/3);
+    bExact &= CompareGenerator("CTriangleGen", triangle, vScalar, vBlock);
+
+    std::cout << "sine error bound " << std::scientific << CWaveKernels::SIN_MAX_ERROR << std::endl;
+    return dMaxError <= CWaveKernels::SIN_MAX_ERROR && bExact ? 0 : 2;
+}